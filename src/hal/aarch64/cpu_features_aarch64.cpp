@@ -0,0 +1,77 @@
+#include <hal/interface/cpu_features.hpp>
+
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#elif defined(__linux__)
+#include <sys/auxv.h>
+#endif
+
+namespace
+{
+#if defined(__APPLE__)
+    auto has_sysctl_flag(const char *name) -> bool
+    {
+        int    value = 0;
+        size_t size  = sizeof(value);
+        if (::sysctlbyname(name, &value, &size, nullptr, 0) != 0)
+        {
+            return false;
+        }
+        return value != 0;
+    }
+#elif defined(__linux__)
+    // uapi/asm/hwcap.h; older headers may lack the newer bits
+    constexpr unsigned long HWCAP_CRC32_BIT { 1ul << 7u };
+    constexpr unsigned long HWCAP_ATOMICS_BIT { 1ul << 8u };
+    constexpr unsigned long HWCAP2_CSSC_BIT { 1ul << 34u };
+#endif
+
+    auto probe(void) -> j1t::hal::cpu_features
+    {
+        using j1t::hal::cpu_feature;
+
+        j1t::hal::cpu_features features {};
+
+#if defined(__APPLE__)
+        if (has_sysctl_flag("hw.optional.armv8_crc32"))
+        {
+            features.add(cpu_feature::AARCH64_CRC32);
+        }
+        if (has_sysctl_flag("hw.optional.arm.FEAT_LSE"))
+        {
+            features.add(cpu_feature::AARCH64_LSE);
+        }
+        if (has_sysctl_flag("hw.optional.arm.FEAT_CSSC"))
+        {
+            features.add(cpu_feature::AARCH64_CSSC);
+        }
+#elif defined(__linux__)
+        const unsigned long hwcap  = ::getauxval(AT_HWCAP);
+        const unsigned long hwcap2 = ::getauxval(AT_HWCAP2);
+
+        if ((hwcap & HWCAP_CRC32_BIT) != 0u)
+        {
+            features.add(cpu_feature::AARCH64_CRC32);
+        }
+        if ((hwcap & HWCAP_ATOMICS_BIT) != 0u)
+        {
+            features.add(cpu_feature::AARCH64_LSE);
+        }
+        if ((hwcap2 & HWCAP2_CSSC_BIT) != 0u)
+        {
+            features.add(cpu_feature::AARCH64_CSSC);
+        }
+#endif
+
+        return features;
+    }
+}
+
+namespace j1t::hal
+{
+    auto host_cpu_features(void) -> cpu_features
+    {
+        static const cpu_features features = ::probe();
+        return features;
+    }
+}
@@ -52,6 +52,12 @@ namespace j1t::hal::aarch64
         return memory_internal;
     }
 
+    auto executable_memory_macos::executable_data(void) const -> const uint8_t *
+    {
+        // MAP_JIT: one mapping, W^X is toggled per thread
+        return memory_internal;
+    }
+
     auto executable_memory_macos::size(void) const -> uintmax_t
     {
         return size_internal;
@@ -67,8 +73,25 @@ namespace j1t::hal::aarch64
         ::pthread_jit_write_protect_np(true);
     }
 
+    auto executable_memory_macos::is_executable_while_writing(void) const -> bool
+    {
+        // MAP_JIT write protection is toggled per thread
+        return true;
+    }
+
     auto executable_memory_macos::finalize(void) -> void
     {
         end_write();
     }
 }
+
+namespace j1t::hal
+{
+    auto make_native_executable_memory(uintmax_t size, bool prefer_huge_pages) -> std::unique_ptr<executable_memory>
+    {
+        // MAP_JIT mappings cannot be backed by superpages
+        static_cast<void>(prefer_huge_pages);
+
+        return std::make_unique<j1t::hal::aarch64::executable_memory_macos>(size);
+    }
+}
@@ -2,11 +2,19 @@
 
 namespace j1t::hal
 {
-    auto flush_instruction_cache(void *begin, uintmax_t size) -> void
+    auto flush_instruction_cache(const void *begin, uintmax_t size) -> void
     {
-        auto *b = static_cast<char *>(begin);
+        // clean by VA works through the executable alias of a dual mapping too
+        auto *b = static_cast<char *>(const_cast<void *>(begin));
         auto *e = b + size;
 
         __builtin___clear_cache(b, e);
     }
+
+    auto synchronize_instruction_stream(void) -> void
+    {
+        // the writer's dc/ic maintenance is broadcast; this core still has to
+        // drop instructions fetched before it saw the publication
+        asm volatile("isb" ::: "memory");
+    }
 }
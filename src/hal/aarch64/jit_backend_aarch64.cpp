@@ -1,12 +1,20 @@
-#include <hal/interface/icache.hpp>
+#include <hal/interface/basic_blocks.hpp>
+#include <hal/interface/code_buffer.hpp>
+#include <hal/interface/code_image.hpp>
+#include <hal/interface/division_by_constant.hpp>
 #include <hal/interface/jit_backend.hpp>
+#include <hal/interface/local_allocator.hpp>
+#include <hal/interface/operand_stack_cache.hpp>
 
-#include <hal/aarch64/executable_memory_macos.hpp>
 #include <hal/aarch64/macro_assembler.hpp>
 
 #include <vm/opcodes.hpp>
 
+#include <algorithm>
+#include <bit>
 #include <memory>
+#include <optional>
+#include <span>
 #include <stdexcept>
 #include <vector>
 
@@ -37,6 +45,21 @@ namespace
         return (byte0 << 0u) | (byte1 << 8u) | (byte2 << 16u) | (byte3 << 24u);
     }
 
+    auto read_jump_target(const std::vector<uint8_t> &code, uint32_t opcode_pc, uint32_t &program_counter) -> uint32_t
+    {
+        int32_t rel               = static_cast<int32_t>(read_u32_le(code, program_counter));
+
+        const int64_t base_pc     = static_cast<int64_t>(opcode_pc);
+        const int64_t target_pc64 = base_pc + static_cast<int64_t>(rel);
+
+        if (target_pc64 < 0 || target_pc64 > static_cast<int64_t>(code.size()))
+        {
+            throw std::runtime_error("jump: target_pc out of range");
+        }
+
+        return static_cast<uint32_t>(target_pc64);
+    }
+
     static auto emit_push_boolean_from_cmp_eq(
         j1t::hal::aarch64::macro_assembler &assembler,
         uint32_t                            register_stack_top,
@@ -121,18 +144,148 @@ namespace
         assembler.branch_cond(0x8u, label_runtime_error);
     }
 
-    extern "C"
+    // unverified programs: one check at block entry that every pop and push
+    // of the block stays within the stack; the reach may not fit an
+    // add/sub immediate
+    static auto emit_check_stack_reach_bytes(
+        j1t::hal::aarch64::macro_assembler &assembler,
+        uint32_t                            register_context_x19,
+        uint32_t                            register_stack_top_x20,
+        uint32_t                            register_tmp_x9,
+        uint32_t                            register_tmp_x10,
+        j1t::hal::macro_assembler::label   &label_out_of_range,
+        int32_t                             offset_stack_base,
+        int32_t                             offset_stack_end,
+        uint64_t                            pop_bytes,
+        uint64_t                            push_bytes
+    ) -> void
+    {
+        if (pop_bytes != 0u)
+        {
+            // x10 = ctx->stack_base + pop_bytes
+            assembler.emit_move_pointer_immediate(register_tmp_x9, static_cast<uintptr_t>(pop_bytes));
+            assembler.emit_load_pointer_from_base_plus_offset(register_tmp_x10, register_context_x19, offset_stack_base);
+            assembler.emit_add_pointer_register(register_tmp_x10, register_tmp_x10, register_tmp_x9);
+
+            // if (stack_top < x10) goto out_of_range (LO = 0x3)
+            assembler.emit_compare_pointer_registers(register_stack_top_x20, register_tmp_x10);
+            assembler.branch_cond(0x3u, label_out_of_range);
+        }
+
+        if (push_bytes != 0u)
+        {
+            // x9 = stack_top + push_bytes
+            assembler.emit_move_pointer_immediate(register_tmp_x9, static_cast<uintptr_t>(push_bytes));
+            assembler.emit_add_pointer_register(register_tmp_x9, register_tmp_x9, register_stack_top_x20);
+
+            // if (x9 > ctx->stack_end) goto out_of_range (HI = 0x8)
+            assembler.emit_load_pointer_from_base_plus_offset(register_tmp_x10, register_context_x19, offset_stack_end);
+            assembler.emit_compare_pointer_registers(register_tmp_x9, register_tmp_x10);
+            assembler.branch_cond(0x8u, label_out_of_range);
+        }
+    }
+
+    // value *= factor, with a shift or a shifted add where one replaces
+    // the MUL
+    static auto emit_multiply_by_constant(
+        j1t::hal::aarch64::macro_assembler &assembler,
+        uint32_t                            value_register,
+        uint32_t                            register_tmp,
+        uint32_t                            factor
+    ) -> void
+    {
+        if (factor == 0u)
+        {
+            assembler.emit_move_immediate_u32(value_register, 0u);
+        }
+        else if (factor == 0xFFFF'FFFFu)
+        {
+            assembler.emit_negate_u32(value_register);
+        }
+        else if (std::has_single_bit(factor))
+        {
+            assembler.emit_shift_left_u32_immediate(value_register, value_register, std::countr_zero(factor));
+        }
+        else if (std::has_single_bit(factor - 1u))
+        {
+            // x + (x << k)
+            assembler.emit_add_shifted_u32_register(
+                value_register,
+                value_register,
+                value_register,
+                std::countr_zero(factor - 1u)
+            );
+        }
+        else
+        {
+            assembler.emit_move_immediate_u32(register_tmp, factor);
+            assembler.emit_multiply_u32_register(value_register, value_register, register_tmp);
+        }
+    }
+
+    // value /= divisor (signed, truncating, as vm::interpreter) without
+    // SDIV; divisor must not be 0
+    static auto emit_divide_by_constant(
+        j1t::hal::aarch64::macro_assembler &assembler,
+        uint32_t                            value_register,
+        uint32_t                            register_tmp_a,
+        uint32_t                            register_tmp_b,
+        int32_t                             divisor
+    ) -> void
     {
-        static auto j1t_helper_store8(uint8_t *memory, uint32_t address, uint32_t value) -> void
+        const uint32_t magnitude = divisor < 0 ? 0u - static_cast<uint32_t>(divisor) : static_cast<uint32_t>(divisor);
+
+        if (divisor == 1)
         {
-            memory[address] = static_cast<uint8_t>(value & 0xFFu);
+            return;
+        }
+
+        if (divisor == -1)
+        {
+            // wraps on INT32_MIN, like the interpreter
+            assembler.emit_negate_u32(value_register);
+            return;
+        }
+
+        if (std::has_single_bit(magnitude) && divisor != INT32_MIN)
+        {
+            // arithmetic shifts round toward negative infinity; a negative
+            // dividend is biased by 2^k - 1 first
+            const uint32_t shift = static_cast<uint32_t>(std::countr_zero(magnitude));
+
+            assembler.emit_shift_right_i32_immediate(register_tmp_a, value_register, 31u);
+            assembler.emit_shift_right_u32_immediate(register_tmp_a, register_tmp_a, 32u - shift);
+            assembler.emit_add_u32_register(value_register, value_register, register_tmp_a);
+            assembler.emit_shift_right_i32_immediate(value_register, value_register, shift);
+
+            if (divisor < 0)
+            {
+                assembler.emit_negate_u32(value_register);
+            }
+            return;
         }
 
-        static auto j1t_helper_load8u(const uint8_t *memory, uint32_t address) -> uint32_t
+        const j1t::hal::signed_division_magic magic = j1t::hal::signed_division_magic_of(divisor);
+
+        assembler.emit_move_immediate_u32(register_tmp_b, static_cast<uint32_t>(magic.multiplier));
+        assembler.emit_multiply_high_i32_register(register_tmp_a, value_register, register_tmp_b);
+        if (magic.dividend_sign > 0)
+        {
+            assembler.emit_add_u32_register(register_tmp_a, register_tmp_a, value_register);
+        }
+        else if (magic.dividend_sign < 0)
         {
-            return static_cast<uint32_t>(memory[address]);
+            assembler.emit_subtract_u32_register(register_tmp_a, register_tmp_a, value_register);
         }
+        assembler.emit_shift_right_i32_immediate(register_tmp_a, register_tmp_a, magic.shift);
 
+        // + 1 when negative
+        assembler.emit_shift_right_u32_immediate(value_register, register_tmp_a, 31u);
+        assembler.emit_add_u32_register(value_register, value_register, register_tmp_a);
+    }
+
+    extern "C"
+    {
         static auto j1t_helper_read8u(void) -> uint32_t
         {
             int c = std::getchar();
@@ -143,6 +296,25 @@ namespace
             return static_cast<uint32_t>(static_cast<uint8_t>(c));
         }
     }
+
+    // address for a relocation_target in this process; 0 for targets this
+    // backend never emits
+    auto relocation_address(j1t::hal::relocation_target target) -> uintptr_t
+    {
+        switch (target)
+        {
+            case j1t::hal::relocation_target::HELPER_READ_8_UNSIGNED :
+                return reinterpret_cast<uintptr_t>(&j1t_helper_read8u);
+
+            case j1t::hal::relocation_target::PUTCHAR :
+                return reinterpret_cast<uintptr_t>(&putchar);
+
+            case j1t::hal::relocation_target::COUNT :
+                break;
+        }
+
+        return 0u;
+    }
 }
 
 namespace j1t::hal
@@ -152,15 +324,49 @@ namespace j1t::hal
         class compiled_code_aarch64 final : public compiled_code
         {
           public:
-            compiled_code_aarch64(std::unique_ptr<j1t::hal::executable_memory> memory, uint32_t code_size)
+            compiled_code_aarch64(
+                std::unique_ptr<j1t::hal::executable_memory> memory,
+                uint32_t                                     code_size,
+                j1t::hal::cpu_features                       target_features,
+                std::vector<entry_point>                     entry_points,
+                std::vector<relocation>                      relocations,
+                uint32_t                                     memory_fault_offset,
+                j1t::hal::memory_sandbox                     sandbox
+            )
                 : memory_internal(std::move(memory))
                 , code_size_internal(code_size)
+                , features_internal(target_features)
+                , entry_points_internal(std::move(entry_points))
+                , relocations_internal(std::move(relocations))
+                , memory_fault_offset_internal(memory_fault_offset)
+                , sandbox_internal(sandbox)
             {
             }
 
             auto entry(void) -> entry_type override
             {
-                return reinterpret_cast<entry_type>(memory_internal->data());
+                return reinterpret_cast<entry_type>(reinterpret_cast<uintptr_t>(memory_internal->executable_data()));
+            }
+
+            auto entry_at(uint32_t pc) -> entry_type override
+            {
+                const auto found = std::lower_bound(
+                    entry_points_internal.begin(),
+                    entry_points_internal.end(),
+                    pc,
+                    [](const entry_point &point, uint32_t target_pc)
+                    {
+                        return point.pc < target_pc;
+                    }
+                );
+                if (found == entry_points_internal.end() || found->pc != pc)
+                {
+                    return nullptr;
+                }
+
+                return reinterpret_cast<entry_type>(
+                    reinterpret_cast<uintptr_t>(memory_internal->executable_data()) + found->offset
+                );
             }
 
             auto code_size(void) const -> uint32_t override
@@ -168,26 +374,118 @@ namespace j1t::hal
                 return code_size_internal;
             }
 
+            auto features(void) const -> j1t::hal::cpu_features override
+            {
+                return features_internal;
+            }
+
+            auto image(void) const -> code_image override
+            {
+                const uint8_t *code = memory_internal->executable_data();
+
+                code_image result {};
+                result.code.assign(code, code + code_size_internal);
+                result.entry_points = entry_points_internal;
+                result.relocations         = relocations_internal;
+                result.features            = features_internal;
+                result.memory_fault_offset = memory_fault_offset_internal;
+                return result;
+            }
+
+            auto sandbox(void) const -> j1t::hal::memory_sandbox override
+            {
+                return sandbox_internal;
+            }
+
+            auto memory_fault_exit(void) -> uintptr_t override
+            {
+                return reinterpret_cast<uintptr_t>(memory_internal->executable_data()) + memory_fault_offset_internal;
+            }
+
           private:
             std::unique_ptr<j1t::hal::executable_memory> memory_internal;
             uint32_t                                     code_size_internal { 0 };
+            j1t::hal::cpu_features                       features_internal {};
+            // ascending by pc, starting with { 0, 0 }
+            std::vector<entry_point>                     entry_points_internal;
+            std::vector<relocation>                      relocations_internal;
+            uint32_t                                     memory_fault_offset_internal { 0 };
+            j1t::hal::memory_sandbox                     sandbox_internal { j1t::hal::memory_sandbox::GUARD_PAGES };
         };
 
         class jit_backend_aarch64 final : public j1t::hal::jit_backend
         {
           public:
+            jit_backend_aarch64(j1t::hal::cpu_features target_features, j1t::hal::memory_sandbox sandbox)
+                : target_features_internal(target_features)
+                , sandbox_internal(sandbox)
+            {
+            }
+
+            auto target_features(void) const -> j1t::hal::cpu_features override
+            {
+                return target_features_internal;
+            }
+
+            auto version(void) const -> uint32_t override
+            {
+                return CODE_GENERATOR_VERSION;
+            }
+
+            auto load(const j1t::hal::code_image &image) -> std::unique_ptr<j1t::hal::compiled_code> override
+            {
+                using j1t::hal::aarch64::macro_assembler;
+
+                if (!j1t::hal::is_well_formed(image, macro_assembler::PATCHABLE_MOVE_POINTER_SIZE)
+                    || !target_features_internal.includes(image.features))
+                {
+                    return nullptr;
+                }
+
+                j1t::hal::code_buffer buffer;
+                buffer.emit_bytes(image.code.data(), static_cast<uint32_t>(image.code.size()));
+                for (const j1t::hal::relocation &site : image.relocations)
+                {
+                    const uintptr_t address = relocation_address(site.target);
+                    if (address == 0u)
+                    {
+                        return nullptr;
+                    }
+
+                    macro_assembler::patch_move_pointer(buffer, site.offset, address);
+                }
+
+                auto memory = j1t::hal::install_code(buffer);
+
+                return std::make_unique<compiled_code_aarch64>(
+                    std::move(memory),
+                    buffer.size(),
+                    image.features,
+                    image.entry_points,
+                    image.relocations,
+                    image.memory_fault_offset,
+                    sandbox_internal
+                );
+            }
+
+            auto name(void) const -> const char * override
+            {
+                // the sandboxes emit different code for the same program
+                return sandbox_internal == j1t::hal::memory_sandbox::ADDRESS_MASK ? "aarch64-masked" : "aarch64";
+            }
+
             auto compile(const j1t::vm::program &target_program) -> std::unique_ptr<j1t::hal::compiled_code> override
             {
-                // TODO: improve memory size estimation
-                auto memory = std::make_unique<j1t::hal::aarch64::executable_memory_macos>(4096 * 4096u);
-                memory->begin_write();
+                // emit into a growable buffer first; the executable region is
+                // allocated once the final size is known
+                j1t::hal::code_buffer buffer;
+                buffer.reserve(static_cast<uint32_t>(target_program.code.size()) * 24u + 256u);
                 j1t::hal::aarch64::macro_assembler assembler;
-                assembler.set_output(*memory);
+                assembler.set_output(buffer);
+                assembler.set_features(target_features_internal);
 
                 constexpr uint32_t REGISTER_CONTEXT   = 19;
                 constexpr uint32_t REGISTER_STACK_TOP = 20;
-                constexpr uint32_t REGISTER_TEMP_W2   = 2;
-                constexpr uint32_t REGISTER_TEMP_W3   = 3;
                 constexpr uint32_t REGISTER_RET_W0    = 0; // only return value
                 constexpr uint32_t REGISTER_ZERO_WZR  = 31;
                 constexpr uint32_t REGISTER_CALL_TMP  = 16; // x16 (IP0)
@@ -204,24 +502,28 @@ namespace j1t::hal
                 constexpr int32_t OFFSET_STACK_END    = static_cast<int32_t>(sizeof(void *) * 3);
                 constexpr int32_t OFFSET_LOCALS       = static_cast<int32_t>(sizeof(void *) * 4);
                 constexpr int32_t OFFSET_ERROR_CODE   = static_cast<int32_t>(sizeof(void *) * 5);
+                constexpr int32_t OFFSET_MEMORY_MASK  = OFFSET_ERROR_CODE + 4;
 
                 auto label_runtime_error              = assembler.create_label();
 
-                // Prologue: Save Context (LR, x19, x20)
-                // [SP, 24] = LR, [SP, 16] = x20, [SP, 8] = x19
-                assembler.emit_subtract_immediate_from_pointer(REGISTER_SP, REGISTER_SP, 32u);
-                assembler.emit_store_pointer_from_register_to_base_plus_offset(REGISTER_LR, REGISTER_SP, 24);
-                assembler.emit_store_pointer_from_register_to_base_plus_offset(REGISTER_STACK_TOP, REGISTER_SP, 16);
-                assembler.emit_store_pointer_from_register_to_base_plus_offset(REGISTER_CONTEXT, REGISTER_SP, 8);
+                // a verified program cannot underflow, and its caller leaves
+                // room for max_stack_depth (see jit_context), so its code
+                // checks neither
+                const std::shared_ptr<const j1t::vm::verification> facts       = target_program.verified();
+                const bool                                          is_verified = facts->is_verified;
 
-                // preserve context in x19 (callee-saved)
-                assembler.emit_move_pointer_register(REGISTER_CONTEXT, 0 /*x0*/);
+                // labels exist only at opcode boundaries; a jump into an
+                // immediate is left to the interpreters, like one out of range
+                if (!target_program.decoded()->is_linear)
+                {
+                    throw std::runtime_error("jump: target_pc inside an immediate");
+                }
 
-                // load stack_top to x20 and keep it across calls
-                assembler.emit_load_pointer_from_base_plus_offset(REGISTER_STACK_TOP, REGISTER_CONTEXT, OFFSET_STACK_TOP);
-                // 1st pass: create labels for each opcode boundary
+                // 1st pass: create labels for each opcode boundary and note
+                // whether linear memory is used at all
                 std::vector<j1t::hal::macro_assembler::label> pc_to_label;
                 pc_to_label.resize(target_program.code.size() + 1);
+                bool uses_memory { false };
 
                 {
                     uint32_t scan_pc = 0;
@@ -244,625 +546,632 @@ namespace j1t::hal
                                 scan_pc += 4;
                                 break;
 
+                            case j1t::vm::opcode::LOAD_8_UNSIGNED :
+                            case j1t::vm::opcode::LOAD_16_UNSIGNED :
+                            case j1t::vm::opcode::LOAD_32 :
+                            case j1t::vm::opcode::STORE_8 :
+                                uses_memory = true;
+                                break;
+
                             default :
                                 break;
                         }
                     }
 
+                    // a truncated immediate at the end steps past the code
+                    scan_pc              = std::min(scan_pc, static_cast<uint32_t>(target_program.code.size()));
                     pc_to_label[scan_pc] = assembler.create_label();
                 }
 
-                uint32_t pc { 0 };
+                // The linear memory base is pinned in x28, loaded on entry,
+                // so loads and stores are single instructions; programs that
+                // never touch memory leave x28 to the locals.
+                constexpr uint32_t REGISTER_MEMORY = 28;
+
+                // Hot locals live in x21-x28 for the whole run: loaded on
+                // entry, written back in the epilogue, which every exit
+                // passes through. Only verified programs qualify; the engine
+                // checks their locals_used against state::locals before
+                // entering.
+                constexpr uint32_t              LOCAL_REGISTERS[] = { 21, 22, 23, 24, 25, 26, 27, 28 };
+                const std::span<const uint32_t> local_pool
+                    = uses_memory ? std::span(LOCAL_REGISTERS).first(7) : std::span(LOCAL_REGISTERS);
+                const std::vector<j1t::hal::local_register> local_registers
+                    = is_verified ? j1t::hal::allocate_local_registers(target_program, local_pool)
+                                  : std::vector<j1t::hal::local_register> {};
+
+                // the local registers, then x28 if it holds the memory base
+                std::vector<uint32_t> saved_registers;
+                for (const j1t::hal::local_register &home : local_registers)
+                {
+                    saved_registers.push_back(home.machine_register);
+                }
+                if (uses_memory)
+                {
+                    saved_registers.push_back(REGISTER_MEMORY);
+                }
+
+                auto register_of_local = [&](uint32_t local_index) -> const j1t::hal::local_register *
+                {
+                    for (const j1t::hal::local_register &home : local_registers)
+                    {
+                        if (home.local_index == local_index)
+                        {
+                            return &home;
+                        }
+                    }
+
+                    return nullptr;
+                };
+
+                // LR, x19, x20, then the saved registers; sp stays 16-aligned
+                const uint32_t frame_size = (32u + 8u * static_cast<uint32_t>(saved_registers.size()) + 15u) & ~15u;
+
+                // x6 = &locals[index]
+                auto locals_address = [&](uint32_t local_index) -> void
+                {
+                    // x4 = locals_ptr
+                    assembler.emit_load_pointer_from_base_plus_offset(REGISTER_TMP_X4, REGISTER_CONTEXT, OFFSET_LOCALS);
+
+                    // w5 = index << 2
+                    assembler.emit_move_immediate_u32(5, local_index);
+                    assembler.emit_shift_left_u32_immediate(5, 5, 2u);
+
+                    // x6 = x4 + x5
+                    assembler.emit_add_pointer_register(6, REGISTER_TMP_X4, 5);
+                };
+
+                // shared by the main entry and the loop header entries
+                auto emit_prologue = [&](void) -> void
+                {
+                    // Prologue: Save Context (LR, x19, x20, saved registers)
+                    // [SP, 32 + 8k] = saved register k
+                    // [SP, 24] = LR, [SP, 16] = x20, [SP, 8] = x19
+                    assembler.emit_subtract_immediate_from_pointer(REGISTER_SP, REGISTER_SP, frame_size);
+                    assembler.emit_store_pointer_from_register_to_base_plus_offset(REGISTER_LR, REGISTER_SP, 24);
+                    assembler.emit_store_pointer_from_register_to_base_plus_offset(REGISTER_STACK_TOP, REGISTER_SP, 16);
+                    assembler.emit_store_pointer_from_register_to_base_plus_offset(REGISTER_CONTEXT, REGISTER_SP, 8);
+                    for (std::size_t k = 0; k < saved_registers.size(); ++k)
+                    {
+                        assembler.emit_store_pointer_from_register_to_base_plus_offset(
+                            saved_registers[k],
+                            REGISTER_SP,
+                            static_cast<int32_t>(32u + 8u * k)
+                        );
+                    }
+
+                    // preserve context in x19 (callee-saved)
+                    assembler.emit_move_pointer_register(REGISTER_CONTEXT, 0 /*x0*/);
+
+                    // load stack_top to x20 and keep it across calls
+                    assembler.emit_load_pointer_from_base_plus_offset(REGISTER_STACK_TOP, REGISTER_CONTEXT, OFFSET_STACK_TOP);
+
+                    if (uses_memory)
+                    {
+                        assembler.emit_load_pointer_from_base_plus_offset(REGISTER_MEMORY, REGISTER_CONTEXT, OFFSET_MEMORY);
+                    }
+
+                    for (const j1t::hal::local_register &home : local_registers)
+                    {
+                        locals_address(home.local_index);
+                        assembler.emit_load_u32_from_base_plus_offset(home.machine_register, 6, 0);
+                    }
+                };
+
+                emit_prologue();
+
+                // set while emitting the checked copy of a block
+                bool per_op_checks { false };
+
+                auto check_can_pop = [&](uint32_t pop_bytes) -> void
+                {
+                    if (!per_op_checks)
+                    {
+                        return;
+                    }
+
+                    emit_check_can_pop_bytes(
+                        assembler,
+                        REGISTER_CONTEXT,
+                        REGISTER_STACK_TOP,
+                        REGISTER_TMP_X9,
+                        REGISTER_TMP_X10,
+                        REGISTER_ERROR_W1,
+                        label_runtime_error,
+                        OFFSET_STACK_BASE,
+                        pop_bytes,
+                        1u // STACK_UNDERFLOW
+                    );
+                };
+
+                auto check_can_push = [&](uint32_t push_bytes) -> void
+                {
+                    if (!per_op_checks)
+                    {
+                        return;
+                    }
+
+                    emit_check_can_push_bytes(
+                        assembler,
+                        REGISTER_CONTEXT,
+                        REGISTER_STACK_TOP,
+                        REGISTER_TMP_X9,
+                        REGISTER_TMP_X10,
+                        REGISTER_ERROR_W1,
+                        label_runtime_error,
+                        OFFSET_STACK_END,
+                        push_bytes,
+                        2u // STACK_OVERFLOW
+                    );
+                };
+
+                // guard pages need nothing: addresses stay below 4 GiB, all of
+                // it reserved (see linear_memory)
+                auto emit_sandbox_address = [&](uint32_t address_register) -> void
+                {
+                    if (sandbox_internal == j1t::hal::memory_sandbox::ADDRESS_MASK)
+                    {
+                        assembler.emit_load_u32_from_base_plus_offset(REGISTER_TMP_X9, REGISTER_CONTEXT, OFFSET_MEMORY_MASK);
+                        assembler.emit_and_u32_register(address_register, address_register, REGISTER_TMP_X9);
+                    }
+                };
+
+                // helper addresses are relocated when a code_image is loaded
+                std::vector<j1t::hal::relocation> relocations;
+                auto load_helper_address = [&](j1t::hal::relocation_target target) -> void
+                {
+                    const uint32_t offset = assembler.emit_move_pointer_patchable(REGISTER_CALL_TMP, relocation_address(target));
+                    relocations.push_back({ .offset = offset, .target = target });
+                };
+
+                // Operand stack values stay in x11-x15 between ops and only
+                // reach memory at block boundaries, helper calls and exits.
+                // All are caller-saved and clear of the argument registers.
+                constexpr uint32_t CACHE_REGISTERS[] = { 11, 12, 13, 14, 15 };
+                j1t::hal::operand_stack_cache stack(assembler, REGISTER_STACK_TOP, REGISTER_TMP_X9, CACHE_REGISTERS);
+
+                // binary operators: pop rhs, pop lhs, result into lhs
+                auto emit_binary = [&](auto &&emit_operation) -> void
+                {
+                    check_can_pop(8u);
+                    uint32_t rhs = stack.pop_to_register();
+                    uint32_t lhs = stack.pop_to_register();
+                    emit_operation(lhs, rhs);
+                    stack.release(rhs);
+                    stack.push_register(lhs);
+                };
+
+                // like emit_binary, for an rhs that is a constant in the stack
+                // cache (see operand_stack_cache::top_constant())
+                auto emit_binary_constant = [&](auto &&emit_operation) -> void
+                {
+                    check_can_pop(8u);
+                    const uint32_t rhs = *stack.top_constant();
+                    stack.drop();
+                    uint32_t lhs = stack.pop_to_register();
+                    emit_operation(lhs, rhs);
+                    stack.push_register(lhs);
+                };
+
+                // whether the op at pc is a JUMP_IF_ZERO or JUMP_IF_NOT_ZERO
+                // that a compare just before it can branch into directly:
+                // in the same block, so nothing else jumps to it, and not in
+                // a checked copy, whose per-op checks expect the boolean
+                auto is_fusable_jump = [&](uint32_t pc, uint32_t end_pc, bool is_checked_copy) -> bool
+                {
+                    if (is_checked_copy || pc >= end_pc)
+                    {
+                        return false;
+                    }
+
+                    const j1t::vm::opcode next = static_cast<j1t::vm::opcode>(target_program.code[pc]);
+                    return next == j1t::vm::opcode::JUMP_IF_ZERO || next == j1t::vm::opcode::JUMP_IF_NOT_ZERO;
+                };
 
                 auto label_epilogue = assembler.create_label();
-                while (pc < target_program.code.size())
+
+                // Emits the ops in [begin_pc, end_pc). The fast copy of a block
+                // binds the pc labels and keeps values cached across ops; the
+                // checked copy flushes and checks the in-memory stack before
+                // every op.
+                auto emit_ops = [&](uint32_t begin_pc, uint32_t end_pc, bool is_checked_copy) -> void
                 {
-                    uint32_t        opcode_pc = pc;
-                    uint8_t         opcode_u8 = read_u8(target_program.code, pc);
-                    j1t::vm::opcode op        = static_cast<j1t::vm::opcode>(opcode_u8);
-                    assembler.bind_label(pc_to_label[opcode_pc]);
+                    per_op_checks = is_checked_copy;
 
-                    switch (op)
+                    uint32_t pc = begin_pc;
+                    while (pc < end_pc)
                     {
-                        case j1t::vm::opcode::NOP :
-                            break;
-
-                        case j1t::vm::opcode::PUSH :
-                            {
-                                uint32_t immediate_value = read_u32_le(target_program.code, pc);
-
-                                emit_check_can_push_bytes(
-                                    assembler,
-                                    REGISTER_CONTEXT,
-                                    REGISTER_STACK_TOP,
-                                    REGISTER_TMP_X9,
-                                    REGISTER_TMP_X10,
-                                    REGISTER_ERROR_W1,
-                                    label_runtime_error,
-                                    OFFSET_STACK_END,
-                                    4u,
-                                    2u // STACK_OVERFLOW
-                                );
-
-                                // w2 = imm32
-                                assembler.emit_move_immediate_u32(REGISTER_TEMP_W2, immediate_value);
-                                // *sp = w2
-                                assembler.emit_store_u32_from_register_to_base_plus_offset(
-                                    REGISTER_TEMP_W2,
-                                    REGISTER_STACK_TOP,
-                                    0
-                                );
-                                // sp += 4
-                                assembler.emit_add_immediate_to_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                break;
-                            }
-
-                        case j1t::vm::opcode::ADD :
-                            {
-                                emit_check_can_pop_bytes(
-                                    assembler,
-                                    REGISTER_CONTEXT,
-                                    REGISTER_STACK_TOP,
-                                    REGISTER_TMP_X9,
-                                    REGISTER_TMP_X10,
-                                    REGISTER_ERROR_W1,
-                                    label_runtime_error,
-                                    OFFSET_STACK_BASE,
-                                    8u,
-                                    1u
-                                );
-                                // pop rhs
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(REGISTER_TEMP_W2, REGISTER_STACK_TOP, 0);
-
-                                // pop lhs
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(REGISTER_TEMP_W3, REGISTER_STACK_TOP, 0);
-
-                                // w3 += w2
-                                assembler.emit_add_u32_register(REGISTER_TEMP_W3, REGISTER_TEMP_W3, REGISTER_TEMP_W2);
-
-                                assembler.emit_store_u32_from_register_to_base_plus_offset(
-                                    REGISTER_TEMP_W3,
-                                    REGISTER_STACK_TOP,
-                                    0
-                                );
-
-                                assembler.emit_add_immediate_to_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                break;
-                            }
-
-                        case j1t::vm::opcode::RET :
-                            {
-                                emit_check_can_pop_bytes(
-                                    assembler,
-                                    REGISTER_CONTEXT,
-                                    REGISTER_STACK_TOP,
-                                    REGISTER_TMP_X9,
-                                    REGISTER_TMP_X10,
-                                    REGISTER_ERROR_W1,
-                                    label_runtime_error,
-                                    OFFSET_STACK_BASE,
-                                    4u,
-                                    1u
-                                );
-
-                                // pop return_value -> w2
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(REGISTER_TEMP_W2, REGISTER_STACK_TOP, 0);
-
-                                // save stack_top
-                                assembler.emit_store_pointer_from_register_to_base_plus_offset(
-                                    REGISTER_STACK_TOP,
-                                    REGISTER_CONTEXT,
-                                    OFFSET_STACK_TOP
-                                );
-
-                                // w0 = w2
-                                assembler.emit_add_u32_register(REGISTER_RET_W0, REGISTER_ZERO_WZR, REGISTER_TEMP_W2);
-
-                                // jump to common epilogue
-                                assembler.branch(label_epilogue);
-                                break;
-                            }
-
-                        case j1t::vm::opcode::LOCAL_GET :
-                            {
-                                uint32_t local_index = read_u32_le(target_program.code, pc);
-
-                                assembler.emit_load_pointer_from_base_plus_offset(
-                                    4, // x4 = locals_ptr
-                                    REGISTER_CONTEXT,
-                                    OFFSET_LOCALS
-                                );
-
-                                assembler.emit_move_immediate_u32(
-                                    5, // w5 = index
-                                    local_index
-                                );
-
-                                assembler.emit_shift_left_u32_immediate(
-                                    5, // w5 = w5 << 2
-                                    5,
-                                    2u
-                                );
-
-                                assembler.emit_add_pointer_register(
-                                    6, // x6 = x4 + x5
-                                    4,
-                                    5
-                                );
-
-                                assembler.emit_load_u32_from_base_plus_offset(
-                                    REGISTER_TEMP_W2, // w2 = locals[index]
-                                    6,
-                                    0
-                                );
-
-                                assembler.emit_store_u32_from_register_to_base_plus_offset(
-                                    REGISTER_TEMP_W2,
-                                    REGISTER_STACK_TOP,
-                                    0
-                                );
-
-                                assembler.emit_add_immediate_to_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                break;
-                            }
-
-                        case j1t::vm::opcode::LOCAL_SET :
-                            {
-                                uint32_t local_index = read_u32_le(target_program.code, pc);
-
-                                // pop value -> w2
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(
-                                    REGISTER_TEMP_W2, // w2
-                                    REGISTER_STACK_TOP,
-                                    0
-                                );
-
-                                // x4 = locals_ptr
-                                assembler.emit_load_pointer_from_base_plus_offset(
-                                    4, // x4
-                                    REGISTER_CONTEXT,
-                                    OFFSET_LOCALS
-                                );
-
-                                // w5 = local_index
-                                assembler.emit_move_immediate_u32(
-                                    5, // w5
-                                    local_index
-                                );
-
-                                // w5 <<= 2 (index * 4)
-                                assembler.emit_shift_left_u32_immediate(
-                                    5, // w5
-                                    5,
-                                    2u
-                                );
-
-                                // x6 = x4 + x5
-                                assembler.emit_add_pointer_register(
-                                    6, // x6
-                                    4, // x4
-                                    5  // x5
-                                );
-
-                                // locals[index] = w2
-                                assembler.emit_store_u32_from_register_to_base_plus_offset(
-                                    REGISTER_TEMP_W2, // w2
-                                    6,                // x6
-                                    0
-                                );
+                        uint32_t        opcode_pc = pc;
+                        uint8_t         opcode_u8 = read_u8(target_program.code, pc);
+                        j1t::vm::opcode op        = static_cast<j1t::vm::opcode>(opcode_u8);
 
+                        if (is_checked_copy)
+                        {
+                            stack.flush();
+                        }
+                        else if (opcode_pc != begin_pc)
+                        {
+                            assembler.bind_label(pc_to_label[opcode_pc]);
+                        }
+
+                        switch (op)
+                        {
+                            case j1t::vm::opcode::NOP :
                                 break;
-                            }
-
-                        case j1t::vm::opcode::SUB :
-                            {
-                                // rhs -> w2
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(REGISTER_TEMP_W2, REGISTER_STACK_TOP, 0);
-
-                                // lhs -> w3
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(REGISTER_TEMP_W3, REGISTER_STACK_TOP, 0);
-
-                                assembler.emit_subtract_u32_register(REGISTER_TEMP_W3, REGISTER_TEMP_W3, REGISTER_TEMP_W2);
-
-                                assembler.emit_store_u32_from_register_to_base_plus_offset(
-                                    REGISTER_TEMP_W3,
-                                    REGISTER_STACK_TOP,
-                                    0
-                                );
-                                assembler.emit_add_immediate_to_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                break;
-                            }
-
-                        case j1t::vm::opcode::MUL :
-                            {
-                                // rhs -> w2
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(REGISTER_TEMP_W2, REGISTER_STACK_TOP, 0);
-
-                                // lhs -> w3
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(REGISTER_TEMP_W3, REGISTER_STACK_TOP, 0);
-
-                                assembler.emit_multiply_u32_register(REGISTER_TEMP_W3, REGISTER_TEMP_W3, REGISTER_TEMP_W2);
-
-                                assembler.emit_store_u32_from_register_to_base_plus_offset(
-                                    REGISTER_TEMP_W3,
-                                    REGISTER_STACK_TOP,
-                                    0
-                                );
-                                assembler.emit_add_immediate_to_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                break;
-                            }
-
-                        case j1t::vm::opcode::DIV :
-                            {
-                                // rhs -> w2
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(REGISTER_TEMP_W2, REGISTER_STACK_TOP, 0);
-
-                                // lhs -> w3
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(REGISTER_TEMP_W3, REGISTER_STACK_TOP, 0);
-
-                                assembler.emit_divide_i32_register(REGISTER_TEMP_W3, REGISTER_TEMP_W3, REGISTER_TEMP_W2);
-
-                                assembler.emit_store_u32_from_register_to_base_plus_offset(
-                                    REGISTER_TEMP_W3,
-                                    REGISTER_STACK_TOP,
-                                    0
-                                );
-                                assembler.emit_add_immediate_to_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                break;
-                            }
 
-                        case j1t::vm::opcode::EQ :
-                            {
-                                // pop rhs -> w2
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(REGISTER_TEMP_W2, REGISTER_STACK_TOP, 0);
+                            case j1t::vm::opcode::PUSH :
+                                {
+                                    uint32_t immediate_value = read_u32_le(target_program.code, pc);
 
-                                // pop lhs -> w3
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(REGISTER_TEMP_W3, REGISTER_STACK_TOP, 0);
+                                    check_can_push(4u);
+                                    stack.push_constant(immediate_value);
+                                    break;
+                                }
 
-                                assembler.emit_compare_u32_registers(REGISTER_TEMP_W3, REGISTER_TEMP_W2);
+                            case j1t::vm::opcode::ADD :
+                                {
+                                    emit_binary(
+                                        [&](uint32_t lhs, uint32_t rhs)
+                                        {
+                                            assembler.emit_add_u32_register(lhs, lhs, rhs);
+                                        }
+                                    );
+                                    break;
+                                }
 
-                                // w7 = (w3 == w2) ? 1 : 0
-                                assembler.emit_cset_u32(7, 0u); // eq = 0
+                            case j1t::vm::opcode::RET :
+                                {
+                                    check_can_pop(4u);
+
+                                    // pop return_value -> w0
+                                    stack.pop_into(REGISTER_RET_W0);
+                                    stack.flush();
+
+                                    // save stack_top
+                                    assembler.emit_store_pointer_from_register_to_base_plus_offset(
+                                        REGISTER_STACK_TOP,
+                                        REGISTER_CONTEXT,
+                                        OFFSET_STACK_TOP
+                                    );
+
+                                    // jump to common epilogue
+                                    assembler.branch(label_epilogue);
+                                    break;
+                                }
 
-                                // push w7
-                                assembler.emit_store_u32_from_register_to_base_plus_offset(7, REGISTER_STACK_TOP, 0);
-                                assembler.emit_add_immediate_to_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                break;
-                            }
+                            case j1t::vm::opcode::LOCAL_GET :
+                                {
+                                    uint32_t local_index = read_u32_le(target_program.code, pc);
+
+                                    check_can_push(4u);
+                                    uint32_t value = stack.allocate();
+                                    if (const j1t::hal::local_register *home = register_of_local(local_index))
+                                    {
+                                        assembler.emit_move_u32_register(value, home->machine_register);
+                                    }
+                                    else
+                                    {
+                                        locals_address(local_index);
+                                        assembler.emit_load_u32_from_base_plus_offset(value, 6, 0);
+                                    }
+                                    stack.push_register(value);
+                                    break;
+                                }
 
-                        case j1t::vm::opcode::LESS_THAN_SIGNED :
-                            {
-                                // rhs w2, lhs w3
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(REGISTER_TEMP_W2, REGISTER_STACK_TOP, 0);
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(REGISTER_TEMP_W3, REGISTER_STACK_TOP, 0);
+                            case j1t::vm::opcode::LOCAL_SET :
+                                {
+                                    uint32_t local_index = read_u32_le(target_program.code, pc);
+
+                                    check_can_pop(4u);
+                                    if (const j1t::hal::local_register *home = register_of_local(local_index))
+                                    {
+                                        stack.pop_into(home->machine_register);
+                                        break;
+                                    }
+
+                                    uint32_t value = stack.pop_to_register();
+                                    locals_address(local_index);
+                                    assembler.emit_store_u32_from_register_to_base_plus_offset(value, 6, 0);
+                                    stack.release(value);
+                                    break;
+                                }
 
-                                assembler.emit_compare_u32_registers(REGISTER_TEMP_W3, REGISTER_TEMP_W2);
-                                assembler.emit_cset_u32(7, 0xBu);
+                            case j1t::vm::opcode::SUB :
+                                {
+                                    emit_binary(
+                                        [&](uint32_t lhs, uint32_t rhs)
+                                        {
+                                            assembler.emit_subtract_u32_register(lhs, lhs, rhs);
+                                        }
+                                    );
+                                    break;
+                                }
 
-                                assembler.emit_store_u32_from_register_to_base_plus_offset(7, REGISTER_STACK_TOP, 0);
-                                assembler.emit_add_immediate_to_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                break;
-                            }
+                            case j1t::vm::opcode::MUL :
+                                {
+                                    if (stack.top_constant())
+                                    {
+                                        emit_binary_constant(
+                                            [&](uint32_t lhs, uint32_t factor)
+                                            {
+                                                emit_multiply_by_constant(assembler, lhs, REGISTER_TMP_X10, factor);
+                                            }
+                                        );
+                                        break;
+                                    }
+
+                                    emit_binary(
+                                        [&](uint32_t lhs, uint32_t rhs)
+                                        {
+                                            assembler.emit_multiply_u32_register(lhs, lhs, rhs);
+                                        }
+                                    );
+                                    break;
+                                }
 
-                        case j1t::vm::opcode::LESS_THAN_UNSIGNED :
-                            {
-                                // rhs w2, lhs w3
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(REGISTER_TEMP_W2, REGISTER_STACK_TOP, 0);
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(REGISTER_TEMP_W3, REGISTER_STACK_TOP, 0);
+                            case j1t::vm::opcode::DIV :
+                                {
+                                    // a zero divisor keeps the SDIV path below
+                                    if (stack.top_constant().value_or(0u) != 0u)
+                                    {
+                                        emit_binary_constant(
+                                            [&](uint32_t lhs, uint32_t divisor)
+                                            {
+                                                emit_divide_by_constant(
+                                                    assembler,
+                                                    lhs,
+                                                    REGISTER_TMP_X9,
+                                                    REGISTER_TMP_X10,
+                                                    static_cast<int32_t>(divisor)
+                                                );
+                                            }
+                                        );
+                                        break;
+                                    }
+
+                                    emit_binary(
+                                        [&](uint32_t lhs, uint32_t rhs)
+                                        {
+                                            assembler.emit_divide_i32_register(lhs, lhs, rhs);
+                                        }
+                                    );
+                                    break;
+                                }
 
-                                assembler.emit_compare_u32_registers(REGISTER_TEMP_W3, REGISTER_TEMP_W2);
-                                assembler.emit_cset_u32(7, 0x3u);
+                            case j1t::vm::opcode::EQ :
+                            case j1t::vm::opcode::LESS_THAN_SIGNED :
+                            case j1t::vm::opcode::LESS_THAN_UNSIGNED :
+                                {
+                                    // eq = 0, lt = 0xB, lo = 0x3
+                                    uint32_t condition = 0u;
+                                    if (op == j1t::vm::opcode::LESS_THAN_SIGNED)
+                                    {
+                                        condition = 0xBu;
+                                    }
+                                    else if (op == j1t::vm::opcode::LESS_THAN_UNSIGNED)
+                                    {
+                                        condition = 0x3u;
+                                    }
+
+                                    if (is_fusable_jump(pc, end_pc, is_checked_copy))
+                                    {
+                                        // compare and b.cond; the boolean is
+                                        // never materialized
+                                        const uint32_t        jump_pc = pc;
+                                        const j1t::vm::opcode jump_op = static_cast<j1t::vm::opcode>(
+                                            read_u8(target_program.code, pc)
+                                        );
+                                        const uint32_t target_pc = read_jump_target(target_program.code, jump_pc, pc);
+
+                                        // conditions come in pairs: cc ^ 1 negates cc
+                                        if (jump_op == j1t::vm::opcode::JUMP_IF_ZERO)
+                                        {
+                                            condition ^= 1u;
+                                        }
+
+                                        // CMP takes a 12-bit unsigned immediate
+                                        std::optional<uint32_t> constant = stack.top_constant();
+                                        uint32_t                rhs      = 0;
+                                        if (constant && *constant <= 0xFFFu)
+                                        {
+                                            stack.drop();
+                                        }
+                                        else
+                                        {
+                                            constant.reset();
+                                            rhs = stack.pop_to_register();
+                                        }
+                                        uint32_t lhs = stack.pop_to_register();
+
+                                        stack.flush();
+                                        assembler.bind_label(pc_to_label[jump_pc]);
+
+                                        if (constant)
+                                        {
+                                            assembler.emit_compare_u32_immediate(lhs, *constant);
+                                        }
+                                        else
+                                        {
+                                            assembler.emit_compare_u32_registers(lhs, rhs);
+                                            stack.release(rhs);
+                                        }
+                                        stack.release(lhs);
+
+                                        assembler.branch_cond(condition, pc_to_label[target_pc]);
+                                        break;
+                                    }
+
+                                    // lhs = (lhs <cond> rhs) ? 1 : 0
+                                    emit_binary(
+                                        [&](uint32_t lhs, uint32_t rhs)
+                                        {
+                                            assembler.emit_compare_u32_registers(lhs, rhs);
+                                            assembler.emit_cset_u32(lhs, condition);
+                                        }
+                                    );
+                                    break;
+                                }
 
-                                assembler.emit_store_u32_from_register_to_base_plus_offset(7, REGISTER_STACK_TOP, 0);
-                                assembler.emit_add_immediate_to_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                break;
-                            }
-
-                        case j1t::vm::opcode::POP :
-                            {
-                                emit_check_can_pop_bytes(
-                                    assembler,
-                                    REGISTER_CONTEXT,
-                                    REGISTER_STACK_TOP,
-                                    REGISTER_TMP_X9,
-                                    REGISTER_TMP_X10,
-                                    REGISTER_ERROR_W1,
-                                    label_runtime_error,
-                                    OFFSET_STACK_BASE,
-                                    4u,
-                                    1u // STACK_UNDERFLOW
-                                );
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                break;
-                            }
+                            case j1t::vm::opcode::POP :
+                                {
+                                    check_can_pop(4u);
+                                    stack.drop();
+                                    break;
+                                }
 
-                        case j1t::vm::opcode::JUMP :
-                            {
-                                int32_t rel               = static_cast<int32_t>(read_u32_le(target_program.code, pc));
+                            case j1t::vm::opcode::JUMP :
+                                {
+                                    uint32_t target_pc = read_jump_target(target_program.code, opcode_pc, pc);
+                                    stack.flush();
+                                    assembler.branch(pc_to_label[target_pc]);
+                                    break;
+                                }
 
-                                const int64_t base_pc     = static_cast<int64_t>(opcode_pc);
-                                const int64_t target_pc64 = base_pc + static_cast<int64_t>(rel);
+                            case j1t::vm::opcode::JUMP_IF_ZERO :
+                            case j1t::vm::opcode::JUMP_IF_NOT_ZERO :
+                                {
+                                    uint32_t target_pc = read_jump_target(target_program.code, opcode_pc, pc);
+
+                                    check_can_pop(4u);
+                                    uint32_t condition = stack.pop_to_register();
+                                    stack.flush();
+
+                                    assembler.emit_compare_u32_registers(condition, REGISTER_ZERO_WZR);
+                                    stack.release(condition);
+
+                                    if (op == j1t::vm::opcode::JUMP_IF_ZERO)
+                                    {
+                                        assembler.branch_equal(pc_to_label[target_pc]);
+                                    }
+                                    else
+                                    {
+                                        assembler.branch_not_equal(pc_to_label[target_pc]);
+                                    }
+                                    break;
+                                }
 
-                                if (target_pc64 < 0 || target_pc64 > static_cast<int64_t>(target_program.code.size()))
+                            case j1t::vm::opcode::LOAD_8_UNSIGNED :
+                            case j1t::vm::opcode::LOAD_16_UNSIGNED :
+                            case j1t::vm::opcode::LOAD_32 :
                                 {
-                                    throw std::runtime_error("JUMP: target_pc out of range");
+                                    // stack: [..., addr] -> [..., value_u32]
+
+                                    check_can_pop(4u);
+                                    uint32_t address = stack.pop_to_register();
+                                    emit_sandbox_address(address);
+
+                                    if (op == j1t::vm::opcode::LOAD_8_UNSIGNED)
+                                    {
+                                        assembler.emit_load_u8_from_base_plus_index(address, REGISTER_MEMORY, address);
+                                    }
+                                    else if (op == j1t::vm::opcode::LOAD_16_UNSIGNED)
+                                    {
+                                        assembler.emit_load_u16_from_base_plus_index(address, REGISTER_MEMORY, address);
+                                    }
+                                    else
+                                    {
+                                        assembler.emit_load_u32_from_base_plus_index(address, REGISTER_MEMORY, address);
+                                    }
+
+                                    stack.push_register(address);
+                                    break;
                                 }
 
-                                const uint32_t target_pc = static_cast<uint32_t>(target_pc64);
-                                assembler.branch(pc_to_label[target_pc]);
-                                break;
-                            }
+                            case j1t::vm::opcode::STORE_8 :
+                                {
+                                    // stack: [..., addr, value] -> [...]
+
+                                    check_can_pop(8u);
+                                    uint32_t value   = stack.pop_to_register();
+                                    uint32_t address = stack.pop_to_register();
+                                    emit_sandbox_address(address);
 
-                        case j1t::vm::opcode::JUMP_IF_ZERO :
-                            {
-                                int32_t rel               = static_cast<int32_t>(read_u32_le(target_program.code, pc));
+                                    assembler.emit_store_u8_from_register_to_base_plus_index(value, REGISTER_MEMORY, address);
 
-                                const int64_t base_pc     = static_cast<int64_t>(opcode_pc);
-                                const int64_t target_pc64 = base_pc + static_cast<int64_t>(rel);
+                                    stack.release(value);
+                                    stack.release(address);
+                                    break;
+                                }
 
-                                if (target_pc64 < 0 || target_pc64 > static_cast<int64_t>(target_program.code.size()))
+                            case j1t::vm::opcode::READ_8_UNSIGNED :
                                 {
-                                    throw std::runtime_error("JUMP_IF_ZERO: target_pc out of range");
+                                    // stack: [...] -> [..., value_u32]
+
+                                    check_can_push(4u);
+                                    stack.flush();
+
+                                    // call helper: uint32_t read8u()
+                                    load_helper_address(j1t::hal::relocation_target::HELPER_READ_8_UNSIGNED);
+                                    assembler.emit_call_register(REGISTER_CALL_TMP);
+
+                                    // push w0
+                                    uint32_t value = stack.allocate();
+                                    assembler.emit_move_u32_register(value, REGISTER_RET_W0);
+                                    stack.push_register(value);
+                                    break;
                                 }
 
-                                const uint32_t target_pc = static_cast<uint32_t>(target_pc64);
-
-                                emit_check_can_pop_bytes(
-                                    assembler,
-                                    REGISTER_CONTEXT,
-                                    REGISTER_STACK_TOP,
-                                    REGISTER_TMP_X9,
-                                    REGISTER_TMP_X10,
-                                    REGISTER_ERROR_W1,
-                                    label_runtime_error,
-                                    OFFSET_STACK_BASE,
-                                    4u,
-                                    1u
-                                );
-
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(REGISTER_TEMP_W2, REGISTER_STACK_TOP, 0);
-
-                                assembler.emit_compare_u32_registers(REGISTER_TEMP_W2, REGISTER_ZERO_WZR);
-                                assembler.branch_equal(pc_to_label[target_pc]);
-                                break;
-                            }
+                            case j1t::vm::opcode::PRINT :
+                                {
+                                    check_can_pop(4u);
 
-                        case j1t::vm::opcode::JUMP_IF_NOT_ZERO :
-                            {
-                                int32_t rel               = static_cast<int32_t>(read_u32_le(target_program.code, pc));
+                                    // arg0 w0 = value (putchar expects int in w0)
+                                    stack.pop_into(REGISTER_RET_W0);
+                                    stack.flush();
 
-                                const int64_t base_pc     = static_cast<int64_t>(opcode_pc);
-                                const int64_t target_pc64 = base_pc + static_cast<int64_t>(rel);
+                                    // call putchar
+                                    load_helper_address(j1t::hal::relocation_target::PUTCHAR);
+                                    assembler.emit_call_register(REGISTER_CALL_TMP);
+                                    break;
+                                }
 
-                                if (target_pc64 < 0 || target_pc64 > static_cast<int64_t>(target_program.code.size()))
+                            default :
                                 {
-                                    throw std::runtime_error("JUMP_IF_NOT_ZERO: target_pc out of range");
+                                    throw std::runtime_error("jit_backend_aarch64: unsupported opcode");
                                 }
+                        }
+                    }
 
-                                const uint32_t target_pc = static_cast<uint32_t>(target_pc64);
-
-                                emit_check_can_pop_bytes(
-                                    assembler,
-                                    REGISTER_CONTEXT,
-                                    REGISTER_STACK_TOP,
-                                    REGISTER_TMP_X9,
-                                    REGISTER_TMP_X10,
-                                    REGISTER_ERROR_W1,
-                                    label_runtime_error,
-                                    OFFSET_STACK_BASE,
-                                    4u,
-                                    1u
-                                );
-
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(REGISTER_TEMP_W2, REGISTER_STACK_TOP, 0);
-
-                                assembler.emit_compare_u32_registers(REGISTER_TEMP_W2, REGISTER_ZERO_WZR);
-                                assembler.branch_not_equal(pc_to_label[target_pc]);
-                                break;
-                            }
-                        case j1t::vm::opcode::LOAD_8_UNSIGNED :
-                            {
-                                // stack: [..., addr] -> [..., value_u32]
-
-                                emit_check_can_pop_bytes(
-                                    assembler,
-                                    REGISTER_CONTEXT,
-                                    REGISTER_STACK_TOP,
-                                    REGISTER_TMP_X9,
-                                    REGISTER_TMP_X10,
-                                    REGISTER_ERROR_W1,
-                                    label_runtime_error,
-                                    OFFSET_STACK_BASE,
-                                    4u,
-                                    1u // STACK_UNDERFLOW
-                                );
-
-                                emit_check_can_push_bytes(
-                                    assembler,
-                                    REGISTER_CONTEXT,
-                                    REGISTER_STACK_TOP,
-                                    REGISTER_TMP_X9,
-                                    REGISTER_TMP_X10,
-                                    REGISTER_ERROR_W1,
-                                    label_runtime_error,
-                                    OFFSET_STACK_END,
-                                    4u,
-                                    2u // STACK_OVERFLOW
-                                );
-
-                                // pop addr -> w2
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(REGISTER_TEMP_W2, REGISTER_STACK_TOP, 0);
-
-                                // x4 = ctx->memory
-                                assembler.emit_load_pointer_from_base_plus_offset(
-                                    REGISTER_TMP_X4,
-                                    REGISTER_CONTEXT,
-                                    OFFSET_MEMORY
-                                );
-
-                                // arg0 x0 = memory
-                                assembler.emit_move_pointer_register(0, REGISTER_TMP_X4);
-
-                                // arg1 w1 = addr
-                                assembler.emit_add_u32_register(
-                                    1, // w1
-                                    REGISTER_ZERO_WZR,
-                                    REGISTER_TEMP_W2
-                                );
-
-                                // call helper: uint32_t load8u(const uint8_t*, uint32_t)
-                                assembler.emit_move_pointer_immediate(
-                                    REGISTER_CALL_TMP,
-                                    reinterpret_cast<uintptr_t>(&j1t_helper_load8u)
-                                );
-                                assembler.emit_call_register(REGISTER_CALL_TMP);
-
-                                // push w0 (return) onto vm stack
-                                assembler.emit_store_u32_from_register_to_base_plus_offset(
-                                    0, // w0
-                                    REGISTER_STACK_TOP,
-                                    0
-                                );
-                                assembler.emit_add_immediate_to_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                break;
-                            }
-
-                        case j1t::vm::opcode::STORE_8 :
-                            {
-                                // stack: [..., addr, value] -> [...]
-
-                                emit_check_can_pop_bytes(
-                                    assembler,
-                                    REGISTER_CONTEXT,
-                                    REGISTER_STACK_TOP,
-                                    REGISTER_TMP_X9,
-                                    REGISTER_TMP_X10,
-                                    REGISTER_ERROR_W1,
-                                    label_runtime_error,
-                                    OFFSET_STACK_BASE,
-                                    8u,
-                                    1u // STACK_UNDERFLOW
-                                );
-
-                                // pop value -> w2
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(REGISTER_TEMP_W2, REGISTER_STACK_TOP, 0);
-
-                                // pop addr -> w3
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(REGISTER_TEMP_W3, REGISTER_STACK_TOP, 0);
-
-                                // x4 = ctx->memory
-                                assembler.emit_load_pointer_from_base_plus_offset(
-                                    REGISTER_TMP_X4,
-                                    REGISTER_CONTEXT,
-                                    OFFSET_MEMORY
-                                );
-
-                                // arg0 x0 = memory
-                                assembler.emit_move_pointer_register(0, REGISTER_TMP_X4);
-
-                                // arg1 w1 = addr (w3)
-                                assembler.emit_add_u32_register(
-                                    1, // w1
-                                    REGISTER_ZERO_WZR,
-                                    REGISTER_TEMP_W3
-                                );
-
-                                // arg2 w2 = value (already in w2)
-                                // (no-op)
-
-                                // call helper: void store8(uint8_t*, uint32_t, uint32_t)
-                                assembler.emit_move_pointer_immediate(
-                                    REGISTER_CALL_TMP,
-                                    reinterpret_cast<uintptr_t>(&j1t_helper_store8)
-                                );
-                                assembler.emit_call_register(REGISTER_CALL_TMP);
-                                break;
-                            }
-
-                        case j1t::vm::opcode::READ_8_UNSIGNED :
-                            {
-                                // stack: [...] -> [..., value_u32]
-
-                                emit_check_can_push_bytes(
-                                    assembler,
-                                    REGISTER_CONTEXT,
-                                    REGISTER_STACK_TOP,
-                                    REGISTER_TMP_X9,
-                                    REGISTER_TMP_X10,
-                                    REGISTER_ERROR_W1,
-                                    label_runtime_error,
-                                    OFFSET_STACK_END,
-                                    4u,
-                                    2u // STACK_OVERFLOW
-                                );
-
-                                // call helper: uint32_t read8u()
-                                assembler.emit_move_pointer_immediate(
-                                    REGISTER_CALL_TMP,
-                                    reinterpret_cast<uintptr_t>(&j1t_helper_read8u)
-                                );
-                                assembler.emit_call_register(REGISTER_CALL_TMP);
-
-                                // push w0
-                                assembler.emit_store_u32_from_register_to_base_plus_offset(
-                                    0, // w0
-                                    REGISTER_STACK_TOP,
-                                    0
-                                );
-                                assembler.emit_add_immediate_to_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                break;
-                            }
-
-                        case j1t::vm::opcode::PRINT :
-                            {
-                                // pop value -> w2
-                                assembler.emit_subtract_immediate_from_pointer(REGISTER_STACK_TOP, REGISTER_STACK_TOP, 4u);
-                                assembler.emit_load_u32_from_base_plus_offset(REGISTER_TEMP_W2, REGISTER_STACK_TOP, 0);
-
-                                // arg0 (w0) = w2  (putchar expects int in w0)
-                                assembler.emit_add_u32_register(
-                                    0, // w0
-                                    REGISTER_ZERO_WZR,
-                                    REGISTER_TEMP_W2
-                                );
-
-                                // call putchar
-                                assembler.emit_move_pointer_immediate(
-                                    REGISTER_CALL_TMP,
-                                    reinterpret_cast<uintptr_t>(&putchar)
-                                );
-                                assembler.emit_call_register(REGISTER_CALL_TMP);
-                                break;
-                            }
+                    per_op_checks = false;
+                };
 
-                        default :
-                            {
-                                throw std::runtime_error("jit_backend_aarch64: unsupported opcode");
-                            }
+                // Each block of an unverified program checks its whole stack
+                // reach once on entry and takes its checked copy only when
+                // that fails, so errors still surface at the op that causes
+                // them. Verified programs need neither.
+                const std::vector<j1t::hal::basic_block> blocks = j1t::hal::find_basic_blocks(target_program.code);
+                std::vector<std::pair<std::size_t, j1t::hal::macro_assembler::label>> checked_copies;
+
+                for (std::size_t index = 0; index < blocks.size(); ++index)
+                {
+                    const j1t::hal::basic_block &block = blocks[index];
+
+                    stack.flush();
+                    assembler.bind_label(pc_to_label[block.begin_pc]);
+
+                    if (!is_verified && (block.max_pop != 0u || block.max_push != 0u))
+                    {
+                        auto label_checked_copy = assembler.create_label();
+                        checked_copies.emplace_back(index, label_checked_copy);
+
+                        emit_check_stack_reach_bytes(
+                            assembler,
+                            REGISTER_CONTEXT,
+                            REGISTER_STACK_TOP,
+                            REGISTER_TMP_X9,
+                            REGISTER_TMP_X10,
+                            label_checked_copy,
+                            OFFSET_STACK_BASE,
+                            OFFSET_STACK_END,
+                            uint64_t { block.max_pop } * 4u,
+                            uint64_t { block.max_push } * 4u
+                        );
                     }
+
+                    emit_ops(block.begin_pc, block.end_pc, false);
                 }
 
+                stack.flush();
                 assembler.bind_label(pc_to_label[static_cast<uint32_t>(target_program.code.size())]);
 
                 // finalize
@@ -874,6 +1183,26 @@ namespace j1t::hal
                 assembler.emit_move_immediate_u32(REGISTER_RET_W0, 0u);
                 assembler.branch(label_epilogue);
 
+                // checked copies, entered only from their block's entry check
+                for (const auto &[index, label_checked_copy] : checked_copies)
+                {
+                    const j1t::hal::basic_block &block = blocks[index];
+
+                    assembler.bind_label(label_checked_copy);
+                    emit_ops(block.begin_pc, block.end_pc, true);
+
+                    stack.flush();
+                    if (block.falls_through)
+                    {
+                        assembler.branch(pc_to_label[block.end_pc]);
+                    }
+                }
+
+                // a memory_fault_scope resumes faulting memory accesses here;
+                // registers hold what they held at the access
+                const uint32_t memory_fault_offset = assembler.code_size_bytes();
+                assembler.emit_move_immediate_u32(REGISTER_ERROR_W1, 4u); // MEMORY_OUT_OF_BOUNDS
+
                 assembler.bind_label(label_runtime_error);
 
                 assembler.emit_store_pointer_from_register_to_base_plus_offset(
@@ -895,28 +1224,76 @@ namespace j1t::hal
                 assembler.bind_label(label_epilogue);
 
                 // Epilogue (Fallthrough)
+                // write the local registers back (w0 holds the result)
+                for (const j1t::hal::local_register &home : local_registers)
+                {
+                    locals_address(home.local_index);
+                    assembler.emit_store_u32_from_register_to_base_plus_offset(home.machine_register, 6, 0);
+                }
+
                 // assembler.emit_move_immediate_u32(REGISTER_RET_W0, 0xDEADu);
                 assembler.emit_load_pointer_from_base_plus_offset(REGISTER_CONTEXT, REGISTER_SP, 8);
                 assembler.emit_load_pointer_from_base_plus_offset(REGISTER_STACK_TOP, REGISTER_SP, 16);
                 assembler.emit_load_pointer_from_base_plus_offset(REGISTER_LR, REGISTER_SP, 24);
-                assembler.emit_add_immediate_to_pointer(REGISTER_SP, REGISTER_SP, 32u);
+                for (std::size_t k = 0; k < saved_registers.size(); ++k)
+                {
+                    assembler.emit_load_pointer_from_base_plus_offset(
+                        saved_registers[k],
+                        REGISTER_SP,
+                        static_cast<int32_t>(32u + 8u * k)
+                    );
+                }
+                assembler.emit_add_immediate_to_pointer(REGISTER_SP, REGISTER_SP, frame_size);
 
                 assembler.emit_return();
-                std::printf("memory->data()=%p assembler.output=%p\n", memory->data(), assembler.debug_output_base());
-                assembler.finalize();
 
-                memory->end_write();
-                uintmax_t used_size = assembler.code_size_bytes();
-                j1t::hal::flush_instruction_cache(memory->data(), used_size);
-                memory->finalize();
+                // on-stack replacement: one more prologue per loop header,
+                // continuing with the operand stack the caller left in ctx
+                std::vector<j1t::hal::entry_point> entry_points { { .pc = 0u, .offset = 0u } };
+                for (uint32_t header_pc : j1t::vm::loop_headers(*target_program.decoded()))
+                {
+                    if (header_pc == 0u)
+                    {
+                        continue;
+                    }
+
+                    entry_points.push_back({ .pc = header_pc, .offset = assembler.code_size_bytes() });
+                    emit_prologue();
+                    assembler.branch(pc_to_label[header_pc]);
+                }
 
-                return std::make_unique<compiled_code_aarch64>(std::move(memory), static_cast<uint32_t>(used_size));
+                assembler.finalize();
+
+                auto     memory    = j1t::hal::install_code(buffer);
+                uint32_t used_size = assembler.code_size_bytes();
+
+                return std::make_unique<compiled_code_aarch64>(
+                    std::move(memory),
+                    used_size,
+                    assembler.features(),
+                    std::move(entry_points),
+                    std::move(relocations),
+                    memory_fault_offset,
+                    sandbox_internal
+                );
             }
+
+          private:
+            // bump when the emitted code changes
+            static constexpr uint32_t CODE_GENERATOR_VERSION = 8u;
+
+            j1t::hal::cpu_features   target_features_internal {};
+            j1t::hal::memory_sandbox sandbox_internal { j1t::hal::memory_sandbox::GUARD_PAGES };
         };
     }
 
     auto make_native_jit_backend(void) -> std::unique_ptr<jit_backend>
     {
-        return std::make_unique<jit_backend_aarch64>();
+        return make_native_jit_backend(host_cpu_features());
+    }
+
+    auto make_native_jit_backend(cpu_features target_features, memory_sandbox sandbox) -> std::unique_ptr<jit_backend>
+    {
+        return std::make_unique<jit_backend_aarch64>(target_features, sandbox);
     }
 }
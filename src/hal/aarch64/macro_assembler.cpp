@@ -1,56 +1,44 @@
 #include <cstdint>
+#include <stdexcept>
 #include <hal/aarch64/macro_assembler.hpp>
 
-namespace
+namespace j1t::hal::aarch64
 {
-    auto store_le_u32(uint8_t *buffer, uint32_t value) -> void
+    auto macro_assembler::set_output(j1t::hal::code_buffer &output_buffer) -> void
     {
-        buffer[0] = static_cast<uint8_t>(value & 0xFFu);
-        buffer[1] = static_cast<uint8_t>((value >> 8u) & 0xFFu);
-        buffer[2] = static_cast<uint8_t>((value >> 16u) & 0xFFu);
-        buffer[3] = static_cast<uint8_t>((value >> 24u) & 0xFFu);
+        output_buffer_internal = &output_buffer;
+        output_buffer_internal->clear();
+        program_counter = 0u;
+        label_states.clear();
+        branch_patches.clear();
     }
 
-    auto load_le_u32(const uint8_t *pointer) -> uint32_t
+    auto macro_assembler::code_size_bytes(void) const -> uint32_t
     {
-        return static_cast<uint32_t>(pointer[0]) | (static_cast<uint32_t>(pointer[1]) << 8u)
-             | (static_cast<uint32_t>(pointer[2]) << 16u) | (static_cast<uint32_t>(pointer[3]) << 24u);
+        return program_counter;
     }
-}
 
-namespace j1t::hal::aarch64
-{
-    auto macro_assembler::set_output(j1t::hal::executable_memory &output_memory) -> void
+    auto macro_assembler::set_features(const cpu_features &target_features) -> void
     {
-        output_memory_internal = &output_memory;
-        program_counter        = 0u;
-        label_states.clear();
-        branch_patches.clear();
+        features_internal = target_features;
     }
 
-    auto macro_assembler::code_size_bytes(void) const -> uint32_t
+    auto macro_assembler::features(void) const -> cpu_features
     {
-        return program_counter;
+        return features_internal;
     }
 
     auto macro_assembler::emit_u32_instruction(uint32_t instruction) -> void
     {
-        if (output_memory_internal == nullptr)
-        {
-            throw std::runtime_error(
-                "macro_assembler output memory not set before emitting "
-                "instruction"
-            );
-        }
-        if (program_counter + 4u > output_memory_internal->size())
+        if (output_buffer_internal == nullptr)
         {
             throw std::runtime_error(
-                "macro_assembler output memory too small for emitted "
+                "macro_assembler output buffer not set before emitting "
                 "instruction"
             );
         }
 
-        store_le_u32(output_memory_internal->data() + program_counter, instruction);
+        output_buffer_internal->emit_u32_le(instruction);
         program_counter += 4u;
     }
 
@@ -179,6 +167,38 @@ namespace j1t::hal::aarch64
         }
     }
 
+    auto macro_assembler::emit_move_pointer_patchable(uint32_t destination_register, uintptr_t immediate_value) -> uint32_t
+    {
+        const uint32_t offset = program_counter;
+        const auto     value  = static_cast<uint64_t>(immediate_value);
+
+        // MOVZ for bits 0..15, then a MOVK for every other halfword even when
+        // it is zero
+        emit_u32_instruction(0xD280'0000u | (static_cast<uint32_t>(value & 0xFFFFu) << 5u) | (destination_register & 0x1Fu));
+        for (uint32_t hw = 1u; hw < 4u; ++hw)
+        {
+            const auto imm = static_cast<uint32_t>((value >> (16u * hw)) & 0xFFFFu);
+            emit_u32_instruction(0xF280'0000u | (hw << 21u) | (imm << 5u) | (destination_register & 0x1Fu));
+        }
+
+        return offset;
+    }
+
+    auto macro_assembler::patch_move_pointer(code_buffer &code, uint32_t offset, uintptr_t immediate_value) -> void
+    {
+        const auto value = static_cast<uint64_t>(immediate_value);
+
+        // replace imm16 (bits 5..20) of the MOVZ and the three MOVKs
+        for (uint32_t hw = 0u; hw < 4u; ++hw)
+        {
+            const uint32_t address     = offset + hw * 4u;
+            const auto     imm         = static_cast<uint32_t>((value >> (16u * hw)) & 0xFFFFu);
+            const uint32_t instruction = code.read_u32_le(address);
+
+            code.overwrite_u32_le(address, (instruction & ~(0xFFFFu << 5u)) | (imm << 5u));
+        }
+    }
+
     auto macro_assembler::emit_call_register(uint32_t function_register) -> void
     {
         // BLR Xn
@@ -202,25 +222,12 @@ namespace j1t::hal::aarch64
 
     auto macro_assembler::overwrite_u32_instruction(uint32_t program_counter_address, uint32_t instruction) -> void
     {
-        if (output_memory_internal == nullptr)
+        if (output_buffer_internal == nullptr)
         {
             throw std::runtime_error("overwrite: output not set");
         }
 
-        uint8_t *dst       = output_memory_internal->data() + program_counter_address;
-
-        dst[0]             = static_cast<uint8_t>(instruction & 0xFFu);
-        dst[1]             = static_cast<uint8_t>((instruction >> 8u) & 0xFFu);
-        dst[2]             = static_cast<uint8_t>((instruction >> 16u) & 0xFFu);
-        dst[3]             = static_cast<uint8_t>((instruction >> 24u) & 0xFFu);
-
-        uint32_t read_back = static_cast<uint32_t>(dst[0]) | (static_cast<uint32_t>(dst[1]) << 8u)
-                           | (static_cast<uint32_t>(dst[2]) << 16u) | (static_cast<uint32_t>(dst[3]) << 24u);
-
-        if (read_back != instruction)
-        {
-            throw std::runtime_error("overwrite: write did not stick (mapping/protection)");
-        }
+        output_buffer_internal->overwrite_u32_le(program_counter_address, instruction);
     }
 
     auto macro_assembler::create_label(void) -> label
@@ -371,6 +378,58 @@ namespace j1t::hal::aarch64
         emit_u32_instruction(0xB900'0000u | (imm12 << 10u) | ((base_register & 0x1Fu) << 5u) | (source_register & 0x1Fu));
     }
 
+    auto macro_assembler::emit_load_u8_from_base_plus_index(
+        uint32_t destination_register,
+        uint32_t base_register,
+        uint32_t index_register
+    ) -> void
+    {
+        // LDRB wt, [xn, wm, UXTW]
+        emit_u32_instruction(
+            0x3860'4800u | ((index_register & 0x1Fu) << 16u) | ((base_register & 0x1Fu) << 5u)
+            | (destination_register & 0x1Fu)
+        );
+    }
+
+    auto macro_assembler::emit_load_u16_from_base_plus_index(
+        uint32_t destination_register,
+        uint32_t base_register,
+        uint32_t index_register
+    ) -> void
+    {
+        // LDRH wt, [xn, wm, UXTW]
+        emit_u32_instruction(
+            0x7860'4800u | ((index_register & 0x1Fu) << 16u) | ((base_register & 0x1Fu) << 5u)
+            | (destination_register & 0x1Fu)
+        );
+    }
+
+    auto macro_assembler::emit_load_u32_from_base_plus_index(
+        uint32_t destination_register,
+        uint32_t base_register,
+        uint32_t index_register
+    ) -> void
+    {
+        // LDR wt, [xn, wm, UXTW]
+        emit_u32_instruction(
+            0xB860'4800u | ((index_register & 0x1Fu) << 16u) | ((base_register & 0x1Fu) << 5u)
+            | (destination_register & 0x1Fu)
+        );
+    }
+
+    auto macro_assembler::emit_store_u8_from_register_to_base_plus_index(
+        uint32_t source_register,
+        uint32_t base_register,
+        uint32_t index_register
+    ) -> void
+    {
+        // STRB wt, [xn, wm, UXTW]
+        emit_u32_instruction(
+            0x3820'4800u | ((index_register & 0x1Fu) << 16u) | ((base_register & 0x1Fu) << 5u)
+            | (source_register & 0x1Fu)
+        );
+    }
+
     auto macro_assembler::emit_load_pointer_from_base_plus_offset(
         uint32_t destination_register,
         uint32_t base_register,
@@ -485,6 +544,97 @@ namespace j1t::hal::aarch64
         );
     }
 
+    auto macro_assembler::emit_compare_u32_immediate(uint32_t left_register, uint32_t immediate_value) -> void
+    {
+        // CMP wn, #imm12  (alias of SUBS wzr, wn, #imm12)
+        if (immediate_value > 0xFFFu)
+        {
+            throw std::runtime_error("macro_assembler emit_compare_u32_immediate: immediate out of range");
+        }
+
+        emit_u32_instruction(0x7100'001Fu | (immediate_value << 10u) | ((left_register & 0x1Fu) << 5u));
+    }
+
+    auto macro_assembler::emit_negate_u32(uint32_t destination_register) -> void
+    {
+        // NEG wd, wm  (alias: SUB wd, wzr, wm)
+        emit_u32_instruction(0x4B00'03E0u | ((destination_register & 0x1Fu) << 16u) | (destination_register & 0x1Fu));
+    }
+
+    auto macro_assembler::emit_and_u32_register(uint32_t destination_register, uint32_t left_register, uint32_t right_register)
+        -> void
+    {
+        // AND wd, wn, wm
+        emit_u32_instruction(
+            0x0A00'0000u | ((right_register & 0x1Fu) << 16u) | ((left_register & 0x1Fu) << 5u) | (destination_register & 0x1Fu)
+        );
+    }
+
+    auto macro_assembler::emit_shift_right_u32_immediate(uint32_t destination_register, uint32_t source_register, uint32_t shift)
+        -> void
+    {
+        // LSR wd, wn, #shift  (alias: UBFM wd, wn, #shift, #31)
+        if (shift > 31u)
+        {
+            throw std::runtime_error("emit_shift_right_u32_immediate: invalid shift");
+        }
+
+        emit_u32_instruction(
+            0x5300'7C00u | (shift << 16u) | ((source_register & 0x1Fu) << 5u) | (destination_register & 0x1Fu)
+        );
+    }
+
+    auto macro_assembler::emit_shift_right_i32_immediate(uint32_t destination_register, uint32_t source_register, uint32_t shift)
+        -> void
+    {
+        // ASR wd, wn, #shift  (alias: SBFM wd, wn, #shift, #31)
+        if (shift > 31u)
+        {
+            throw std::runtime_error("emit_shift_right_i32_immediate: invalid shift");
+        }
+
+        emit_u32_instruction(
+            0x1300'7C00u | (shift << 16u) | ((source_register & 0x1Fu) << 5u) | (destination_register & 0x1Fu)
+        );
+    }
+
+    auto macro_assembler::emit_add_shifted_u32_register(
+        uint32_t destination_register,
+        uint32_t left_register,
+        uint32_t right_register,
+        uint32_t shift
+    ) -> void
+    {
+        // ADD wd, wn, wm, LSL #shift
+        if (shift > 31u)
+        {
+            throw std::runtime_error("emit_add_shifted_u32_register: invalid shift");
+        }
+
+        emit_u32_instruction(
+            0x0B00'0000u | ((right_register & 0x1Fu) << 16u) | (shift << 10u) | ((left_register & 0x1Fu) << 5u)
+            | (destination_register & 0x1Fu)
+        );
+    }
+
+    auto macro_assembler::emit_multiply_high_i32_register(
+        uint32_t destination_register,
+        uint32_t left_register,
+        uint32_t right_register
+    ) -> void
+    {
+        // SMULL xd, wn, wm  (alias: SMADDL xd, wn, wm, xzr)
+        emit_u32_instruction(
+            0x9B20'7C00u | ((right_register & 0x1Fu) << 16u) | ((left_register & 0x1Fu) << 5u)
+            | (destination_register & 0x1Fu)
+        );
+
+        // ASR xd, xd, #32  (alias: SBFM xd, xd, #32, #63)
+        emit_u32_instruction(
+            0x9340'FC00u | (32u << 16u) | ((destination_register & 0x1Fu) << 5u) | (destination_register & 0x1Fu)
+        );
+    }
+
     auto macro_assembler::emit_return(void) -> void
     {
         // RET
@@ -508,11 +658,11 @@ namespace j1t::hal::aarch64
 
     auto macro_assembler::debug_output_base(void) const -> const uint8_t *
     {
-        if (output_memory_internal == nullptr)
+        if (output_buffer_internal == nullptr)
         {
             return nullptr;
         }
-        return output_memory_internal->data();
+        return output_buffer_internal->data();
     }
 
     auto macro_assembler::finalize(void) -> void
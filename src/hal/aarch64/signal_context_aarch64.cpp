@@ -0,0 +1,26 @@
+#include <hal/interface/linear_memory.hpp>
+
+#include <ucontext.h>
+
+namespace j1t::hal
+{
+    auto signal_program_counter(const void *signal_context) -> uintptr_t
+    {
+        const auto *context = static_cast<const ucontext_t *>(signal_context);
+#if defined(__APPLE__)
+        return static_cast<uintptr_t>(context->uc_mcontext->__ss.__pc);
+#else
+        return static_cast<uintptr_t>(context->uc_mcontext.pc);
+#endif
+    }
+
+    auto set_signal_program_counter(void *signal_context, uintptr_t program_counter) -> void
+    {
+        auto *context = static_cast<ucontext_t *>(signal_context);
+#if defined(__APPLE__)
+        context->uc_mcontext->__ss.__pc = program_counter;
+#else
+        context->uc_mcontext.pc = program_counter;
+#endif
+    }
+}
@@ -0,0 +1,106 @@
+#include <hal/interface/basic_blocks.hpp>
+
+#include <vm/verifier.hpp>
+
+#include <algorithm>
+#include <string.h>
+
+namespace j1t::hal
+{
+    auto find_basic_blocks(const std::vector<uint8_t> &code) -> std::vector<basic_block>
+    {
+        const uint32_t code_size = static_cast<uint32_t>(code.size());
+
+        // opcode boundaries, and where a new block must start
+        std::vector<bool> is_boundary(code_size + 1u, false);
+        std::vector<bool> is_leader(code_size + 1u, false);
+        std::vector<uint32_t> jump_targets;
+
+        uint32_t end_pc = 0;
+        while (end_pc < code_size)
+        {
+            const uint32_t        opcode_pc = end_pc;
+            const j1t::vm::opcode op        = static_cast<j1t::vm::opcode>(code[end_pc]);
+            const uint32_t        size      = j1t::vm::is_valid_opcode(code[end_pc]) ? 1u + j1t::vm::immediate_size(op) : 1u;
+            is_boundary[opcode_pc] = true;
+            if (size > code_size - opcode_pc)
+            {
+                // kept in the last block so the backend still sees it
+                end_pc = code_size;
+                break;
+            }
+
+            end_pc += size;
+
+            if (j1t::vm::is_valid_opcode(code[opcode_pc]) && j1t::vm::is_jump(op))
+            {
+                uint32_t rel;
+                memcpy(&rel, &code[opcode_pc + 1u], sizeof(rel));
+
+                const int64_t target_pc = static_cast<int64_t>(opcode_pc) + static_cast<int32_t>(rel);
+                if (target_pc >= 0 && target_pc <= static_cast<int64_t>(code_size))
+                {
+                    jump_targets.push_back(static_cast<uint32_t>(target_pc));
+                }
+                is_leader[end_pc] = true;
+            }
+            else if (op == j1t::vm::opcode::RET)
+            {
+                is_leader[end_pc] = true;
+            }
+        }
+        is_boundary[end_pc] = true;
+
+        for (uint32_t target_pc : jump_targets)
+        {
+            if (is_boundary[target_pc])
+            {
+                is_leader[target_pc] = true;
+            }
+        }
+
+        std::vector<basic_block> blocks;
+        basic_block              current {};
+        int64_t                  depth = 0;
+
+        for (uint32_t pc = 0; pc < end_pc;)
+        {
+            if (pc != current.begin_pc && is_leader[pc])
+            {
+                current.end_pc = pc;
+                blocks.push_back(current);
+
+                current = basic_block { .begin_pc = pc };
+                depth   = 0;
+            }
+
+            const uint8_t raw = code[pc];
+            if (j1t::vm::is_valid_opcode(raw))
+            {
+                const j1t::vm::opcode       op     = static_cast<j1t::vm::opcode>(raw);
+                const j1t::vm::stack_effect effect = j1t::vm::stack_effect_of(op);
+
+                depth            -= effect.pops;
+                current.max_pop   = static_cast<uint32_t>(std::max<int64_t>(current.max_pop, -depth));
+                depth            += effect.pushes;
+                current.max_push  = static_cast<uint32_t>(std::max<int64_t>(current.max_push, depth));
+
+                current.falls_through = op != j1t::vm::opcode::JUMP && op != j1t::vm::opcode::RET;
+                pc                   += 1u + j1t::vm::immediate_size(op);
+            }
+            else
+            {
+                current.falls_through = true;
+                pc                   += 1u;
+            }
+        }
+
+        if (end_pc != current.begin_pc)
+        {
+            current.end_pc = end_pc;
+            blocks.push_back(current);
+        }
+
+        return blocks;
+    }
+}
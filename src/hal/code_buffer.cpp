@@ -0,0 +1,115 @@
+#include <hal/interface/code_buffer.hpp>
+#include <hal/interface/code_heap.hpp>
+#include <hal/interface/icache.hpp>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace j1t::hal
+{
+    auto code_buffer::data(void) -> uint8_t *
+    {
+        return bytes.data();
+    }
+
+    auto code_buffer::data(void) const -> const uint8_t *
+    {
+        return bytes.data();
+    }
+
+    auto code_buffer::size(void) const -> uint32_t
+    {
+        return static_cast<uint32_t>(bytes.size());
+    }
+
+    auto code_buffer::clear(void) -> void
+    {
+        bytes.clear();
+    }
+
+    auto code_buffer::reserve(uint32_t capacity) -> void
+    {
+        bytes.reserve(capacity);
+    }
+
+    auto code_buffer::emit_u8(uint8_t value) -> void
+    {
+        if (bytes.size() >= UINT32_MAX)
+        {
+            throw std::runtime_error("code_buffer: code too large");
+        }
+
+        bytes.push_back(value);
+    }
+
+    auto code_buffer::emit_u32_le(uint32_t value) -> void
+    {
+        emit_u8(static_cast<uint8_t>(value & 0xFFu));
+        emit_u8(static_cast<uint8_t>((value >> 8u) & 0xFFu));
+        emit_u8(static_cast<uint8_t>((value >> 16u) & 0xFFu));
+        emit_u8(static_cast<uint8_t>((value >> 24u) & 0xFFu));
+    }
+
+    auto code_buffer::emit_bytes(const uint8_t *source, uint32_t size) -> void
+    {
+        if (static_cast<uint64_t>(bytes.size()) + size > UINT32_MAX)
+        {
+            throw std::runtime_error("code_buffer: code too large");
+        }
+
+        bytes.insert(bytes.end(), source, source + size);
+    }
+
+    auto code_buffer::overwrite_u8(uint32_t offset, uint8_t value) -> void
+    {
+        if (offset >= bytes.size())
+        {
+            throw std::runtime_error("code_buffer overwrite: offset out of range");
+        }
+
+        bytes[offset] = value;
+    }
+
+    auto code_buffer::overwrite_u32_le(uint32_t offset, uint32_t value) -> void
+    {
+        if (static_cast<uint64_t>(offset) + 4u > bytes.size())
+        {
+            throw std::runtime_error("code_buffer overwrite: offset out of range");
+        }
+
+        bytes[offset + 0u] = static_cast<uint8_t>(value & 0xFFu);
+        bytes[offset + 1u] = static_cast<uint8_t>((value >> 8u) & 0xFFu);
+        bytes[offset + 2u] = static_cast<uint8_t>((value >> 16u) & 0xFFu);
+        bytes[offset + 3u] = static_cast<uint8_t>((value >> 24u) & 0xFFu);
+    }
+
+    auto code_buffer::read_u32_le(uint32_t offset) const -> uint32_t
+    {
+        if (static_cast<uint64_t>(offset) + 4u > bytes.size())
+        {
+            throw std::runtime_error("code_buffer read: offset out of range");
+        }
+
+        return static_cast<uint32_t>(bytes[offset]) | (static_cast<uint32_t>(bytes[offset + 1u]) << 8u)
+             | (static_cast<uint32_t>(bytes[offset + 2u]) << 16u) | (static_cast<uint32_t>(bytes[offset + 3u]) << 24u);
+    }
+
+    auto install_code(const code_buffer &buffer) -> std::unique_ptr<executable_memory>
+    {
+        if (buffer.size() == 0u)
+        {
+            throw std::runtime_error("install_code: empty code buffer");
+        }
+
+        auto memory = code_heap::shared().allocate(buffer.size());
+
+        memory->begin_write();
+        std::memcpy(memory->data(), buffer.data(), buffer.size());
+        memory->end_write();
+
+        flush_instruction_cache(memory->executable_data(), buffer.size());
+        memory->finalize();
+
+        return memory;
+    }
+}
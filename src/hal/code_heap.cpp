@@ -0,0 +1,380 @@
+#include <hal/interface/code_heap.hpp>
+
+#include <bit>
+#include <stdexcept>
+
+namespace
+{
+    auto shared_heap_options(void) -> j1t::hal::code_heap::options &
+    {
+        static j1t::hal::code_heap::options heap_options {};
+        return heap_options;
+    }
+
+    auto is_shared_heap_created(void) -> bool &
+    {
+        static bool is_created { false };
+        return is_created;
+    }
+}
+
+namespace j1t::hal
+{
+    class code_heap::chunk final : public executable_memory
+    {
+      public:
+        chunk(
+            code_heap     &owner,
+            uint32_t       region_index,
+            uintmax_t      offset,
+            uint32_t       size_class,
+            uintmax_t      requested_size,
+            uint8_t       *writable,
+            const uint8_t *executable
+        )
+            : owner_internal(owner)
+            , region_index_internal(region_index)
+            , offset_internal(offset)
+            , size_class_internal(size_class)
+            , requested_size_internal(requested_size)
+            , writable_internal(writable)
+            , executable_internal(executable)
+        {
+        }
+
+        chunk(code_heap &owner, std::unique_ptr<executable_memory> dedicated, uintmax_t requested_size)
+            : owner_internal(owner)
+            , region_index_internal(DEDICATED_REGION)
+            , requested_size_internal(requested_size)
+            , writable_internal(dedicated->data())
+            , executable_internal(dedicated->executable_data())
+            , dedicated_internal(std::move(dedicated))
+        {
+        }
+
+        ~chunk(void) override
+        {
+            end_write();
+
+            if (dedicated_internal != nullptr)
+            {
+                owner_internal.release_dedicated(dedicated_internal->size(), requested_size_internal);
+                return;
+            }
+
+            owner_internal.release(region_index_internal, offset_internal, size_class_internal, requested_size_internal);
+        }
+
+        auto data(void) -> uint8_t * override
+        {
+            return writable_internal;
+        }
+
+        auto executable_data(void) const -> const uint8_t * override
+        {
+            return executable_internal;
+        }
+
+        auto size(void) const -> uintmax_t override
+        {
+            return dedicated_internal != nullptr ? dedicated_internal->size() : size_of_class(size_class_internal);
+        }
+
+        auto begin_write(void) -> void override
+        {
+            if (is_writing)
+            {
+                return;
+            }
+
+            if (dedicated_internal != nullptr)
+            {
+                dedicated_internal->begin_write();
+            }
+            else
+            {
+                owner_internal.begin_write(region_index_internal);
+            }
+            is_writing = true;
+        }
+
+        auto end_write(void) -> void override
+        {
+            if (!is_writing)
+            {
+                return;
+            }
+
+            if (dedicated_internal != nullptr)
+            {
+                dedicated_internal->end_write();
+            }
+            else
+            {
+                owner_internal.end_write(region_index_internal);
+            }
+            is_writing = false;
+        }
+
+        auto is_executable_while_writing(void) const -> bool override
+        {
+            if (dedicated_internal != nullptr)
+            {
+                return dedicated_internal->is_executable_while_writing();
+            }
+
+            return owner_internal.is_executable_while_writing();
+        }
+
+        auto finalize(void) -> void override
+        {
+            end_write();
+        }
+
+      private:
+        code_heap                         &owner_internal;
+        uint32_t                           region_index_internal { 0 };
+        uintmax_t                          offset_internal { 0 };
+        uint32_t                           size_class_internal { 0 };
+        uintmax_t                          requested_size_internal { 0 };
+        uint8_t                           *writable_internal { nullptr };
+        const uint8_t                     *executable_internal { nullptr };
+        std::unique_ptr<executable_memory> dedicated_internal;
+        bool                               is_writing { false };
+    };
+
+    auto code_heap::statistics::occupancy(void) const -> double
+    {
+        if (reserved_bytes == 0u)
+        {
+            return 0.0;
+        }
+        return static_cast<double>(requested_bytes) / static_cast<double>(reserved_bytes);
+    }
+
+    auto code_heap::statistics::internal_fragmentation(void) const -> double
+    {
+        if (allocated_bytes == 0u)
+        {
+            return 0.0;
+        }
+        return static_cast<double>(allocated_bytes - requested_bytes) / static_cast<double>(allocated_bytes);
+    }
+
+    auto code_heap::statistics::external_fragmentation(void) const -> double
+    {
+        if (allocated_bytes + free_bytes == 0u)
+        {
+            return 0.0;
+        }
+        return static_cast<double>(free_bytes) / static_cast<double>(allocated_bytes + free_bytes);
+    }
+
+    code_heap::code_heap(options heap_options)
+        : heap_options_internal(heap_options)
+    {
+        if (heap_options_internal.region_size < MAX_POOLED_SIZE)
+        {
+            heap_options_internal.region_size = MAX_POOLED_SIZE;
+        }
+    }
+
+    code_heap::~code_heap(void) = default;
+
+    auto code_heap::shared(void) -> code_heap &
+    {
+        // intentionally leaked
+        static code_heap *heap = []
+        {
+            is_shared_heap_created() = true;
+            return new code_heap(shared_heap_options());
+        }();
+        return *heap;
+    }
+
+    auto code_heap::configure_shared(options heap_options) -> void
+    {
+        if (is_shared_heap_created())
+        {
+            throw std::runtime_error("code_heap: shared heap already in use");
+        }
+        shared_heap_options() = heap_options;
+    }
+
+    auto code_heap::size_class_of(uintmax_t size) -> uint32_t
+    {
+        uintmax_t rounded = std::bit_ceil(size < MIN_CHUNK_SIZE ? MIN_CHUNK_SIZE : size);
+        return static_cast<uint32_t>(std::countr_zero(rounded) - std::countr_zero(MIN_CHUNK_SIZE));
+    }
+
+    auto code_heap::size_of_class(uint32_t size_class) -> uintmax_t
+    {
+        return MIN_CHUNK_SIZE << size_class;
+    }
+
+    auto code_heap::allocate(uintmax_t size) -> std::unique_ptr<executable_memory>
+    {
+        if (size == 0u)
+        {
+            throw std::runtime_error("code_heap: zero-sized allocation");
+        }
+
+        if (size > MAX_POOLED_SIZE)
+        {
+            auto memory = make_native_executable_memory(size, heap_options_internal.prefer_huge_pages);
+            // same initial state as pooled chunks: executable, not writable
+            memory->finalize();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_internal);
+                counters.reserved_bytes += memory->size();
+                counters.allocated_bytes += memory->size();
+                counters.requested_bytes += size;
+                counters.live_chunks += 1u;
+            }
+
+            return std::make_unique<chunk>(*this, std::move(memory), size);
+        }
+
+        const uint32_t  size_class = size_class_of(size);
+        const uintmax_t chunk_size = size_of_class(size_class);
+
+        std::lock_guard<std::mutex> lock(mutex_internal);
+
+        free_chunk selected {};
+        if (!free_lists[size_class].empty())
+        {
+            selected = free_lists[size_class].back();
+            free_lists[size_class].pop_back();
+            counters.free_bytes -= chunk_size;
+        }
+        else
+        {
+            if (regions.empty() || regions.back().bump_offset + chunk_size > regions.back().memory->size())
+            {
+                if (!regions.empty())
+                {
+                    retire_region_tail(regions.back(), static_cast<uint32_t>(regions.size() - 1u));
+                }
+                add_region();
+            }
+
+            region &current = regions.back();
+            selected        = free_chunk { static_cast<uint32_t>(regions.size() - 1u), current.bump_offset };
+            current.bump_offset += chunk_size;
+        }
+
+        counters.allocated_bytes += chunk_size;
+        counters.requested_bytes += size;
+        counters.live_chunks += 1u;
+
+        region &owner_region = regions[selected.region_index];
+        return std::make_unique<chunk>(
+            *this,
+            selected.region_index,
+            selected.offset,
+            size_class,
+            size,
+            owner_region.memory->data() + selected.offset,
+            owner_region.memory->executable_data() + selected.offset
+        );
+    }
+
+    auto code_heap::is_executable_while_writing(void) -> bool
+    {
+        std::lock_guard<std::mutex> lock(mutex_internal);
+
+        // every region comes from make_native_executable_memory(), so the
+        // first one speaks for all of them
+        if (regions.empty())
+        {
+            add_region();
+        }
+
+        return regions.front().memory->is_executable_while_writing();
+    }
+
+    auto code_heap::stats(void) const -> statistics
+    {
+        std::lock_guard<std::mutex> lock(mutex_internal);
+        return counters;
+    }
+
+    auto code_heap::add_region(void) -> void
+    {
+        auto memory = make_native_executable_memory(heap_options_internal.region_size, heap_options_internal.prefer_huge_pages);
+        memory->finalize();
+
+        counters.reserved_bytes += memory->size();
+        counters.region_count += 1u;
+        regions.push_back(region { std::move(memory), 0u });
+    }
+
+    auto code_heap::retire_region_tail(region &target_region, uint32_t region_index) -> void
+    {
+        // hand whatever the bump allocator cannot use any more to the free
+        // lists, largest classes first; offsets stay MIN_CHUNK_SIZE aligned
+        uintmax_t remaining = target_region.memory->size() - target_region.bump_offset;
+        for (uint32_t size_class = SIZE_CLASS_COUNT; size_class-- > 0u;)
+        {
+            const uintmax_t chunk_size = size_of_class(size_class);
+            while (remaining >= chunk_size)
+            {
+                free_lists[size_class].push_back(free_chunk { region_index, target_region.bump_offset });
+                target_region.bump_offset += chunk_size;
+                remaining -= chunk_size;
+                counters.free_bytes += chunk_size;
+            }
+        }
+    }
+
+    auto code_heap::release(uint32_t region_index, uintmax_t offset, uint32_t size_class, uintmax_t requested_size) -> void
+    {
+        std::lock_guard<std::mutex> lock(mutex_internal);
+
+        const uintmax_t chunk_size = size_of_class(size_class);
+        free_lists[size_class].push_back(free_chunk { region_index, offset });
+
+        counters.free_bytes += chunk_size;
+        counters.allocated_bytes -= chunk_size;
+        counters.requested_bytes -= requested_size;
+        counters.live_chunks -= 1u;
+    }
+
+    auto code_heap::release_dedicated(uintmax_t reserved_size, uintmax_t requested_size) -> void
+    {
+        std::lock_guard<std::mutex> lock(mutex_internal);
+
+        counters.reserved_bytes -= reserved_size;
+        counters.allocated_bytes -= reserved_size;
+        counters.requested_bytes -= requested_size;
+        counters.live_chunks -= 1u;
+    }
+
+    auto code_heap::begin_write(uint32_t region_index) -> void
+    {
+        std::unique_lock<std::mutex> write_lock(write_mutex_internal);
+
+        executable_memory *memory = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_internal);
+            memory = regions[region_index].memory.get();
+        }
+        memory->begin_write();
+
+        // stays locked until end_write()
+        write_lock.release();
+    }
+
+    auto code_heap::end_write(uint32_t region_index) -> void
+    {
+        std::unique_lock<std::mutex> write_lock(write_mutex_internal, std::adopt_lock);
+
+        executable_memory *memory = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_internal);
+            memory = regions[region_index].memory.get();
+        }
+        memory->end_write();
+    }
+}
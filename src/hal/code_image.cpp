@@ -0,0 +1,43 @@
+#include <hal/interface/code_image.hpp>
+
+namespace j1t::hal
+{
+    auto is_well_formed(const code_image &image, uint32_t site_size) -> bool
+    {
+        const uint64_t code_size = image.code.size();
+        if (code_size == 0u || code_size > UINT32_MAX)
+        {
+            return false;
+        }
+
+        if (image.entry_points.empty() || image.entry_points.front().pc != 0u || image.entry_points.front().offset != 0u)
+        {
+            return false;
+        }
+
+        if (image.memory_fault_offset >= code_size)
+        {
+            return false;
+        }
+
+        for (std::size_t i = 0; i < image.entry_points.size(); ++i)
+        {
+            const entry_point &point = image.entry_points[i];
+            if (point.offset >= code_size || (i != 0u && point.pc <= image.entry_points[i - 1u].pc))
+            {
+                return false;
+            }
+        }
+
+        for (const relocation &site : image.relocations)
+        {
+            if (static_cast<uint64_t>(site.offset) + site_size > code_size
+                || static_cast<uint32_t>(site.target) >= static_cast<uint32_t>(relocation_target::COUNT))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,76 @@
+#include <hal/interface/division_by_constant.hpp>
+
+#include <stdexcept>
+
+namespace j1t::hal
+{
+    auto signed_division_magic_of(int32_t divisor) -> signed_division_magic
+    {
+        if (divisor >= -1 && divisor <= 1)
+        {
+            throw std::runtime_error("signed_division_magic_of: divisor must not be -1, 0 or 1");
+        }
+
+        constexpr uint32_t TWO_31 = 0x80000000u;
+
+        // |divisor|, and |nc|, the largest dividend magnitude for which
+        // n rem |divisor| == |divisor| - 1
+        const uint32_t absolute_divisor = divisor < 0 ? 0u - static_cast<uint32_t>(divisor) : static_cast<uint32_t>(divisor);
+        const uint32_t t                = TWO_31 + (static_cast<uint32_t>(divisor) >> 31u);
+        const uint32_t absolute_nc      = t - 1u - t % absolute_divisor;
+
+        // the smallest p >= 32 with 2^p > nc * (|divisor| - 2^p rem |divisor|)
+        uint32_t p          = 31u;
+        uint32_t quotient1  = TWO_31 / absolute_nc;
+        uint32_t remainder1 = TWO_31 - quotient1 * absolute_nc;
+        uint32_t quotient2  = TWO_31 / absolute_divisor;
+        uint32_t remainder2 = TWO_31 - quotient2 * absolute_divisor;
+        uint32_t delta      = 0u;
+
+        do
+        {
+            p          += 1u;
+
+            quotient1  *= 2u;
+            remainder1 *= 2u;
+            if (remainder1 >= absolute_nc)
+            {
+                quotient1  += 1u;
+                remainder1 -= absolute_nc;
+            }
+
+            quotient2  *= 2u;
+            remainder2 *= 2u;
+            if (remainder2 >= absolute_divisor)
+            {
+                quotient2  += 1u;
+                remainder2 -= absolute_divisor;
+            }
+
+            delta = absolute_divisor - remainder2;
+        } while (quotient1 < delta || (quotient1 == delta && remainder1 == 0u));
+
+        uint32_t magic = quotient2 + 1u;
+        if (divisor < 0)
+        {
+            magic = 0u - magic;
+        }
+
+        signed_division_magic result {};
+        result.multiplier = static_cast<int32_t>(magic);
+        result.shift      = p - 32u;
+
+        // the multiplier wrapped into the wrong sign: the multiply-high
+        // was off by exactly n
+        if (divisor > 0 && result.multiplier < 0)
+        {
+            result.dividend_sign = 1;
+        }
+        else if (divisor < 0 && result.multiplier > 0)
+        {
+            result.dividend_sign = -1;
+        }
+
+        return result;
+    }
+}
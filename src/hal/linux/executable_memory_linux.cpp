@@ -0,0 +1,201 @@
+#include <hal/linux/executable_memory_linux.hpp>
+
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+    auto round_up_to_page_size(uintmax_t size) -> uintmax_t
+    {
+        auto      page      = ::sysconf(_SC_PAGESIZE);
+        uintmax_t page_size = static_cast<uintmax_t>(page > 0 ? page : 4096);
+        return (size + (page_size - 1u)) & ~(page_size - 1);
+    }
+
+    // default hugetlbfs page size on x86-64 and 4K-granule aarch64
+    constexpr uintmax_t HUGE_PAGE_SIZE { 2u * 1024u * 1024u };
+
+    auto round_up_to_huge_page_size(uintmax_t size) -> uintmax_t
+    {
+        return (size + (HUGE_PAGE_SIZE - 1u)) & ~(HUGE_PAGE_SIZE - 1u);
+    }
+}
+
+namespace j1t::hal::linux_os
+{
+    executable_memory_linux::executable_memory_linux(uintmax_t size, bool prefer_huge_pages)
+        : size_internal(::round_up_to_page_size(size))
+    {
+        if (prefer_huge_pages && map_dual(MFD_CLOEXEC | MFD_HUGETLB, ::round_up_to_huge_page_size(size)))
+        {
+            is_hugetlb = true;
+            return;
+        }
+
+        if (!map_dual(MFD_CLOEXEC, size_internal))
+        {
+            map_single();
+        }
+
+        if (prefer_huge_pages)
+        {
+            advise_huge_pages();
+        }
+    }
+
+    executable_memory_linux::~executable_memory_linux(void)
+    {
+        if (writable_memory_internal == nullptr)
+        {
+            return;
+        }
+
+        if (executable_memory_internal != writable_memory_internal)
+        {
+            ::munmap(executable_memory_internal, size_internal);
+        }
+        ::munmap(writable_memory_internal, size_internal);
+    }
+
+    auto executable_memory_linux::map_dual(unsigned int memfd_flags, uintmax_t mapping_size) -> bool
+    {
+        int fd = ::memfd_create("j1t-jit", memfd_flags);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        if (::ftruncate(fd, static_cast<off_t>(mapping_size)) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+
+        void *rw = ::mmap(NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (rw == MAP_FAILED)
+        {
+            ::close(fd);
+            return false;
+        }
+
+        void *rx = ::mmap(NULL, mapping_size, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+        // both views keep the file alive
+        ::close(fd);
+
+        if (rx == MAP_FAILED)
+        {
+            ::munmap(rw, mapping_size);
+            return false;
+        }
+
+        writable_memory_internal   = static_cast<uint8_t *>(rw);
+        executable_memory_internal = static_cast<uint8_t *>(rx);
+        size_internal              = mapping_size;
+        return true;
+    }
+
+    auto executable_memory_linux::map_single(void) -> void
+    {
+        // W^X: the mapping starts writable and is flipped to executable in
+        // end_write()
+        static constexpr auto protect_flag = PROT_READ | PROT_WRITE;
+        static constexpr auto flags        = MAP_ANONYMOUS | MAP_PRIVATE;
+
+        void *ptr = ::mmap(NULL, size_internal, protect_flag, flags, -1, 0);
+        if (ptr == MAP_FAILED)
+        {
+            throw std::runtime_error("mmap failed in executable_memory_linux");
+        }
+
+        writable_memory_internal   = static_cast<uint8_t *>(ptr);
+        executable_memory_internal = writable_memory_internal;
+    }
+
+    auto executable_memory_linux::advise_huge_pages(void) -> void
+    {
+        // best effort: only effective when THP is enabled for anonymous or
+        // shmem memory and the mapping spans at least one aligned huge page
+        ::madvise(writable_memory_internal, size_internal, MADV_HUGEPAGE);
+        if (is_dual_mapped())
+        {
+            ::madvise(executable_memory_internal, size_internal, MADV_HUGEPAGE);
+        }
+    }
+
+    auto executable_memory_linux::is_hugetlb_backed(void) const -> bool
+    {
+        return is_hugetlb;
+    }
+
+    auto executable_memory_linux::is_dual_mapped(void) const -> bool
+    {
+        return executable_memory_internal != writable_memory_internal;
+    }
+
+    auto executable_memory_linux::data(void) -> uint8_t *
+    {
+        return writable_memory_internal;
+    }
+
+    auto executable_memory_linux::executable_data(void) const -> const uint8_t *
+    {
+        return executable_memory_internal;
+    }
+
+    auto executable_memory_linux::size(void) const -> uintmax_t
+    {
+        return size_internal;
+    }
+
+    auto executable_memory_linux::begin_write(void) -> void
+    {
+        // dual mapping: the RW view is always writable
+        if (is_dual_mapped() || is_writable)
+        {
+            return;
+        }
+
+        if (::mprotect(writable_memory_internal, size_internal, PROT_READ | PROT_WRITE) != 0)
+        {
+            throw std::runtime_error("mprotect(RW) failed in executable_memory_linux");
+        }
+
+        is_writable = true;
+    }
+
+    auto executable_memory_linux::is_executable_while_writing(void) const -> bool
+    {
+        // the single mapping is not executable while it is writable
+        return is_dual_mapped();
+    }
+
+    auto executable_memory_linux::end_write(void) -> void
+    {
+        // dual mapping: the RX view is always executable
+        if (is_dual_mapped() || !is_writable)
+        {
+            return;
+        }
+
+        if (::mprotect(writable_memory_internal, size_internal, PROT_READ | PROT_EXEC) != 0)
+        {
+            throw std::runtime_error("mprotect(RX) failed in executable_memory_linux");
+        }
+
+        is_writable = false;
+    }
+
+    auto executable_memory_linux::finalize(void) -> void
+    {
+        end_write();
+    }
+}
+
+namespace j1t::hal
+{
+    auto make_native_executable_memory(uintmax_t size, bool prefer_huge_pages) -> std::unique_ptr<executable_memory>
+    {
+        return std::make_unique<j1t::hal::linux_os::executable_memory_linux>(size, prefer_huge_pages);
+    }
+}
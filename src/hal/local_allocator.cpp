@@ -0,0 +1,93 @@
+#include <hal/interface/local_allocator.hpp>
+
+#include <vm/decoder.hpp>
+#include <vm/interpreter.hpp>
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace j1t::hal
+{
+    auto allocate_local_registers(const j1t::vm::program &target_program, std::span<const uint32_t> registers)
+        -> std::vector<local_register>
+    {
+        // nesting past this adds nothing to the ranking
+        static constexpr uint32_t MAX_COUNTED_DEPTH = 8u;
+
+        // unfused: superinstructions hide the LOCAL_* ops they start with
+        const j1t::vm::decoded_program decoded = j1t::vm::decode(target_program);
+        if (!decoded.is_linear || registers.empty())
+        {
+            return {};
+        }
+
+        // a backward jump from the end of a loop to its header; the loop is
+        // the instructions in between
+        struct loop_range
+        {
+            uint32_t header { 0 };
+            uint32_t latch { 0 };
+        };
+
+        std::vector<loop_range> loops;
+        for (std::size_t i = 0; i < decoded.instructions.size(); ++i)
+        {
+            const j1t::vm::instruction &record = decoded.instructions[i];
+            if (!j1t::vm::is_valid_opcode(record.op) || !j1t::vm::is_jump(static_cast<j1t::vm::opcode>(record.op))
+                || record.target >= decoded.instructions.size() || record.target > i)
+            {
+                continue;
+            }
+
+            loops.push_back({ .header = record.target, .latch = static_cast<uint32_t>(i) });
+        }
+
+        if (loops.empty())
+        {
+            return {};
+        }
+
+        std::unordered_map<uint32_t, uint64_t> weights;
+        for (std::size_t i = 0; i < decoded.instructions.size(); ++i)
+        {
+            const j1t::vm::instruction &record = decoded.instructions[i];
+            if (record.op != j1t::vm::op_to_raw(j1t::vm::opcode::LOCAL_GET)
+                && record.op != j1t::vm::op_to_raw(j1t::vm::opcode::LOCAL_SET))
+            {
+                continue;
+            }
+
+            uint32_t depth = 0;
+            for (const loop_range &loop : loops)
+            {
+                if (loop.header <= i && i <= loop.latch)
+                {
+                    ++depth;
+                }
+            }
+
+            if (depth != 0u)
+            {
+                weights[record.immediate] += uint64_t { 1 } << (3u * std::min(depth, MAX_COUNTED_DEPTH));
+            }
+        }
+
+        std::vector<std::pair<uint32_t, uint64_t>> ranked(weights.begin(), weights.end());
+        std::sort(
+            ranked.begin(),
+            ranked.end(),
+            [](const auto &left, const auto &right)
+            {
+                return left.second != right.second ? left.second > right.second : left.first < right.first;
+            }
+        );
+
+        std::vector<local_register> assignment;
+        for (std::size_t i = 0; i < ranked.size() && i < registers.size(); ++i)
+        {
+            assignment.push_back({ .local_index = ranked[i].first, .machine_register = registers[i] });
+        }
+
+        return assignment;
+    }
+}
@@ -0,0 +1,192 @@
+#include <hal/interface/operand_stack_cache.hpp>
+
+#include <stdexcept>
+
+namespace j1t::hal
+{
+    operand_stack_cache::operand_stack_cache(
+        macro_assembler          &assembler,
+        uint32_t                  stack_top_register,
+        uint32_t                  scratch_register,
+        std::span<const uint32_t> cache_registers
+    )
+        : assembler_internal(assembler)
+        , stack_top_register_internal(stack_top_register)
+        , scratch_register_internal(scratch_register)
+        , free_registers(cache_registers.rbegin(), cache_registers.rend())
+    {
+    }
+
+    auto operand_stack_cache::allocate(void) -> uint32_t
+    {
+        if (free_registers.empty())
+        {
+            // spill up to and including the lowest register entry; the
+            // constants below it have to go first to keep memory contiguous
+            std::size_t lowest = 0;
+            while (lowest < entries.size() && entries[lowest].is_constant)
+            {
+                ++lowest;
+            }
+
+            if (lowest == entries.size())
+            {
+                throw std::runtime_error("operand_stack_cache: out of registers");
+            }
+
+            spill_lowest(lowest + 1u);
+        }
+
+        uint32_t cache_register = free_registers.back();
+        free_registers.pop_back();
+        return cache_register;
+    }
+
+    auto operand_stack_cache::release(uint32_t cache_register) -> void
+    {
+        free_registers.push_back(cache_register);
+    }
+
+    auto operand_stack_cache::push_register(uint32_t cache_register) -> void
+    {
+        make_room();
+        entries.push_back(entry { .is_constant = false, .cache_register = cache_register, .value = 0u });
+    }
+
+    auto operand_stack_cache::push_constant(uint32_t value) -> void
+    {
+        make_room();
+        entries.push_back(entry { .is_constant = true, .cache_register = 0u, .value = value });
+    }
+
+    auto operand_stack_cache::pop_to_register(void) -> uint32_t
+    {
+        if (entries.empty())
+        {
+            uint32_t cache_register = allocate();
+            assembler_internal.emit_subtract_immediate_from_pointer(stack_top_register_internal, stack_top_register_internal, 4u);
+            assembler_internal.emit_load_u32_from_base_plus_offset(cache_register, stack_top_register_internal, 0);
+            return cache_register;
+        }
+
+        const entry top = entries.back();
+        entries.pop_back();
+
+        if (!top.is_constant)
+        {
+            return top.cache_register;
+        }
+
+        uint32_t cache_register = allocate();
+        assembler_internal.emit_move_immediate_u32(cache_register, top.value);
+        return cache_register;
+    }
+
+    auto operand_stack_cache::pop_into(uint32_t destination_register) -> void
+    {
+        if (entries.empty())
+        {
+            assembler_internal.emit_subtract_immediate_from_pointer(stack_top_register_internal, stack_top_register_internal, 4u);
+            assembler_internal.emit_load_u32_from_base_plus_offset(destination_register, stack_top_register_internal, 0);
+            return;
+        }
+
+        const entry top = entries.back();
+        entries.pop_back();
+
+        if (top.is_constant)
+        {
+            assembler_internal.emit_move_immediate_u32(destination_register, top.value);
+            return;
+        }
+
+        assembler_internal.emit_move_u32_register(destination_register, top.cache_register);
+        release(top.cache_register);
+    }
+
+    auto operand_stack_cache::drop(void) -> void
+    {
+        if (entries.empty())
+        {
+            assembler_internal.emit_subtract_immediate_from_pointer(stack_top_register_internal, stack_top_register_internal, 4u);
+            return;
+        }
+
+        const entry top = entries.back();
+        entries.pop_back();
+
+        if (!top.is_constant)
+        {
+            release(top.cache_register);
+        }
+    }
+
+    auto operand_stack_cache::flush(void) -> void
+    {
+        spill_lowest(entries.size());
+    }
+
+    auto operand_stack_cache::cached_count(void) const -> uint32_t
+    {
+        return static_cast<uint32_t>(entries.size());
+    }
+
+    auto operand_stack_cache::top_constant(void) const -> std::optional<uint32_t>
+    {
+        if (entries.empty() || !entries.back().is_constant)
+        {
+            return std::nullopt;
+        }
+
+        return entries.back().value;
+    }
+
+    auto operand_stack_cache::spill_lowest(std::size_t count) -> void
+    {
+        if (count == 0u)
+        {
+            return;
+        }
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const entry &spilled = entries[i];
+            const auto   offset  = static_cast<int32_t>(i * 4u);
+
+            if (spilled.is_constant)
+            {
+                assembler_internal.emit_move_immediate_u32(scratch_register_internal, spilled.value);
+                assembler_internal.emit_store_u32_from_register_to_base_plus_offset(
+                    scratch_register_internal,
+                    stack_top_register_internal,
+                    offset
+                );
+                continue;
+            }
+
+            assembler_internal.emit_store_u32_from_register_to_base_plus_offset(
+                spilled.cache_register,
+                stack_top_register_internal,
+                offset
+            );
+            release(spilled.cache_register);
+        }
+
+        // one stack top update for the whole batch
+        assembler_internal.emit_add_immediate_to_pointer(
+            stack_top_register_internal,
+            stack_top_register_internal,
+            static_cast<uint32_t>(count * 4u)
+        );
+        entries.erase(entries.begin(), entries.begin() + static_cast<std::ptrdiff_t>(count));
+    }
+
+    auto operand_stack_cache::make_room(void) -> void
+    {
+        // only long runs of constants get here; registers run out first
+        if (entries.size() == MAX_CACHED_ENTRIES)
+        {
+            spill_lowest(MAX_CACHED_ENTRIES / 2u);
+        }
+    }
+}
@@ -0,0 +1,177 @@
+#include <hal/interface/linear_memory.hpp>
+
+#include <mutex>
+#include <signal.h>
+#include <stdexcept>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+    // the farthest a 32-bit index plus a 4-byte access reaches
+    constexpr uintmax_t ADDRESSABLE_BYTES = (uintmax_t { 1 } << 32u) + 4u;
+
+    thread_local const j1t::hal::memory_fault_scope::route *active_route = nullptr;
+
+    struct sigaction previous_segv_action {};
+    struct sigaction previous_bus_action {};
+
+    auto page_size(void) -> uintmax_t
+    {
+        static const uintmax_t size = static_cast<uintmax_t>(::sysconf(_SC_PAGESIZE));
+        return size;
+    }
+
+    auto round_up_to_page(uintmax_t size) -> uintmax_t
+    {
+        return (size + page_size() - 1u) & ~(page_size() - 1u);
+    }
+
+    // not ours: hand the fault to whoever had the signal before
+    auto forward_fault(int signal_number, siginfo_t *info, void *signal_context) -> void
+    {
+        const struct sigaction &previous = signal_number == SIGBUS ? previous_bus_action : previous_segv_action;
+
+        if ((previous.sa_flags & SA_SIGINFO) != 0)
+        {
+            previous.sa_sigaction(signal_number, info, signal_context);
+            return;
+        }
+
+        if (previous.sa_handler == SIG_DFL || previous.sa_handler == SIG_IGN)
+        {
+            // returning re-executes the access, which now takes the default
+            // action
+            ::signal(signal_number, SIG_DFL);
+            return;
+        }
+
+        previous.sa_handler(signal_number);
+    }
+
+    auto on_memory_fault(int signal_number, siginfo_t *info, void *signal_context) -> void
+    {
+        const j1t::hal::memory_fault_scope::route *route = active_route;
+        if (route != nullptr)
+        {
+            const uintptr_t address         = reinterpret_cast<uintptr_t>(info->si_addr);
+            const uintptr_t program_counter = j1t::hal::signal_program_counter(signal_context);
+
+            if (route->memory->reserves(address) && program_counter >= route->code_begin
+                && program_counter < route->code_end)
+            {
+                j1t::hal::set_signal_program_counter(signal_context, route->resume);
+                return;
+            }
+        }
+
+        forward_fault(signal_number, info, signal_context);
+    }
+
+    auto install_fault_handlers(void) -> void
+    {
+        static std::once_flag once;
+
+        std::call_once(
+            once,
+            []() -> void
+            {
+                struct sigaction action {};
+                action.sa_sigaction = on_memory_fault;
+                action.sa_flags     = SA_SIGINFO;
+                sigemptyset(&action.sa_mask);
+
+                // macOS reports accesses to reserved pages as SIGBUS
+                if (::sigaction(SIGSEGV, &action, &previous_segv_action) != 0
+                    || ::sigaction(SIGBUS, &action, &previous_bus_action) != 0)
+                {
+                    throw std::runtime_error("memory_fault_scope: sigaction failed");
+                }
+            }
+        );
+    }
+}
+
+namespace j1t::hal
+{
+    linear_memory::linear_memory(std::span<const uint8_t> contents)
+        : size_internal(contents.size())
+    {
+        if (size_internal > ADDRESSABLE_BYTES - 4u)
+        {
+            throw std::runtime_error("linear_memory: contents exceed 32-bit addressing");
+        }
+
+        // the accessible pages start padding bytes before the contents so
+        // that both end together
+        const uintmax_t accessible = round_up_to_page(size_internal);
+        const uintmax_t padding    = accessible - size_internal;
+        reservation_size_internal  = round_up_to_page(padding + ADDRESSABLE_BYTES);
+
+        void *reservation = ::mmap(
+            NULL,
+            reservation_size_internal,
+            PROT_NONE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+            -1,
+            0
+        );
+        if (reservation == MAP_FAILED)
+        {
+            throw std::runtime_error("linear_memory: mmap failed");
+        }
+        reservation_internal = static_cast<uint8_t *>(reservation);
+        data_internal        = reservation_internal + padding;
+
+        if (accessible != 0u && ::mprotect(reservation_internal, accessible, PROT_READ | PROT_WRITE) != 0)
+        {
+            ::munmap(reservation_internal, reservation_size_internal);
+            throw std::runtime_error("linear_memory: mprotect failed");
+        }
+
+        if (size_internal != 0u)
+        {
+            memcpy(data_internal, contents.data(), size_internal);
+        }
+    }
+
+    linear_memory::~linear_memory(void)
+    {
+        ::munmap(reservation_internal, reservation_size_internal);
+    }
+
+    auto linear_memory::data(void) -> uint8_t *
+    {
+        return data_internal;
+    }
+
+    auto linear_memory::size(void) const -> uintmax_t
+    {
+        return size_internal;
+    }
+
+    auto linear_memory::reserves(uintptr_t address) const -> bool
+    {
+        const uintptr_t begin = reinterpret_cast<uintptr_t>(reservation_internal);
+        return address >= begin && address - begin < reservation_size_internal;
+    }
+
+    memory_fault_scope::memory_fault_scope(const linear_memory &memory, compiled_code &compiled)
+    {
+        install_fault_handlers();
+
+        route_internal.memory     = &memory;
+        route_internal.code_begin = reinterpret_cast<uintptr_t>(compiled.entry());
+        route_internal.code_end   = route_internal.code_begin + compiled.code_size();
+        route_internal.resume     = compiled.memory_fault_exit();
+
+        outer_internal            = active_route;
+        active_route              = &route_internal;
+    }
+
+    memory_fault_scope::~memory_fault_scope(void)
+    {
+        active_route = outer_internal;
+    }
+}
@@ -0,0 +1,59 @@
+#include <hal/interface/mapped_file.hpp>
+
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace j1t::hal
+{
+    mapped_file::mapped_file(const std::filesystem::path &path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            throw std::runtime_error("mapped_file: open failed");
+        }
+
+        struct stat status {};
+        if (::fstat(fd, &status) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("mapped_file: fstat failed");
+        }
+
+        size_internal = static_cast<uintmax_t>(status.st_size);
+        if (size_internal != 0u)
+        {
+            void *mapping = ::mmap(NULL, size_internal, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED)
+            {
+                ::close(fd);
+                throw std::runtime_error("mapped_file: mmap failed");
+            }
+            mapping_internal = mapping;
+        }
+
+        // the mapping keeps the file contents alive
+        ::close(fd);
+    }
+
+    mapped_file::~mapped_file(void)
+    {
+        if (mapping_internal != nullptr)
+        {
+            ::munmap(mapping_internal, size_internal);
+        }
+    }
+
+    auto mapped_file::data(void) const -> const uint8_t *
+    {
+        return static_cast<const uint8_t *>(mapping_internal);
+    }
+
+    auto mapped_file::size(void) const -> uintmax_t
+    {
+        return size_internal;
+    }
+}
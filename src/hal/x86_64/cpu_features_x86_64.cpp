@@ -0,0 +1,85 @@
+#include <hal/interface/cpu_features.hpp>
+
+#include <cpuid.h>
+
+namespace
+{
+    auto has_bit(uint32_t value, uint32_t bit) -> bool
+    {
+        return ((value >> bit) & 1u) != 0u;
+    }
+
+    auto read_xcr0(void) -> uint64_t
+    {
+        uint32_t low  = 0;
+        uint32_t high = 0;
+        __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+        return (static_cast<uint64_t>(high) << 32u) | low;
+    }
+
+    auto probe(void) -> j1t::hal::cpu_features
+    {
+        using j1t::hal::cpu_feature;
+
+        j1t::hal::cpu_features features {};
+
+        uint32_t eax = 0;
+        uint32_t ebx = 0;
+        uint32_t ecx = 0;
+        uint32_t edx = 0;
+
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0)
+        {
+            return features;
+        }
+
+        if (has_bit(ecx, 23))
+        {
+            features.add(cpu_feature::X86_64_POPCNT);
+        }
+        if (has_bit(ecx, 22))
+        {
+            features.add(cpu_feature::X86_64_MOVBE);
+        }
+
+        // AVX state must be enabled by the OS (OSXSAVE + XCR0 bits 1 and 2)
+        const bool is_avx_usable = has_bit(ecx, 27) && has_bit(ecx, 28) && (read_xcr0() & 0x6u) == 0x6u;
+
+        if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) != 0)
+        {
+            if (has_bit(ebx, 3))
+            {
+                features.add(cpu_feature::X86_64_BMI1);
+            }
+            if (has_bit(ebx, 5) && is_avx_usable)
+            {
+                features.add(cpu_feature::X86_64_AVX2);
+            }
+            if (has_bit(ebx, 8))
+            {
+                features.add(cpu_feature::X86_64_BMI2);
+            }
+            if (has_bit(ebx, 9))
+            {
+                features.add(cpu_feature::X86_64_ERMS);
+            }
+        }
+
+        // ABM: LZCNT lives in the extended leaf
+        if (__get_cpuid(0x8000'0001u, &eax, &ebx, &ecx, &edx) != 0 && has_bit(ecx, 5))
+        {
+            features.add(cpu_feature::X86_64_LZCNT);
+        }
+
+        return features;
+    }
+}
+
+namespace j1t::hal
+{
+    auto host_cpu_features(void) -> cpu_features
+    {
+        static const cpu_features features = ::probe();
+        return features;
+    }
+}
@@ -0,0 +1,27 @@
+#include <cpuid.h>
+
+#include <hal/interface/icache.hpp>
+
+namespace j1t::hal
+{
+    auto flush_instruction_cache(const void *begin, uintmax_t size) -> void
+    {
+        // x86-64 keeps the instruction cache coherent with data writes; the
+        // return into the caller after compilation is enough to serialize
+        static_cast<void>(begin);
+        static_cast<void>(size);
+    }
+
+    auto synchronize_instruction_stream(void) -> void
+    {
+        // cross-modifying code needs a serializing instruction on the thread
+        // that runs it; cpuid is the one available outside ring 0
+        unsigned int eax = 0;
+        unsigned int ebx = 0;
+        unsigned int ecx = 0;
+        unsigned int edx = 0;
+
+        __cpuid(0, eax, ebx, ecx, edx);
+        asm volatile("" ::: "memory");
+    }
+}
@@ -0,0 +1,963 @@
+#include <hal/x86_64/macro_assembler.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+    auto fits_in_i8(int64_t value) -> bool
+    {
+        return value >= INT8_MIN && value <= INT8_MAX;
+    }
+
+    auto fits_in_i32(int64_t value) -> bool
+    {
+        return value >= INT32_MIN && value <= INT32_MAX;
+    }
+}
+
+namespace j1t::hal::x86_64
+{
+    auto macro_assembler::set_output(j1t::hal::code_buffer &output_buffer) -> void
+    {
+        output_buffer_internal = &output_buffer;
+        output_buffer_internal->clear();
+        program_counter = 0u;
+        label_states.clear();
+        branch_patches.clear();
+    }
+
+    auto macro_assembler::code_size_bytes(void) const -> uint32_t
+    {
+        return program_counter;
+    }
+
+    auto macro_assembler::set_features(const cpu_features &target_features) -> void
+    {
+        features_internal = target_features;
+    }
+
+    auto macro_assembler::features(void) const -> cpu_features
+    {
+        return features_internal;
+    }
+
+    auto macro_assembler::emit_u8(uint8_t value) -> void
+    {
+        if (output_buffer_internal == nullptr)
+        {
+            throw std::runtime_error(
+                "macro_assembler output buffer not set before emitting "
+                "instruction"
+            );
+        }
+
+        output_buffer_internal->emit_u8(value);
+        program_counter += 1u;
+    }
+
+    auto macro_assembler::emit_u32_le(uint32_t value) -> void
+    {
+        emit_u8(static_cast<uint8_t>(value & 0xFFu));
+        emit_u8(static_cast<uint8_t>((value >> 8u) & 0xFFu));
+        emit_u8(static_cast<uint8_t>((value >> 16u) & 0xFFu));
+        emit_u8(static_cast<uint8_t>((value >> 24u) & 0xFFu));
+    }
+
+    auto macro_assembler::emit_u64_le(uint64_t value) -> void
+    {
+        emit_u32_le(static_cast<uint32_t>(value & 0xFFFF'FFFFu));
+        emit_u32_le(static_cast<uint32_t>(value >> 32u));
+    }
+
+    auto macro_assembler::overwrite_u8(uint32_t address_bytes, uint8_t value) -> void
+    {
+        if (output_buffer_internal == nullptr)
+        {
+            throw std::runtime_error("overwrite: output not set");
+        }
+
+        output_buffer_internal->overwrite_u8(address_bytes, value);
+    }
+
+    auto macro_assembler::overwrite_u32_le(uint32_t address_bytes, uint32_t value) -> void
+    {
+        if (output_buffer_internal == nullptr)
+        {
+            throw std::runtime_error("overwrite: output not set");
+        }
+
+        output_buffer_internal->overwrite_u32_le(address_bytes, value);
+    }
+
+    auto macro_assembler::emit_rex(bool is_wide, uint32_t reg, uint32_t index, uint32_t base, bool force) -> void
+    {
+        // REX: 0100 W R X B
+        uint8_t rex = 0x40u;
+        rex |= is_wide ? 0x08u : 0x00u;
+        rex |= ((reg >> 3u) & 1u) << 2u;
+        rex |= ((index >> 3u) & 1u) << 1u;
+        rex |= ((base >> 3u) & 1u) << 0u;
+
+        if (rex != 0x40u || force)
+        {
+            emit_u8(rex);
+        }
+    }
+
+    auto macro_assembler::emit_opcode(uint32_t opcode) -> void
+    {
+        if (opcode > 0xFFu)
+        {
+            emit_u8(static_cast<uint8_t>((opcode >> 8u) & 0xFFu));
+        }
+        emit_u8(static_cast<uint8_t>(opcode & 0xFFu));
+    }
+
+    auto macro_assembler::emit_modrm_register(uint32_t reg, uint32_t rm) -> void
+    {
+        // mod = 11 (register direct)
+        emit_u8(static_cast<uint8_t>(0xC0u | ((reg & 7u) << 3u) | (rm & 7u)));
+    }
+
+    auto macro_assembler::emit_modrm_memory(uint32_t reg, uint32_t base_register, int32_t offset) -> void
+    {
+        const uint32_t base = base_register & 7u;
+
+        // [rbp] / [r13] with mod = 00 means RIP-relative, so those bases always
+        // carry a displacement
+        uint32_t mod        = 0u;
+        if (offset == 0 && base != (RBP & 7u))
+        {
+            mod = 0u;
+        }
+        else if (fits_in_i8(offset))
+        {
+            mod = 1u;
+        }
+        else
+        {
+            mod = 2u;
+        }
+
+        emit_u8(static_cast<uint8_t>((mod << 6u) | ((reg & 7u) << 3u) | base));
+
+        // [rsp] / [r12] needs a SIB byte (no index, base = rsp)
+        if (base == (RSP & 7u))
+        {
+            emit_u8(0x24u);
+        }
+
+        if (mod == 1u)
+        {
+            emit_u8(static_cast<uint8_t>(static_cast<int8_t>(offset)));
+        }
+        else if (mod == 2u)
+        {
+            emit_u32_le(static_cast<uint32_t>(offset));
+        }
+    }
+
+    auto macro_assembler::emit_register_register(uint32_t opcode, bool is_wide, uint32_t reg, uint32_t rm, bool force_rex)
+        -> void
+    {
+        emit_rex(is_wide, reg, 0u, rm, force_rex);
+        emit_opcode(opcode);
+        emit_modrm_register(reg, rm);
+    }
+
+    auto macro_assembler::emit_register_memory(
+        uint32_t opcode,
+        bool     is_wide,
+        uint32_t reg,
+        uint32_t base_register,
+        int32_t  offset
+    ) -> void
+    {
+        emit_rex(is_wide, reg, 0u, base_register);
+        emit_opcode(opcode);
+        emit_modrm_memory(reg, base_register, offset);
+    }
+
+    auto macro_assembler::emit_register_memory_indexed(
+        uint32_t opcode,
+        bool     is_wide,
+        uint32_t reg,
+        uint32_t base_register,
+        uint32_t index_register,
+        int32_t  offset,
+        uint32_t scale_shift,
+        bool     force_rex
+    ) -> void
+    {
+        if (scale_shift > 3u)
+        {
+            throw std::runtime_error("macro_assembler emit_register_memory_indexed: invalid scale");
+        }
+
+        // rsp cannot be an index register
+        if (index_register == RSP)
+        {
+            if (base_register == RSP || scale_shift != 0u)
+            {
+                throw std::runtime_error("macro_assembler emit_register_memory_indexed: rsp cannot be an index");
+            }
+
+            std::swap(base_register, index_register);
+        }
+
+        const uint32_t base = base_register & 7u;
+
+        uint32_t mod        = 0u;
+        if (offset == 0 && base != (RBP & 7u))
+        {
+            mod = 0u;
+        }
+        else if (fits_in_i8(offset))
+        {
+            mod = 1u;
+        }
+        else
+        {
+            mod = 2u;
+        }
+
+        emit_rex(is_wide, reg, index_register, base_register, force_rex);
+        emit_opcode(opcode);
+        // rm = 100 : SIB follows
+        emit_u8(static_cast<uint8_t>((mod << 6u) | ((reg & 7u) << 3u) | 4u));
+        emit_u8(static_cast<uint8_t>((scale_shift << 6u) | ((index_register & 7u) << 3u) | base));
+
+        if (mod == 1u)
+        {
+            emit_u8(static_cast<uint8_t>(static_cast<int8_t>(offset)));
+        }
+        else if (mod == 2u)
+        {
+            emit_u32_le(static_cast<uint32_t>(offset));
+        }
+    }
+
+    auto macro_assembler::emit_lea(
+        bool     is_wide,
+        uint32_t destination_register,
+        uint32_t base_register,
+        uint32_t index_register,
+        int32_t  offset,
+        uint32_t scale_shift
+    ) -> void
+    {
+        // LEA r, m : 8D /r
+        if (index_register == NO_INDEX)
+        {
+            if (scale_shift != 0u)
+            {
+                throw std::runtime_error("macro_assembler emit_lea: invalid scale");
+            }
+
+            emit_register_memory(0x8Du, is_wide, destination_register, base_register, offset);
+            return;
+        }
+
+        emit_register_memory_indexed(0x8Du, is_wide, destination_register, base_register, index_register, offset, scale_shift);
+    }
+
+    auto macro_assembler::emit_arithmetic_immediate(
+        uint32_t extension,
+        bool     is_wide,
+        uint32_t register_number,
+        int32_t  immediate_value
+    ) -> void
+    {
+        emit_rex(is_wide, 0u, 0u, register_number);
+
+        if (fits_in_i8(immediate_value))
+        {
+            // op r/m, imm8 : 83 /ext ib
+            emit_u8(0x83u);
+            emit_modrm_register(extension, register_number);
+            emit_u8(static_cast<uint8_t>(static_cast<int8_t>(immediate_value)));
+            return;
+        }
+
+        // op r/m, imm32 : 81 /ext id
+        emit_u8(0x81u);
+        emit_modrm_register(extension, register_number);
+        emit_u32_le(static_cast<uint32_t>(immediate_value));
+    }
+
+    auto macro_assembler::emit_add_pointer_register(uint32_t destination_register, uint32_t left_register, uint32_t right_register)
+        -> void
+    {
+        // LEA rd, [rn + rm]
+        emit_lea(true, destination_register, left_register, right_register, 0);
+    }
+
+    auto macro_assembler::emit_shift_left_u32_immediate(uint32_t destination_register, uint32_t source_register, uint32_t shift)
+        -> void
+    {
+        if (shift > 31u)
+        {
+            throw std::runtime_error("emit_shift_left_u32_immediate: invalid shift");
+        }
+
+        if (destination_register != source_register)
+        {
+            emit_move_u32_register(destination_register, source_register);
+        }
+
+        if (shift == 0u)
+        {
+            return;
+        }
+
+        // SHL r/m32 : /4
+        emit_shift_immediate(4u, false, destination_register, shift);
+    }
+
+    auto macro_assembler::emit_shift_immediate(uint32_t extension, bool is_wide, uint32_t register_number, uint32_t shift)
+        -> void
+    {
+        emit_rex(is_wide, 0u, 0u, register_number);
+        if (shift == 1u)
+        {
+            // op r/m, 1 : D1 /ext
+            emit_u8(0xD1u);
+            emit_modrm_register(extension, register_number);
+            return;
+        }
+
+        // op r/m, imm8 : C1 /ext ib
+        emit_u8(0xC1u);
+        emit_modrm_register(extension, register_number);
+        emit_u8(static_cast<uint8_t>(shift));
+    }
+
+    auto macro_assembler::emit_move_u32_register(uint32_t destination_register, uint32_t source_register) -> void
+    {
+        // MOV r/m32, r32 : 89 /r  (zero-extends into the upper half)
+        emit_register_register(0x89u, false, source_register, destination_register);
+    }
+
+    auto macro_assembler::emit_subtract_u32_register(
+        uint32_t destination_register,
+        uint32_t left_register,
+        uint32_t right_register
+    ) -> void
+    {
+        // SUB r/m32, r32 : 29 /r
+        if (destination_register == left_register)
+        {
+            emit_register_register(0x29u, false, right_register, destination_register);
+            return;
+        }
+
+        if (destination_register == right_register)
+        {
+            // d = l - d  ->  d = -d + l
+            emit_negate_u32(destination_register);
+            emit_add_u32_register(destination_register, destination_register, left_register);
+            return;
+        }
+
+        emit_move_u32_register(destination_register, left_register);
+        emit_register_register(0x29u, false, right_register, destination_register);
+    }
+
+    auto macro_assembler::emit_multiply_u32_register(
+        uint32_t destination_register,
+        uint32_t left_register,
+        uint32_t right_register
+    ) -> void
+    {
+        // IMUL r32, r/m32 : 0F AF /r  (low 32 bits are sign-agnostic)
+        if (destination_register == left_register)
+        {
+            emit_register_register(0x0FAFu, false, destination_register, right_register);
+            return;
+        }
+
+        if (destination_register == right_register)
+        {
+            emit_register_register(0x0FAFu, false, destination_register, left_register);
+            return;
+        }
+
+        emit_move_u32_register(destination_register, left_register);
+        emit_register_register(0x0FAFu, false, destination_register, right_register);
+    }
+
+    auto macro_assembler::emit_divide_u32_register(uint32_t destination_register, uint32_t left_register, uint32_t right_register)
+        -> void
+    {
+        if (right_register == RAX || right_register == RDX)
+        {
+            throw std::runtime_error("emit_divide_u32_register: divisor must not be rax/rdx");
+        }
+
+        if (left_register != RAX)
+        {
+            emit_move_u32_register(RAX, left_register);
+        }
+
+        // XOR edx, edx
+        emit_register_register(0x31u, false, RDX, RDX);
+
+        // DIV r/m32 : F7 /6
+        emit_rex(false, 0u, 0u, right_register);
+        emit_u8(0xF7u);
+        emit_modrm_register(6u, right_register);
+
+        if (destination_register != RAX)
+        {
+            emit_move_u32_register(destination_register, RAX);
+        }
+    }
+
+    auto macro_assembler::emit_divide_i32_register(uint32_t destination_register, uint32_t left_register, uint32_t right_register)
+        -> void
+    {
+        if (right_register == RAX || right_register == RDX)
+        {
+            throw std::runtime_error("emit_divide_i32_register: divisor must not be rax/rdx");
+        }
+
+        if (left_register != RAX)
+        {
+            emit_move_u32_register(RAX, left_register);
+        }
+
+        // CDQ
+        emit_u8(0x99u);
+
+        // IDIV r/m32 : F7 /7
+        emit_rex(false, 0u, 0u, right_register);
+        emit_u8(0xF7u);
+        emit_modrm_register(7u, right_register);
+
+        if (destination_register != RAX)
+        {
+            emit_move_u32_register(destination_register, RAX);
+        }
+    }
+
+    auto macro_assembler::emit_move_pointer_register(uint32_t destination_register, uint32_t source_register) -> void
+    {
+        // MOV r/m64, r64 : REX.W 89 /r
+        emit_register_register(0x89u, true, source_register, destination_register);
+    }
+
+    auto macro_assembler::emit_move_pointer_immediate(uint32_t destination_register, uintptr_t immediate_value) -> void
+    {
+        auto value = static_cast<uint64_t>(immediate_value);
+
+        if (value <= 0xFFFF'FFFFu)
+        {
+            // MOV r32, imm32 zero-extends
+            emit_move_immediate_u32(destination_register, static_cast<uint32_t>(value));
+            return;
+        }
+
+        // MOV r64, imm64 : REX.W B8+r io
+        emit_rex(true, 0u, 0u, destination_register);
+        emit_u8(static_cast<uint8_t>(0xB8u + (destination_register & 7u)));
+        emit_u64_le(value);
+    }
+
+    auto macro_assembler::emit_move_pointer_patchable(uint32_t destination_register, uintptr_t immediate_value) -> uint32_t
+    {
+        const uint32_t offset = program_counter;
+
+        // MOV r64, imm64 : REX.W B8+r io, even for values that fit in 32 bits
+        emit_rex(true, 0u, 0u, destination_register);
+        emit_u8(static_cast<uint8_t>(0xB8u + (destination_register & 7u)));
+        emit_u64_le(static_cast<uint64_t>(immediate_value));
+
+        return offset;
+    }
+
+    auto macro_assembler::patch_move_pointer(code_buffer &code, uint32_t offset, uintptr_t immediate_value) -> void
+    {
+        const auto value = static_cast<uint64_t>(immediate_value);
+
+        // the io operand follows REX.W and the opcode byte
+        code.overwrite_u32_le(offset + 2u, static_cast<uint32_t>(value & 0xFFFF'FFFFu));
+        code.overwrite_u32_le(offset + 6u, static_cast<uint32_t>(value >> 32u));
+    }
+
+    auto macro_assembler::emit_call_register(uint32_t function_register) -> void
+    {
+        // CALL r/m64 : FF /2
+        emit_rex(false, 0u, 0u, function_register);
+        emit_u8(0xFFu);
+        emit_modrm_register(2u, function_register);
+    }
+
+    auto macro_assembler::emit_cset_u32(uint32_t destination_register, uint32_t condition) -> void
+    {
+        // SETcc r/m8 : 0F 90+cc /0
+        // spl/bpl/sil/dil need an (empty) REX prefix
+        const bool force_rex = destination_register >= RSP;
+        emit_register_register(0x0F90u + (condition & 0x0Fu), false, 0u, destination_register, force_rex);
+
+        // MOVZX r32, r/m8 : 0F B6 /r
+        emit_register_register(0x0FB6u, false, destination_register, destination_register, force_rex);
+    }
+
+    auto macro_assembler::create_label(void) -> label
+    {
+        uint32_t id = static_cast<uint32_t>(label_states.size());
+        label_states.push_back(label_state {});
+        return label { id };
+    }
+
+    auto macro_assembler::bind_label(label target_label) -> void
+    {
+        if (target_label.id >= label_states.size())
+        {
+            throw std::runtime_error("macro_assembler bind_label: invalid label");
+        }
+
+        label_states[target_label.id].is_bound        = true;
+        label_states[target_label.id].program_counter = program_counter;
+    }
+
+    auto macro_assembler::emit_branch(
+        uint8_t short_opcode,
+        uint8_t near_opcode_prefix,
+        uint8_t near_opcode,
+        bool    force_short,
+        label   target_label
+    ) -> void
+    {
+        if (target_label.id >= label_states.size())
+        {
+            throw std::runtime_error("macro_assembler branch: invalid label");
+        }
+
+        // NOTE: displacements are relative to the end of the instruction
+        const auto &target_label_state = label_states[target_label.id];
+        if (target_label_state.is_bound)
+        {
+            // backward branch: the distance is already known
+            const int64_t short_delta = static_cast<int64_t>(target_label_state.program_counter)
+                                      - static_cast<int64_t>(program_counter + 2u);
+            if (fits_in_i8(short_delta))
+            {
+                emit_u8(short_opcode);
+                emit_u8(static_cast<uint8_t>(static_cast<int8_t>(short_delta)));
+                return;
+            }
+
+            if (force_short)
+            {
+                throw std::runtime_error("macro_assembler branch: short branch target out of range");
+            }
+
+            const uint32_t near_size  = near_opcode_prefix != 0u ? 6u : 5u;
+            const int64_t  near_delta = static_cast<int64_t>(target_label_state.program_counter)
+                                     - static_cast<int64_t>(program_counter + near_size);
+
+            if (near_opcode_prefix != 0u)
+            {
+                emit_u8(near_opcode_prefix);
+            }
+            emit_u8(near_opcode);
+            emit_u32_le(static_cast<uint32_t>(static_cast<int32_t>(near_delta)));
+            return;
+        }
+
+        // forward branch: patched in finalize
+        if (force_short)
+        {
+            emit_u8(short_opcode);
+            branch_patches.push_back(branch_patch { program_counter, target_label.id, branch_patch::type::REL8 });
+            emit_u8(0u);
+            return;
+        }
+
+        if (near_opcode_prefix != 0u)
+        {
+            emit_u8(near_opcode_prefix);
+        }
+        emit_u8(near_opcode);
+        branch_patches.push_back(branch_patch { program_counter, target_label.id, branch_patch::type::REL32 });
+        emit_u32_le(0u);
+    }
+
+    auto macro_assembler::branch_cond(uint32_t condition, label target_label) -> void
+    {
+        // Jcc rel8 : 70+cc cb / Jcc rel32 : 0F 80+cc cd
+        const uint8_t cc = static_cast<uint8_t>(condition & 0x0Fu);
+        emit_branch(static_cast<uint8_t>(0x70u + cc), 0x0Fu, static_cast<uint8_t>(0x80u + cc), false, target_label);
+    }
+
+    auto macro_assembler::branch_cond_short(uint32_t condition, label target_label) -> void
+    {
+        const uint8_t cc = static_cast<uint8_t>(condition & 0x0Fu);
+        emit_branch(static_cast<uint8_t>(0x70u + cc), 0x0Fu, static_cast<uint8_t>(0x80u + cc), true, target_label);
+    }
+
+    auto macro_assembler::branch(label target_label) -> void
+    {
+        // JMP rel8 : EB cb / JMP rel32 : E9 cd
+        emit_branch(0xEBu, 0u, 0xE9u, false, target_label);
+    }
+
+    auto macro_assembler::branch_short(label target_label) -> void
+    {
+        emit_branch(0xEBu, 0u, 0xE9u, true, target_label);
+    }
+
+    auto macro_assembler::branch_equal(label target_label) -> void
+    {
+        branch_cond(CONDITION_EQUAL, target_label);
+    }
+
+    auto macro_assembler::branch_not_equal(label target_label) -> void
+    {
+        branch_cond(CONDITION_NOT_EQUAL, target_label);
+    }
+
+    auto macro_assembler::emit_move_immediate_u32(uint32_t destination_register, uint32_t immediate_value) -> void
+    {
+        // MOV r32, imm32 : B8+r id
+        // (not XOR for zero: moves must leave the flags intact)
+        emit_rex(false, 0u, 0u, destination_register);
+        emit_u8(static_cast<uint8_t>(0xB8u + (destination_register & 7u)));
+        emit_u32_le(immediate_value);
+    }
+
+    auto macro_assembler::emit_load_u32_from_base_plus_offset(
+        uint32_t destination_register,
+        uint32_t base_register,
+        int32_t  offset
+    ) -> void
+    {
+        // MOV r32, r/m32 : 8B /r
+        emit_register_memory(0x8Bu, false, destination_register, base_register, offset);
+    }
+
+    auto macro_assembler::emit_store_u32_from_register_to_base_plus_offset(
+        uint32_t source_register,
+        uint32_t base_register,
+        int32_t  offset
+    ) -> void
+    {
+        // MOV r/m32, r32 : 89 /r
+        emit_register_memory(0x89u, false, source_register, base_register, offset);
+    }
+
+    auto macro_assembler::emit_load_u8_from_base_plus_index(
+        uint32_t destination_register,
+        uint32_t base_register,
+        uint32_t index_register
+    ) -> void
+    {
+        // MOVZX r32, r/m8 : 0F B6 /r  (the upper half of index is zero)
+        emit_register_memory_indexed(0x0FB6u, false, destination_register, base_register, index_register, 0, 0u);
+    }
+
+    auto macro_assembler::emit_load_u16_from_base_plus_index(
+        uint32_t destination_register,
+        uint32_t base_register,
+        uint32_t index_register
+    ) -> void
+    {
+        // MOVZX r32, r/m16 : 0F B7 /r
+        emit_register_memory_indexed(0x0FB7u, false, destination_register, base_register, index_register, 0, 0u);
+    }
+
+    auto macro_assembler::emit_load_u32_from_base_plus_index(
+        uint32_t destination_register,
+        uint32_t base_register,
+        uint32_t index_register
+    ) -> void
+    {
+        // MOV r32, r/m32 : 8B /r
+        emit_register_memory_indexed(0x8Bu, false, destination_register, base_register, index_register, 0, 0u);
+    }
+
+    auto macro_assembler::emit_store_u8_from_register_to_base_plus_index(
+        uint32_t source_register,
+        uint32_t base_register,
+        uint32_t index_register
+    ) -> void
+    {
+        // MOV r/m8, r8 : 88 /r  (REX so that sil/dil are addressable rather
+        // than dh/bh)
+        emit_register_memory_indexed(0x88u, false, source_register, base_register, index_register, 0, 0u, true);
+    }
+
+    auto macro_assembler::emit_load_pointer_from_base_plus_offset(
+        uint32_t destination_register,
+        uint32_t base_register,
+        int32_t  offset
+    ) -> void
+    {
+        // MOV r64, r/m64 : REX.W 8B /r
+        emit_register_memory(0x8Bu, true, destination_register, base_register, offset);
+    }
+
+    auto macro_assembler::emit_store_pointer_from_register_to_base_plus_offset(
+        uint32_t source_register,
+        uint32_t base_register,
+        int32_t  offset
+    ) -> void
+    {
+        // MOV r/m64, r64 : REX.W 89 /r
+        emit_register_memory(0x89u, true, source_register, base_register, offset);
+    }
+
+    auto macro_assembler::emit_add_immediate_to_pointer(
+        uint32_t destination_register,
+        uint32_t source_register,
+        uint32_t immediate_value
+    ) -> void
+    {
+        // LEA rd, [rn + imm]  (unlike ADD, leaves the flags intact)
+        if (!fits_in_i32(immediate_value))
+        {
+            throw std::runtime_error(
+                "macro_assembler emit_add_immediate_to_pointer: "
+                "invalid immediate value"
+            );
+        }
+
+        emit_lea(true, destination_register, source_register, NO_INDEX, static_cast<int32_t>(immediate_value));
+    }
+
+    auto macro_assembler::emit_subtract_immediate_from_pointer(
+        uint32_t destination_register,
+        uint32_t source_register,
+        uint32_t immediate_value
+    ) -> void
+    {
+        // LEA rd, [rn - imm]
+        if (!fits_in_i32(immediate_value))
+        {
+            throw std::runtime_error(
+                "macro_assembler emit_subtract_immediate_from_pointer: "
+                "invalid immediate value"
+            );
+        }
+
+        emit_lea(true, destination_register, source_register, NO_INDEX, -static_cast<int32_t>(immediate_value));
+    }
+
+    auto macro_assembler::emit_add_u32_register(uint32_t destination_register, uint32_t left_register, uint32_t right_register)
+        -> void
+    {
+        // ADD r/m32, r32 : 01 /r
+        if (destination_register == left_register)
+        {
+            emit_register_register(0x01u, false, right_register, destination_register);
+            return;
+        }
+
+        if (destination_register == right_register)
+        {
+            emit_register_register(0x01u, false, left_register, destination_register);
+            return;
+        }
+
+        // LEA rd32, [rn + rm]
+        emit_lea(false, destination_register, left_register, right_register, 0);
+    }
+
+    auto macro_assembler::emit_compare_u32_registers(uint32_t left_register, uint32_t right_register) -> void
+    {
+        // CMP r/m32, r32 : 39 /r  (flags = left - right)
+        emit_register_register(0x39u, false, right_register, left_register);
+    }
+
+    auto macro_assembler::emit_compare_pointer_registers(uint32_t left_register, uint32_t right_register) -> void
+    {
+        // CMP r/m64, r64 : REX.W 39 /r
+        emit_register_register(0x39u, true, right_register, left_register);
+    }
+
+    auto macro_assembler::emit_compare_u32_immediate(uint32_t left_register, int32_t immediate_value) -> void
+    {
+        // CMP r/m32, imm : 83 /7 ib / 81 /7 id
+        emit_arithmetic_immediate(7u, false, left_register, immediate_value);
+    }
+
+    auto macro_assembler::emit_test_u32_registers(uint32_t left_register, uint32_t right_register) -> void
+    {
+        // TEST r/m32, r32 : 85 /r
+        emit_register_register(0x85u, false, right_register, left_register);
+    }
+
+    auto macro_assembler::emit_negate_u32(uint32_t destination_register) -> void
+    {
+        // NEG r/m32 : F7 /3
+        emit_rex(false, 0u, 0u, destination_register);
+        emit_u8(0xF7u);
+        emit_modrm_register(3u, destination_register);
+    }
+
+    auto macro_assembler::emit_and_u32_from_base_plus_offset(
+        uint32_t destination_register,
+        uint32_t base_register,
+        int32_t  offset
+    ) -> void
+    {
+        // AND r32, r/m32 : 23 /r
+        emit_register_memory(0x23u, false, destination_register, base_register, offset);
+    }
+
+    auto macro_assembler::emit_shift_right_u32_immediate(uint32_t destination_register, uint32_t source_register, uint32_t shift)
+        -> void
+    {
+        if (shift > 31u)
+        {
+            throw std::runtime_error("emit_shift_right_u32_immediate: invalid shift");
+        }
+
+        if (destination_register != source_register)
+        {
+            emit_move_u32_register(destination_register, source_register);
+        }
+
+        if (shift != 0u)
+        {
+            // SHR r/m32 : /5
+            emit_shift_immediate(5u, false, destination_register, shift);
+        }
+    }
+
+    auto macro_assembler::emit_shift_right_i32_immediate(uint32_t destination_register, uint32_t source_register, uint32_t shift)
+        -> void
+    {
+        if (shift > 31u)
+        {
+            throw std::runtime_error("emit_shift_right_i32_immediate: invalid shift");
+        }
+
+        if (destination_register != source_register)
+        {
+            emit_move_u32_register(destination_register, source_register);
+        }
+
+        if (shift != 0u)
+        {
+            // SAR r/m32 : /7
+            emit_shift_immediate(7u, false, destination_register, shift);
+        }
+    }
+
+    auto macro_assembler::emit_multiply_u32_immediate(
+        uint32_t destination_register,
+        uint32_t source_register,
+        int32_t  immediate_value
+    ) -> void
+    {
+        emit_rex(false, destination_register, 0u, source_register);
+        if (fits_in_i8(immediate_value))
+        {
+            // IMUL r32, r/m32, imm8 : 6B /r ib
+            emit_u8(0x6Bu);
+            emit_modrm_register(destination_register, source_register);
+            emit_u8(static_cast<uint8_t>(static_cast<int8_t>(immediate_value)));
+            return;
+        }
+
+        // IMUL r32, r/m32, imm32 : 69 /r id
+        emit_u8(0x69u);
+        emit_modrm_register(destination_register, source_register);
+        emit_u32_le(static_cast<uint32_t>(immediate_value));
+    }
+
+    auto macro_assembler::emit_multiply_high_i32_immediate(
+        uint32_t destination_register,
+        uint32_t source_register,
+        int32_t  immediate_value
+    ) -> void
+    {
+        // MOVSXD r64, r/m32 : REX.W 63 /r
+        emit_register_register(0x63u, true, destination_register, source_register);
+
+        // IMUL r64, r/m64, imm32 : REX.W 69 /r id  (the product fits 64 bits)
+        emit_rex(true, destination_register, 0u, destination_register);
+        emit_u8(0x69u);
+        emit_modrm_register(destination_register, destination_register);
+        emit_u32_le(static_cast<uint32_t>(immediate_value));
+
+        // SAR r/m64, 32 : REX.W C1 /7 ib
+        emit_shift_immediate(7u, true, destination_register, 32u);
+    }
+
+    auto macro_assembler::emit_add_shifted_u32_register(
+        uint32_t destination_register,
+        uint32_t left_register,
+        uint32_t right_register,
+        uint32_t shift
+    ) -> void
+    {
+        // LEA rd32, [rn + rm * 2^shift]
+        emit_lea(false, destination_register, left_register, right_register, 0, shift);
+    }
+
+    auto macro_assembler::emit_return(void) -> void
+    {
+        // RET
+        emit_u8(0xC3u);
+    }
+
+    auto macro_assembler::debug_output_base(void) const -> const uint8_t *
+    {
+        if (output_buffer_internal == nullptr)
+        {
+            return nullptr;
+        }
+        return output_buffer_internal->data();
+    }
+
+    auto macro_assembler::finalize(void) -> void
+    {
+        for (const branch_patch &patch : branch_patches)
+        {
+            if (patch.target_label_id >= label_states.size())
+            {
+                throw std::runtime_error("macro_assembler finalize: invalid branch target label");
+            }
+
+            const auto &target_label_state = label_states[patch.target_label_id];
+            if (!target_label_state.is_bound)
+            {
+                throw std::runtime_error("macro_assembler finalize: unbound branch target label");
+            }
+
+            // the displacement field is the last part of the instruction, so
+            // the branch base (= next instruction) is right after it
+            const uint32_t field_size     = patch.patch_type == branch_patch::type::REL8 ? 1u : 4u;
+            const int64_t  target_pc      = static_cast<int64_t>(target_label_state.program_counter);
+            const int64_t  next_pc        = static_cast<int64_t>(patch.displacement_address_bytes + field_size);
+            const int64_t  delta_bytes    = target_pc - next_pc;
+
+            if (patch.patch_type == branch_patch::type::REL8)
+            {
+                if (!fits_in_i8(delta_bytes))
+                {
+                    throw std::runtime_error("macro_assembler finalize: short branch target out of range");
+                }
+
+                overwrite_u8(patch.displacement_address_bytes, static_cast<uint8_t>(static_cast<int8_t>(delta_bytes)));
+            }
+            else
+            {
+                if (!fits_in_i32(delta_bytes))
+                {
+                    throw std::runtime_error("macro_assembler finalize: near branch target out of range");
+                }
+
+                overwrite_u32_le(
+                    patch.displacement_address_bytes,
+                    static_cast<uint32_t>(static_cast<int32_t>(delta_bytes))
+                );
+            }
+        }
+    }
+}
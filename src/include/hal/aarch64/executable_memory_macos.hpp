@@ -12,10 +12,12 @@ namespace j1t::hal::aarch64
         ~executable_memory_macos(void) override;
 
         auto data(void) -> uint8_t * override;
+        auto executable_data(void) const -> const uint8_t * override;
         auto size(void) const -> uintmax_t override;
 
         auto begin_write(void) -> void override;
         auto end_write(void) -> void override;
+        auto is_executable_while_writing(void) const -> bool override;
 
         auto finalize(void) -> void override;
 
@@ -10,7 +10,7 @@ namespace j1t::hal::aarch64
     class macro_assembler final : public j1t::hal::macro_assembler
     {
       public:
-        auto set_output(j1t::hal::executable_memory &output_memory) -> void override;
+        auto set_output(j1t::hal::code_buffer &output_buffer) -> void override;
 
         auto create_label(void) -> label override;
         auto bind_label(label target_label) -> void override;
@@ -24,12 +24,28 @@ namespace j1t::hal::aarch64
             -> void override;
         auto emit_store_u32_from_register_to_base_plus_offset(uint32_t source_register, uint32_t base_register, int32_t offset)
             -> void override;
+        auto emit_load_u8_from_base_plus_index(uint32_t destination_register, uint32_t base_register, uint32_t index_register)
+            -> void override;
+        auto emit_load_u16_from_base_plus_index(uint32_t destination_register, uint32_t base_register, uint32_t index_register)
+            -> void override;
+        auto emit_load_u32_from_base_plus_index(uint32_t destination_register, uint32_t base_register, uint32_t index_register)
+            -> void override;
+        auto emit_store_u8_from_register_to_base_plus_index(
+            uint32_t source_register,
+            uint32_t base_register,
+            uint32_t index_register
+        ) -> void override;
         auto emit_add_pointer_register(uint32_t destination_register, uint32_t left_register, uint32_t right_register)
             -> void override;
         auto emit_shift_left_u32_immediate(uint32_t destination_register, uint32_t source_register, uint32_t shift)
             -> void override;
         auto emit_move_u32_register(uint32_t destination_register, uint32_t source_register) -> void override;
         auto emit_move_pointer_immediate(uint32_t destination_register, uintptr_t immediate_value) -> void override;
+        auto emit_move_pointer_patchable(uint32_t destination_register, uintptr_t immediate_value) -> uint32_t override;
+        static constexpr uint32_t PATCHABLE_MOVE_POINTER_SIZE { 16u };
+        // rewrites the value loaded by the emit_move_pointer_patchable()
+        // sequence at offset in code
+        static auto patch_move_pointer(code_buffer &code, uint32_t offset, uintptr_t immediate_value) -> void;
 
         auto emit_move_pointer_register(uint32_t destination_register, uint32_t source_register) -> void override;
 
@@ -74,9 +90,31 @@ namespace j1t::hal::aarch64
         auto finalize(void) -> void override;
         auto code_size_bytes(void) const -> uint32_t override;
 
+        auto set_features(const cpu_features &target_features) -> void override;
+        auto features(void) const -> cpu_features override;
+
       public:
         // no override
         auto branch_cond(uint32_t condition, label target_label) -> void;
+
+        // CMP wn, #imm12; immediate_value at most 4095
+        auto emit_compare_u32_immediate(uint32_t left_register, uint32_t immediate_value) -> void;
+        auto emit_negate_u32(uint32_t destination_register) -> void;
+        auto emit_and_u32_register(uint32_t destination_register, uint32_t left_register, uint32_t right_register) -> void;
+        auto emit_shift_right_u32_immediate(uint32_t destination_register, uint32_t source_register, uint32_t shift) -> void;
+        auto emit_shift_right_i32_immediate(uint32_t destination_register, uint32_t source_register, uint32_t shift) -> void;
+        // destination = left + (right << shift)
+        auto emit_add_shifted_u32_register(
+            uint32_t destination_register,
+            uint32_t left_register,
+            uint32_t right_register,
+            uint32_t shift
+        ) -> void;
+        // destination = high 32 bits of the 64-bit signed product of left
+        // and right
+        auto emit_multiply_high_i32_register(uint32_t destination_register, uint32_t left_register, uint32_t right_register)
+            -> void;
+
         auto debug_branch_patch_count(void) const -> uint32_t;
         auto debug_branch_patch_address_bytes(uint32_t patch_index) const -> uint32_t;
         auto debug_output_base(void) const -> const uint8_t *;
@@ -109,8 +147,9 @@ namespace j1t::hal::aarch64
         auto encode_conditional_immediate19(uint32_t condition, int32_t immediate19) -> uint32_t;
 
       private:
-        executable_memory *output_memory_internal { nullptr };
-        uint32_t           program_counter { 0 };
+        code_buffer *output_buffer_internal { nullptr };
+        uint32_t     program_counter { 0 };
+        cpu_features features_internal {};
 
         std::vector<label_state>  label_states;
         std::vector<branch_patch> branch_patches;
@@ -0,0 +1,34 @@
+#ifndef J1T_HAL_INTERFACE_BASIC_BLOCKS_HPP
+#define J1T_HAL_INTERFACE_BASIC_BLOCKS_HPP
+
+#include <stdint.h>
+#include <vector>
+
+namespace j1t::hal
+{
+    struct basic_block;
+
+    // A straight-line run of bytecode [begin_pc, end_pc) as the JITs see it:
+    // entered only at begin_pc and left only after its last op.
+    struct basic_block
+    {
+        uint32_t begin_pc { 0 };
+        uint32_t end_pc { 0 };
+
+        // operand stack reach relative to the depth on entry, in slots: how
+        // far below it some op pops and how far above it the stack grows
+        uint32_t max_pop { 0 };
+        uint32_t max_push { 0 };
+
+        // false when the last op is JUMP or RET
+        bool falls_through { true };
+    };
+
+    // Splits code at jump targets and after every jump and RET, in code
+    // order. Decoding stops at the first truncated immediate; jump targets
+    // that are out of range or not opcode boundaries split nothing (the
+    // backends reject those jumps themselves).
+    auto find_basic_blocks(const std::vector<uint8_t> &code) -> std::vector<basic_block>;
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef J1T_HAL_INTERFACE_CODE_BUFFER_HPP
+#define J1T_HAL_INTERFACE_CODE_BUFFER_HPP
+
+#include <hal/interface/executable_memory.hpp>
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+namespace j1t::hal
+{
+    class code_buffer;
+
+    // growable, plain (non-executable) output of a macro_assembler; the final
+    // code is copied into executable memory by install_code()
+    class code_buffer
+    {
+      public:
+        auto data(void) -> uint8_t *;
+        auto data(void) const -> const uint8_t *;
+        auto size(void) const -> uint32_t;
+
+        auto clear(void) -> void;
+        auto reserve(uint32_t capacity) -> void;
+
+        auto emit_u8(uint8_t value) -> void;
+        auto emit_u32_le(uint32_t value) -> void;
+        auto emit_bytes(const uint8_t *source, uint32_t size) -> void;
+
+        auto overwrite_u8(uint32_t offset, uint8_t value) -> void;
+        auto overwrite_u32_le(uint32_t offset, uint32_t value) -> void;
+        auto read_u32_le(uint32_t offset) const -> uint32_t;
+
+      private:
+        std::vector<uint8_t> bytes;
+    };
+
+    // allocate buffer.size() bytes from the shared code_heap, copy the code in
+    // and make it executable
+    auto install_code(const code_buffer &buffer) -> std::unique_ptr<executable_memory>;
+}
+
+#endif
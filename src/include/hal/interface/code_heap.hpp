@@ -0,0 +1,121 @@
+#ifndef J1T_HAL_INTERFACE_CODE_HEAP_HPP
+#define J1T_HAL_INTERFACE_CODE_HEAP_HPP
+
+#include <hal/interface/executable_memory.hpp>
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+namespace j1t::hal
+{
+    class code_heap;
+
+    // process-wide pool of executable memory shared by all compiled programs.
+    //
+    // Requests up to MAX_POOLED_SIZE are rounded up to a power-of-two size
+    // class and carved out of large regions by a bump allocator; released
+    // chunks go to per-class free lists and are reused before the bump
+    // pointer advances. Larger requests get a dedicated mapping.
+    class code_heap
+    {
+      public:
+        static constexpr uintmax_t MIN_CHUNK_SIZE { 64u };
+        static constexpr uintmax_t MAX_POOLED_SIZE { 256u * 1024u };
+
+        struct options
+        {
+            uintmax_t region_size { 2u * 1024u * 1024u };
+            bool      prefer_huge_pages { false };
+        };
+
+        struct statistics
+        {
+            // bytes mapped for regions and dedicated chunks
+            uintmax_t reserved_bytes { 0 };
+            // bytes handed out to live chunks (rounded up to size classes)
+            uintmax_t allocated_bytes { 0 };
+            // bytes actually asked for by live chunks
+            uintmax_t requested_bytes { 0 };
+            // bytes sitting in free lists
+            uintmax_t free_bytes { 0 };
+            uintmax_t live_chunks { 0 };
+            uintmax_t region_count { 0 };
+
+            // requested / reserved
+            auto occupancy(void) const -> double;
+            // share of allocated bytes lost to size-class rounding
+            auto internal_fragmentation(void) const -> double;
+            // share of carved bytes that are free but not reused yet
+            auto external_fragmentation(void) const -> double;
+        };
+
+        explicit code_heap(options heap_options);
+        ~code_heap(void);
+
+        code_heap(const code_heap &)                    = delete;
+        auto operator=(const code_heap &) -> code_heap & = delete;
+
+        // the heap used by install_code(); created on first use and never
+        // destroyed, so compiled code may outlive static destructors
+        static auto shared(void) -> code_heap &;
+        // must be called before the first shared() call
+        static auto configure_shared(options heap_options) -> void;
+
+        // the returned memory gives its chunk back to the heap on destruction;
+        // the heap must outlive it
+        auto allocate(uintmax_t size) -> std::unique_ptr<executable_memory>;
+
+        auto stats(void) const -> statistics;
+
+        // whether a chunk can be written while code in other chunks of the
+        // same region runs on another thread; maps the first region if needed
+        auto is_executable_while_writing(void) -> bool;
+
+      private:
+        class chunk;
+
+        static constexpr uint32_t SIZE_CLASS_COUNT { 13u }; // 64 B .. 256 KiB
+        static constexpr uint32_t DEDICATED_REGION { 0xFFFF'FFFFu };
+
+        struct region
+        {
+            std::unique_ptr<executable_memory> memory;
+            uintmax_t                          bump_offset { 0 };
+        };
+
+        struct free_chunk
+        {
+            uint32_t  region_index { 0 };
+            uintmax_t offset { 0 };
+        };
+
+        static auto size_class_of(uintmax_t size) -> uint32_t;
+        static auto size_of_class(uint32_t size_class) -> uintmax_t;
+
+        auto add_region(void) -> void;
+        auto retire_region_tail(region &target_region, uint32_t region_index) -> void;
+
+        auto release(uint32_t region_index, uintmax_t offset, uint32_t size_class, uintmax_t requested_size) -> void;
+        auto release_dedicated(uintmax_t reserved_size, uintmax_t requested_size) -> void;
+
+        auto begin_write(uint32_t region_index) -> void;
+        auto end_write(uint32_t region_index) -> void;
+
+      private:
+        options            heap_options_internal;
+        mutable std::mutex mutex_internal;
+        // held between a chunk's begin_write() and end_write(): regions are
+        // shared, so write windows must not overlap (W^X toggles are per
+        // mapping on Linux without memfd and per thread on macOS)
+        std::mutex write_mutex_internal;
+
+        std::vector<region>                                     regions;
+        std::array<std::vector<free_chunk>, SIZE_CLASS_COUNT> free_lists;
+        statistics                                              counters;
+    };
+}
+
+#endif
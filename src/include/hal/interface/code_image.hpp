@@ -0,0 +1,55 @@
+#ifndef J1T_HAL_INTERFACE_CODE_IMAGE_HPP
+#define J1T_HAL_INTERFACE_CODE_IMAGE_HPP
+
+#include <hal/interface/cpu_features.hpp>
+
+#include <stdint.h>
+#include <vector>
+
+namespace j1t::hal
+{
+    // addresses compiled code loads as immediates; they differ between
+    // processes and are patched in when an image is loaded
+    enum class relocation_target : uint32_t
+    {
+        HELPER_READ_8_UNSIGNED,
+        PUTCHAR,
+
+        COUNT,
+    };
+
+    // an emit_move_pointer_patchable() sequence at offset that loads target
+    struct relocation
+    {
+        uint32_t          offset { 0 };
+        relocation_target target { relocation_target::COUNT };
+    };
+
+    // offset of the code that enters the program at pc
+    struct entry_point
+    {
+        uint32_t pc { 0 };
+        uint32_t offset { 0 };
+    };
+
+    // Position-independent form of compiled code: the code bytes plus
+    // everything needed to load them into another process. Relocation sites
+    // hold whatever value they had when the image was taken.
+    struct code_image
+    {
+        std::vector<uint8_t>     code;
+        // ascending by pc, starting with { 0, 0 }
+        std::vector<entry_point> entry_points;
+        std::vector<relocation>  relocations;
+        cpu_features             features {};
+        // compiled_code::memory_fault_exit()
+        uint32_t                 memory_fault_offset { 0 };
+    };
+
+    // entry points sorted and inside the code, the first at { 0, 0 }, the
+    // memory fault exit and every relocation site of site_size bytes inside
+    // the code
+    auto is_well_formed(const code_image &image, uint32_t site_size) -> bool;
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef J1T_HAL_INTERFACE_CPU_FEATURES_HPP
+#define J1T_HAL_INTERFACE_CPU_FEATURES_HPP
+
+#include <stdint.h>
+
+namespace j1t::hal
+{
+    // optional instruction set extensions a macro assembler may select
+    // encodings for
+    enum class cpu_feature : uint32_t
+    {
+        // x86-64
+        X86_64_POPCNT,
+        X86_64_LZCNT,
+        X86_64_BMI1,
+        X86_64_BMI2,
+        X86_64_MOVBE,
+        X86_64_AVX2,
+        X86_64_ERMS,
+
+        // aarch64
+        AARCH64_CRC32,
+        AARCH64_LSE,
+        AARCH64_CSSC,
+
+        COUNT,
+    };
+
+    struct cpu_features
+    {
+        uint64_t bits { 0 };
+
+        constexpr auto has(cpu_feature feature) const -> bool
+        {
+            return (bits & (uint64_t { 1 } << static_cast<uint32_t>(feature))) != 0u;
+        }
+
+        constexpr auto add(cpu_feature feature) -> void
+        {
+            bits |= uint64_t { 1 } << static_cast<uint32_t>(feature);
+        }
+
+        // true when every feature in required is also present here, i.e. code
+        // compiled for required may run on a CPU with these features
+        constexpr auto includes(const cpu_features &required) const -> bool
+        {
+            return (required.bits & ~bits) == 0u;
+        }
+
+        constexpr auto operator==(const cpu_features &other) const -> bool = default;
+    };
+
+    constexpr auto cpu_feature_name(cpu_feature feature) -> const char *
+    {
+        switch (feature)
+        {
+            case cpu_feature::X86_64_POPCNT :
+                return "popcnt";
+            case cpu_feature::X86_64_LZCNT :
+                return "lzcnt";
+            case cpu_feature::X86_64_BMI1 :
+                return "bmi1";
+            case cpu_feature::X86_64_BMI2 :
+                return "bmi2";
+            case cpu_feature::X86_64_MOVBE :
+                return "movbe";
+            case cpu_feature::X86_64_AVX2 :
+                return "avx2";
+            case cpu_feature::X86_64_ERMS :
+                return "erms";
+            case cpu_feature::AARCH64_CRC32 :
+                return "crc32";
+            case cpu_feature::AARCH64_LSE :
+                return "lse";
+            case cpu_feature::AARCH64_CSSC :
+                return "cssc";
+            case cpu_feature::COUNT :
+                break;
+        }
+        return "unknown";
+    }
+
+    // probed once; later calls return the cached result
+    auto host_cpu_features(void) -> cpu_features;
+}
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef J1T_HAL_INTERFACE_DIVISION_BY_CONSTANT_HPP
+#define J1T_HAL_INTERFACE_DIVISION_BY_CONSTANT_HPP
+
+#include <stdint.h>
+
+namespace j1t::hal
+{
+    struct signed_division_magic;
+
+    // Replaces a truncating signed division by a constant with a multiply:
+    //
+    //   q  = high 32 bits of (int64) n * multiplier
+    //   q += n * dividend_sign
+    //   q  = q >> shift (arithmetic)
+    //   q += q >> 31 (logical), which rounds negative quotients toward zero
+    //
+    // gives n / divisor for every int32 n (Hacker's Delight, 10-4).
+    struct signed_division_magic
+    {
+        int32_t  multiplier { 0 };
+        uint32_t shift { 0 };
+        // -1, 0 or 1
+        int32_t  dividend_sign { 0 };
+    };
+
+    // divisor must not be -1, 0 or 1
+    auto signed_division_magic_of(int32_t divisor) -> signed_division_magic;
+}
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef J1T_HAL_INTERFACE_EXECUTABLE_MEMORY_HPP
 #define J1T_HAL_INTERFACE_EXECUTABLE_MEMORY_HPP
 
+#include <memory>
 #include <stdint.h>
 
 namespace j1t::hal
@@ -10,16 +11,27 @@ namespace j1t::hal
     class executable_memory
     {
       public:
-        virtual ~executable_memory(void)           = default;
+        virtual ~executable_memory(void)                             = default;
 
-        virtual auto data(void) -> uint8_t *       = 0;
-        virtual auto size(void) const -> uintmax_t = 0;
+        // writable view (what the assembler emits into)
+        virtual auto data(void) -> uint8_t *                         = 0;
+        // executable view (what compiled code runs from); may alias data()
+        virtual auto executable_data(void) const -> const uint8_t *  = 0;
+        virtual auto size(void) const -> uintmax_t                   = 0;
 
-        virtual auto begin_write(void) -> void     = 0;
-        virtual auto end_write(void) -> void       = 0;
+        virtual auto begin_write(void) -> void                       = 0;
+        virtual auto end_write(void) -> void                         = 0;
+        // whether other threads may keep running code from the executable
+        // view while a write window is open
+        virtual auto is_executable_while_writing(void) const -> bool = 0;
 
-        virtual auto finalize(void) -> void        = 0;
+        virtual auto finalize(void) -> void                          = 0;
     };
+
+    // prefer_huge_pages is a hint: platforms without huge page support for
+    // executable mappings fall back to regular pages
+    auto make_native_executable_memory(uintmax_t size, bool prefer_huge_pages = false)
+        -> std::unique_ptr<executable_memory>;
 }
 
 #endif
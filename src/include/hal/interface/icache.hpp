@@ -5,7 +5,13 @@
 
 namespace j1t::hal
 {
-    auto flush_instruction_cache(void *begin, uintmax_t size) -> void;
+    // make [begin, begin + size) of an executable view coherent with the
+    // instruction stream; callers pass only the range that was written
+    auto flush_instruction_cache(const void *begin, uintmax_t size) -> void;
+
+    // discard instructions this thread may have prefetched before it observed
+    // code installed by another thread; called once per hand-over
+    auto synchronize_instruction_stream(void) -> void;
 }
 
 #endif
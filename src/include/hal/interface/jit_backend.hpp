@@ -1,12 +1,33 @@
 #ifndef J1T_HAL_INTERFACE_JIT_BACKEND_HPP
 #define J1T_HAL_INTERFACE_JIT_BACKEND_HPP
 
+#include <hal/interface/code_image.hpp>
+#include <hal/interface/cpu_features.hpp>
+
 #include <memory>
 #include <vm/interpreter.hpp>
 
 namespace j1t::hal
 {
+    // how compiled code keeps linear memory accesses in bounds without
+    // checking each address
+    enum class memory_sandbox : uint8_t
+    {
+        // memory is a linear_memory and the code runs in a
+        // memory_fault_scope; out-of-bounds accesses fail the run
+        GUARD_PAGES,
+        // every address is masked with jit_context::memory_mask, so memory
+        // must hold memory_mask + 4 bytes; out-of-bounds accesses wrap
+        // instead of failing, for hosts where signal handlers are not an
+        // option
+        ADDRESS_MASK,
+    };
+
     // unsafe context for JIT-compiled code
+    // For a verified program the compiled code checks neither stack bounds
+    // nor local indices: the caller leaves room for max_stack_depth words
+    // above stack_top and provides at least locals_used locals. Memory is
+    // never bounds-checked; see memory_sandbox.
     struct jit_context
     {
         uint8_t  *memory { nullptr };
@@ -15,17 +36,32 @@ namespace j1t::hal
         uint32_t *stack_end { nullptr };
         uint32_t *locals { nullptr };
         uint32_t  error_code { 0 };
+        // a power of two minus one; memory_sandbox::ADDRESS_MASK only
+        uint32_t  memory_mask { 0 };
     };
 
     class compiled_code
     {
       public:
-        using entry_type                               = uint32_t (*)(jit_context *);
+        using entry_type                                   = uint32_t (*)(jit_context *);
 
-        virtual ~compiled_code(void)                   = default;
+        virtual ~compiled_code(void)                       = default;
 
-        virtual auto entry(void) -> entry_type         = 0;
-        virtual auto code_size(void) const -> uint32_t = 0;
+        virtual auto entry(void) -> entry_type             = 0;
+        // enters the program at the opcode at pc, taking the operand stack
+        // and locals as jit_context holds them; exists for pc 0 and every
+        // vm::loop_headers() pc, nullptr elsewhere
+        virtual auto entry_at(uint32_t pc) -> entry_type   = 0;
+        virtual auto code_size(void) const -> uint32_t     = 0;
+        // extensions the code may use; it must only run on a CPU whose
+        // host_cpu_features() includes them
+        virtual auto features(void) const -> cpu_features  = 0;
+        // copy of the code that jit_backend::load() accepts in another process
+        virtual auto image(void) const -> code_image       = 0;
+        virtual auto sandbox(void) const -> memory_sandbox = 0;
+        // where a faulting linear memory access resumes to fail the run
+        // (see memory_fault_scope)
+        virtual auto memory_fault_exit(void) -> uintptr_t  = 0;
     };
 
     class jit_backend
@@ -34,9 +70,24 @@ namespace j1t::hal
         virtual ~jit_backend(void)                                                      = default;
 
         virtual auto compile(const vm::program &prog) -> std::unique_ptr<compiled_code> = 0;
+        virtual auto target_features(void) const -> cpu_features                        = 0;
+        // identifies the code generator; together with target_features() it
+        // decides whether code compiled by one backend is valid for another
+        virtual auto name(void) const -> const char *                                   = 0;
+        // bumped whenever the emitted code changes; persisted images from
+        // another version must not be loaded
+        virtual auto version(void) const -> uint32_t                                    = 0;
+        // installs an image taken from code this backend (same name() and
+        // version()) compiled, patching its relocations; nullptr when the
+        // image is malformed or needs features outside target_features()
+        virtual auto load(const code_image &image) -> std::unique_ptr<compiled_code>   = 0;
     };
 
+    // targets host_cpu_features()
     auto make_native_jit_backend(void) -> std::unique_ptr<jit_backend>;
+    // targets an explicit feature set, e.g. a baseline for portable code
+    auto make_native_jit_backend(cpu_features target_features, memory_sandbox sandbox = memory_sandbox::GUARD_PAGES)
+        -> std::unique_ptr<jit_backend>;
 }
 
 #endif
@@ -0,0 +1,74 @@
+#ifndef J1T_HAL_INTERFACE_LINEAR_MEMORY_HPP
+#define J1T_HAL_INTERFACE_LINEAR_MEMORY_HPP
+
+#include <hal/interface/jit_backend.hpp>
+
+#include <span>
+#include <stdint.h>
+
+namespace j1t::hal
+{
+    class linear_memory;
+    class memory_fault_scope;
+
+    // Linear memory for compiled code that skips bounds checks. Reserves
+    // every address a 32-bit index plus a 4-byte access can reach, but only
+    // the pages holding the contents are accessible, and the contents end
+    // exactly where they end: the first byte past size() is inaccessible.
+    // Out-of-bounds accesses therefore fault instead of touching anything
+    // else; memory_fault_scope turns those faults into errors. Throws
+    // std::runtime_error when the address space cannot be reserved.
+    class linear_memory
+    {
+      public:
+        explicit linear_memory(std::span<const uint8_t> contents);
+        ~linear_memory(void);
+
+        linear_memory(const linear_memory &)                     = delete;
+        auto operator=(const linear_memory &) -> linear_memory & = delete;
+
+        auto data(void) -> uint8_t *;
+        auto size(void) const -> uintmax_t;
+        // whether address lies in the reservation, accessible or not
+        auto reserves(uintptr_t address) const -> bool;
+
+      private:
+        uint8_t  *reservation_internal { nullptr };
+        uintmax_t reservation_size_internal { 0 };
+        uint8_t  *data_internal { nullptr };
+        uintmax_t size_internal { 0 };
+    };
+
+    // While alive, a fault on this thread inside compiled's code that hits
+    // memory's reservation resumes at compiled.memory_fault_exit(), which
+    // fails the run with a memory error. Every other fault goes to the
+    // handler that was installed before. Scopes nest.
+    class memory_fault_scope
+    {
+      public:
+        memory_fault_scope(const linear_memory &memory, compiled_code &compiled);
+        ~memory_fault_scope(void);
+
+        memory_fault_scope(const memory_fault_scope &)                     = delete;
+        auto operator=(const memory_fault_scope &) -> memory_fault_scope & = delete;
+
+        struct route
+        {
+            const linear_memory *memory { nullptr };
+            uintptr_t            code_begin { 0 };
+            uintptr_t            code_end { 0 };
+            uintptr_t            resume { 0 };
+        };
+
+      private:
+        route        route_internal {};
+        const route *outer_internal { nullptr };
+    };
+
+    // program counter of the thread interrupted by a signal, given the
+    // handler's context argument; per architecture and OS
+    auto signal_program_counter(const void *signal_context) -> uintptr_t;
+    auto set_signal_program_counter(void *signal_context, uintptr_t program_counter) -> void;
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef J1T_HAL_INTERFACE_LOCAL_ALLOCATOR_HPP
+#define J1T_HAL_INTERFACE_LOCAL_ALLOCATOR_HPP
+
+#include <span>
+#include <stdint.h>
+#include <vector>
+
+namespace j1t::vm
+{
+    struct program;
+}
+
+namespace j1t::hal
+{
+    struct local_register;
+
+    // a VM local that lives in a machine register for a whole compiled
+    // program: loaded from jit_context::locals on entry, written back on exit
+    struct local_register
+    {
+        uint32_t local_index { 0 };
+        uint32_t machine_register { 0 };
+    };
+
+    // Picks the locals of target_program worth keeping in registers, at
+    // most one per entry of registers (which must be callee-saved, so
+    // helper calls leave them alone). Only locals accessed inside a loop
+    // qualify; each access counts eight times more per level of loop
+    // nesting, and the heaviest locals win. Programs whose bytecode has no
+    // single decoding get none.
+    auto allocate_local_registers(const j1t::vm::program &target_program, std::span<const uint32_t> registers)
+        -> std::vector<local_register>;
+}
+
+#endif
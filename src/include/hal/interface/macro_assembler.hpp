@@ -1,7 +1,8 @@
 #ifndef J1T_HAL_INTERFACE_MACRO_ASSEMBLER_HPP
 #define J1T_HAL_INTERFACE_MACRO_ASSEMBLER_HPP
 
-#include <hal/interface/executable_memory.hpp>
+#include <hal/interface/code_buffer.hpp>
+#include <hal/interface/cpu_features.hpp>
 #include <stdint.h>
 
 namespace j1t::hal
@@ -18,7 +19,7 @@ namespace j1t::hal
 
         virtual ~macro_assembler(void)                                                                        = default;
 
-        virtual auto set_output(j1t::hal::executable_memory &output_memory) -> void                           = 0;
+        virtual auto set_output(j1t::hal::code_buffer &output_buffer) -> void                                = 0;
 
         virtual auto create_label(void) -> label                                                              = 0;
         virtual auto bind_label(label target_label) -> void                                                   = 0;
@@ -36,6 +37,24 @@ namespace j1t::hal
             emit_store_u32_from_register_to_base_plus_offset(uint32_t source_register, uint32_t base_register, int32_t offset)
                 -> void
             = 0;
+        // [base + index], index a zero-extended u32 register; loads
+        // zero-extend into destination
+        virtual auto emit_load_u8_from_base_plus_index(uint32_t destination_register, uint32_t base_register, uint32_t index_register)
+            -> void
+            = 0;
+        virtual auto
+            emit_load_u16_from_base_plus_index(uint32_t destination_register, uint32_t base_register, uint32_t index_register)
+                -> void
+            = 0;
+        virtual auto
+            emit_load_u32_from_base_plus_index(uint32_t destination_register, uint32_t base_register, uint32_t index_register)
+                -> void
+            = 0;
+        virtual auto
+            emit_store_u8_from_register_to_base_plus_index(uint32_t source_register, uint32_t base_register, uint32_t index_register)
+                -> void
+            = 0;
+
         virtual auto
             emit_subtract_u32_register(uint32_t destination_register, uint32_t left_register, uint32_t right_register)
                 -> void
@@ -93,6 +112,10 @@ namespace j1t::hal
 
         // pointer/addr operations (architecture-independent meaning)
         virtual auto emit_move_pointer_immediate(uint32_t destination_register, uintptr_t immediate_value) -> void = 0;
+        // same, but always with the full-width encoding so the value can be
+        // rewritten in place later (see the arch's patch_move_pointer());
+        // returns the offset of the sequence
+        virtual auto emit_move_pointer_patchable(uint32_t destination_register, uintptr_t immediate_value) -> uint32_t = 0;
 
         virtual auto emit_move_pointer_register(uint32_t destination_register, uint32_t source_register) -> void   = 0;
 
@@ -104,6 +127,11 @@ namespace j1t::hal
 
         virtual auto finalize(void) -> void                                 = 0;
         virtual auto code_size_bytes(void) const -> uint32_t                = 0;
+
+        // extensions the assembler may pick encodings for; defaults to none
+        // (baseline ISA only)
+        virtual auto set_features(const cpu_features &target_features) -> void = 0;
+        virtual auto features(void) const -> cpu_features                      = 0;
     };
 }
 
@@ -0,0 +1,32 @@
+#ifndef J1T_HAL_INTERFACE_MAPPED_FILE_HPP
+#define J1T_HAL_INTERFACE_MAPPED_FILE_HPP
+
+#include <filesystem>
+#include <stdint.h>
+
+namespace j1t::hal
+{
+    class mapped_file;
+
+    // read-only, private mapping of a whole file; throws std::runtime_error
+    // when the file cannot be opened or mapped
+    class mapped_file
+    {
+      public:
+        explicit mapped_file(const std::filesystem::path &path);
+        ~mapped_file(void);
+
+        mapped_file(const mapped_file &)                     = delete;
+        auto operator=(const mapped_file &) -> mapped_file & = delete;
+
+        // nullptr for an empty file
+        auto data(void) const -> const uint8_t *;
+        auto size(void) const -> uintmax_t;
+
+      private:
+        void     *mapping_internal { nullptr };
+        uintmax_t size_internal { 0 };
+    };
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef J1T_HAL_INTERFACE_OPERAND_STACK_CACHE_HPP
+#define J1T_HAL_INTERFACE_OPERAND_STACK_CACHE_HPP
+
+#include <hal/interface/macro_assembler.hpp>
+
+#include <optional>
+#include <span>
+#include <stdint.h>
+#include <vector>
+
+namespace j1t::hal
+{
+    class operand_stack_cache;
+
+    // Compile-time model of the top of a JIT's in-memory operand stack.
+    //
+    // Pushed values stay in scratch registers, or as constants not yet
+    // materialized, until flush() writes them out, so straight-line code
+    // does not go through memory for every push and pop. The stack top
+    // register always points one past the last value in memory; cached
+    // values sit logically above it. Callers flush at basic block
+    // boundaries, before helper calls (the cache registers are
+    // caller-saved) and before leaving compiled code.
+    class operand_stack_cache
+    {
+      public:
+        // bounds the offsets and the stack top adjustment of one flush, which
+        // have to fit the short immediates of every target
+        static constexpr std::size_t MAX_CACHED_ENTRIES { 32u };
+
+        // scratch_register is clobbered while constants are spilled and
+        // must not be one of cache_registers
+        operand_stack_cache(
+            macro_assembler          &assembler,
+            uint32_t                  stack_top_register,
+            uint32_t                  scratch_register,
+            std::span<const uint32_t> cache_registers
+        );
+
+        // a free cache register, spilling the lowest cached values when all
+        // are in use; owned by the caller until pushed or released
+        auto allocate(void) -> uint32_t;
+        auto release(uint32_t cache_register) -> void;
+
+        // takes ownership of a register from allocate() or pop_to_register()
+        auto push_register(uint32_t cache_register) -> void;
+        auto push_constant(uint32_t value) -> void;
+
+        // pops the top value into a cache register the caller then owns
+        auto pop_to_register(void) -> uint32_t;
+        // pops the top value into destination_register, which must not be
+        // a cache register
+        auto pop_into(uint32_t destination_register) -> void;
+        auto drop(void) -> void;
+
+        // writes every cached value to memory and advances the stack top
+        auto flush(void) -> void;
+        auto cached_count(void) const -> uint32_t;
+        // the top value if it is a constant not yet materialized, so the
+        // op consuming it can fold it into an immediate
+        auto top_constant(void) const -> std::optional<uint32_t>;
+
+      private:
+        struct entry
+        {
+            bool     is_constant { false };
+            uint32_t cache_register { 0 };
+            uint32_t value { 0 };
+        };
+
+        // writes entries [0, count) to memory and drops them from the cache
+        auto spill_lowest(std::size_t count) -> void;
+        auto make_room(void) -> void;
+
+      private:
+        macro_assembler      &assembler_internal;
+        uint32_t              stack_top_register_internal { 0 };
+        uint32_t              scratch_register_internal { 0 };
+        // bottom to top
+        std::vector<entry>    entries;
+        std::vector<uint32_t> free_registers;
+    };
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef J1T_HAL_LINUX_EXECUTABLE_MEMORY_LINUX_HPP
+#define J1T_HAL_LINUX_EXECUTABLE_MEMORY_LINUX_HPP
+
+#include <hal/interface/executable_memory.hpp>
+
+namespace j1t::hal::linux_os
+{
+    // W^X through a dual mapping: one memfd is mapped twice, RW for the
+    // assembler and RX for execution, so no mprotect is ever needed. Falls back
+    // to a single anonymous mapping toggled with mprotect when memfd_create is
+    // unavailable.
+    //
+    // With prefer_huge_pages the memfd is first created on hugetlbfs; if no
+    // huge pages are reserved the regular mapping is advised for transparent
+    // huge pages instead.
+    class executable_memory_linux final : public j1t::hal::executable_memory
+    {
+      public:
+        executable_memory_linux(uintmax_t size, bool prefer_huge_pages = false);
+        ~executable_memory_linux(void) override;
+
+        auto data(void) -> uint8_t * override;
+        auto executable_data(void) const -> const uint8_t * override;
+        auto size(void) const -> uintmax_t override;
+
+        auto begin_write(void) -> void override;
+        auto end_write(void) -> void override;
+        auto is_executable_while_writing(void) const -> bool override;
+
+        auto finalize(void) -> void override;
+
+        auto is_dual_mapped(void) const -> bool;
+        auto is_hugetlb_backed(void) const -> bool;
+
+      private:
+        auto map_dual(unsigned int memfd_flags, uintmax_t mapping_size) -> bool;
+        auto map_single(void) -> void;
+        auto advise_huge_pages(void) -> void;
+
+      private:
+        uint8_t  *writable_memory_internal { nullptr };
+        uint8_t  *executable_memory_internal { nullptr };
+        uintmax_t size_internal { 0 };
+        bool      is_writable { true };
+        bool      is_hugetlb { false };
+    };
+}
+
+#endif
@@ -0,0 +1,254 @@
+#ifndef J1T_HAL_X86_64_MACRO_ASSEMBLER_HPP
+#define J1T_HAL_X86_64_MACRO_ASSEMBLER_HPP
+
+#include <hal/interface/macro_assembler.hpp>
+
+#include <vector>
+
+namespace j1t::hal::x86_64
+{
+    // general purpose register numbers (ModRM / REX encoding order)
+    enum : uint32_t
+    {
+        RAX = 0,
+        RCX,
+        RDX,
+        RBX,
+        RSP,
+        RBP,
+        RSI,
+        RDI,
+        R8,
+        R9,
+        R10,
+        R11,
+        R12,
+        R13,
+        R14,
+        R15,
+    };
+
+    // condition codes (low nibble of Jcc / SETcc)
+    enum : uint32_t
+    {
+        CONDITION_OVERFLOW      = 0x0,
+        CONDITION_NO_OVERFLOW   = 0x1,
+        CONDITION_BELOW         = 0x2,
+        CONDITION_ABOVE_EQUAL   = 0x3,
+        CONDITION_EQUAL         = 0x4,
+        CONDITION_NOT_EQUAL     = 0x5,
+        CONDITION_BELOW_EQUAL   = 0x6,
+        CONDITION_ABOVE         = 0x7,
+        CONDITION_SIGN          = 0x8,
+        CONDITION_NOT_SIGN      = 0x9,
+        CONDITION_PARITY        = 0xA,
+        CONDITION_NOT_PARITY    = 0xB,
+        CONDITION_LESS          = 0xC,
+        CONDITION_GREATER_EQUAL = 0xD,
+        CONDITION_LESS_EQUAL    = 0xE,
+        CONDITION_GREATER       = 0xF,
+    };
+
+    class macro_assembler final : public j1t::hal::macro_assembler
+    {
+      public:
+        auto set_output(j1t::hal::code_buffer &output_buffer) -> void override;
+
+        auto create_label(void) -> label override;
+        auto bind_label(label target_label) -> void override;
+
+        auto branch(label target_label) -> void override;
+        auto branch_equal(label target_label) -> void override;
+        auto branch_not_equal(label target_label) -> void override;
+
+        auto emit_move_immediate_u32(uint32_t destination_register, uint32_t immediate_value) -> void override;
+        auto emit_load_u32_from_base_plus_offset(uint32_t destination_register, uint32_t base_register, int32_t offset)
+            -> void override;
+        auto emit_store_u32_from_register_to_base_plus_offset(uint32_t source_register, uint32_t base_register, int32_t offset)
+            -> void override;
+        auto emit_load_u8_from_base_plus_index(uint32_t destination_register, uint32_t base_register, uint32_t index_register)
+            -> void override;
+        auto emit_load_u16_from_base_plus_index(uint32_t destination_register, uint32_t base_register, uint32_t index_register)
+            -> void override;
+        auto emit_load_u32_from_base_plus_index(uint32_t destination_register, uint32_t base_register, uint32_t index_register)
+            -> void override;
+        auto emit_store_u8_from_register_to_base_plus_index(
+            uint32_t source_register,
+            uint32_t base_register,
+            uint32_t index_register
+        ) -> void override;
+        auto emit_add_pointer_register(uint32_t destination_register, uint32_t left_register, uint32_t right_register)
+            -> void override;
+        auto emit_shift_left_u32_immediate(uint32_t destination_register, uint32_t source_register, uint32_t shift)
+            -> void override;
+        auto emit_move_u32_register(uint32_t destination_register, uint32_t source_register) -> void override;
+        auto emit_move_pointer_immediate(uint32_t destination_register, uintptr_t immediate_value) -> void override;
+        auto emit_move_pointer_patchable(uint32_t destination_register, uintptr_t immediate_value) -> uint32_t override;
+        static constexpr uint32_t PATCHABLE_MOVE_POINTER_SIZE { 10u };
+        // rewrites the value loaded by the emit_move_pointer_patchable()
+        // sequence at offset in code
+        static auto patch_move_pointer(code_buffer &code, uint32_t offset, uintptr_t immediate_value) -> void;
+
+        auto emit_move_pointer_register(uint32_t destination_register, uint32_t source_register) -> void override;
+
+        auto emit_call_register(uint32_t function_register) -> void override;
+        auto emit_subtract_u32_register(uint32_t destination_register, uint32_t left_register, uint32_t right_register)
+            -> void override;
+
+        auto emit_multiply_u32_register(uint32_t destination_register, uint32_t left_register, uint32_t right_register)
+            -> void override;
+
+        // NOTE: divisions are lowered to DIV/IDIV and clobber rax and rdx;
+        // right_register must be neither of them.
+        auto emit_divide_u32_register(uint32_t destination_register, uint32_t left_register, uint32_t right_register)
+            -> void override;
+        auto emit_divide_i32_register(uint32_t destination_register, uint32_t left_register, uint32_t right_register)
+            -> void override;
+
+        auto emit_cset_u32(uint32_t destination_register, uint32_t condition) -> void override;
+
+        auto emit_load_pointer_from_base_plus_offset(uint32_t destination_register, uint32_t base_register, int32_t offset)
+            -> void override;
+        auto emit_store_pointer_from_register_to_base_plus_offset(
+            uint32_t source_register,
+            uint32_t base_register,
+            int32_t  offset
+        ) -> void override;
+
+        auto emit_add_immediate_to_pointer(uint32_t destination_register, uint32_t source_register, uint32_t immediate_value)
+            -> void override;
+        auto emit_subtract_immediate_from_pointer(
+            uint32_t destination_register,
+            uint32_t source_register,
+            uint32_t immediate_value
+        ) -> void override;
+
+        auto emit_add_u32_register(uint32_t destination_register, uint32_t left_register, uint32_t right_register)
+            -> void override;
+        auto emit_compare_u32_registers(uint32_t left_register, uint32_t right_register) -> void override;
+
+        auto emit_compare_pointer_registers(uint32_t left_register, uint32_t right_register) -> void override;
+
+        auto emit_return(void) -> void override;
+
+        auto finalize(void) -> void override;
+        auto code_size_bytes(void) const -> uint32_t override;
+
+        auto set_features(const cpu_features &target_features) -> void override;
+        auto features(void) const -> cpu_features override;
+
+      public:
+        // no override
+        auto branch_cond(uint32_t condition, label target_label) -> void;
+
+        // rel8 forms: the caller guarantees the target is within
+        // [-128, 127] bytes (checked in finalize)
+        auto branch_short(label target_label) -> void;
+        auto branch_cond_short(uint32_t condition, label target_label) -> void;
+
+        auto emit_compare_u32_immediate(uint32_t left_register, int32_t immediate_value) -> void;
+        auto emit_test_u32_registers(uint32_t left_register, uint32_t right_register) -> void;
+        auto emit_negate_u32(uint32_t destination_register) -> void;
+        // destination &= [base + offset]
+        auto emit_and_u32_from_base_plus_offset(uint32_t destination_register, uint32_t base_register, int32_t offset)
+            -> void;
+
+        auto emit_shift_right_u32_immediate(uint32_t destination_register, uint32_t source_register, uint32_t shift) -> void;
+        auto emit_shift_right_i32_immediate(uint32_t destination_register, uint32_t source_register, uint32_t shift) -> void;
+        auto emit_multiply_u32_immediate(uint32_t destination_register, uint32_t source_register, int32_t immediate_value)
+            -> void;
+        // destination = high 32 bits of the 64-bit product of source and
+        // immediate_value, both sign-extended
+        auto emit_multiply_high_i32_immediate(uint32_t destination_register, uint32_t source_register, int32_t immediate_value)
+            -> void;
+        // destination = left + (right << shift), shift at most 3 (LEA)
+        auto emit_add_shifted_u32_register(
+            uint32_t destination_register,
+            uint32_t left_register,
+            uint32_t right_register,
+            uint32_t shift
+        ) -> void;
+
+        auto debug_output_base(void) const -> const uint8_t *;
+
+      private:
+        struct label_state
+        {
+            bool     is_bound { false };
+            uint32_t program_counter { 0 };
+        };
+
+        struct branch_patch
+        {
+            // position of the displacement field
+            uint32_t displacement_address_bytes { 0 };
+            uint32_t target_label_id { 0 };
+            enum class type
+            {
+                REL8,
+                REL32,
+            } patch_type { type::REL32 };
+        };
+
+      private:
+        auto emit_u8(uint8_t value) -> void;
+        auto emit_u32_le(uint32_t value) -> void;
+        auto emit_u64_le(uint64_t value) -> void;
+        auto overwrite_u8(uint32_t address_bytes, uint8_t value) -> void;
+        auto overwrite_u32_le(uint32_t address_bytes, uint32_t value) -> void;
+
+        auto emit_rex(bool is_wide, uint32_t reg, uint32_t index, uint32_t base, bool force = false) -> void;
+        auto emit_modrm_register(uint32_t reg, uint32_t rm) -> void;
+        auto emit_modrm_memory(uint32_t reg, uint32_t base_register, int32_t offset) -> void;
+
+        // opcodes above 0xFF are two-byte (0x0F-escaped) opcodes
+        auto emit_opcode(uint32_t opcode) -> void;
+
+        // op reg, rm  (both registers)
+        auto emit_register_register(uint32_t opcode, bool is_wide, uint32_t reg, uint32_t rm, bool force_rex = false)
+            -> void;
+        // op reg, [base + offset]
+        auto emit_register_memory(uint32_t opcode, bool is_wide, uint32_t reg, uint32_t base_register, int32_t offset)
+            -> void;
+        // op reg, [base + (index << scale_shift) + offset]
+        auto emit_register_memory_indexed(
+            uint32_t opcode,
+            bool     is_wide,
+            uint32_t reg,
+            uint32_t base_register,
+            uint32_t index_register,
+            int32_t  offset,
+            uint32_t scale_shift,
+            bool     force_rex = false
+        ) -> void;
+        // lea destination, [base + (index << scale_shift) + offset]
+        auto emit_lea(
+            bool     is_wide,
+            uint32_t destination_register,
+            uint32_t base_register,
+            uint32_t index_register,
+            int32_t  offset,
+            uint32_t scale_shift = 0u
+        ) -> void;
+        // group-1 arithmetic with immediate (add = 0, sub = 5, cmp = 7)
+        auto emit_arithmetic_immediate(uint32_t extension, bool is_wide, uint32_t register_number, int32_t immediate_value)
+            -> void;
+        // group-2 shift by immediate (shl = 4, shr = 5, sar = 7)
+        auto emit_shift_immediate(uint32_t extension, bool is_wide, uint32_t register_number, uint32_t shift) -> void;
+
+        auto emit_branch(uint8_t short_opcode, uint8_t near_opcode_prefix, uint8_t near_opcode, bool force_short, label target_label)
+            -> void;
+
+      private:
+        static constexpr uint32_t NO_INDEX { 0xFFFF'FFFFu };
+
+        code_buffer *output_buffer_internal { nullptr };
+        uint32_t     program_counter { 0 };
+        cpu_features features_internal {};
+
+        std::vector<label_state>  label_states;
+        std::vector<branch_patch> branch_patches;
+    };
+}
+
+#endif
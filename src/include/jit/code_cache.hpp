@@ -0,0 +1,271 @@
+#ifndef J1T_JIT_CODE_CACHE_HPP
+#define J1T_JIT_CODE_CACHE_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include <hal/interface/jit_backend.hpp>
+#include <jit/disk_code_cache.hpp>
+#include <util/hash.hpp>
+#include <vm/interpreter.hpp>
+
+namespace j1t::jit
+{
+    class code_cache;
+
+    // Compiled code keyed by the bytecode it was compiled from and by the
+    // backend that compiled it, so running the same program again skips the
+    // compile. Entries are evicted least recently used first once their code
+    // and key bytes exceed the budget; code still referenced by a caller
+    // stays alive until released. Misses may be served from a
+    // disk_code_cache, which also receives everything compiled here.
+    // Thread-safe.
+    class code_cache
+    {
+      public:
+        static constexpr uintmax_t DEFAULT_BUDGET_BYTES { 16u * 1024u * 1024u };
+
+        struct statistics
+        {
+            uint64_t    hits { 0 };
+            uint64_t    misses { 0 };
+            uint64_t    evictions { 0 };
+            // compiled code plus key bytes of the resident entries
+            uintmax_t   resident_bytes { 0 };
+            std::size_t entries { 0 };
+        };
+
+        explicit code_cache(uintmax_t budget_bytes = DEFAULT_BUDGET_BYTES)
+            : budget(budget_bytes)
+        {
+        }
+
+        code_cache(const code_cache &)                     = delete;
+        auto operator=(const code_cache &) -> code_cache & = delete;
+
+        // used by the engines unless they are given another cache
+        static auto shared(void) -> code_cache &
+        {
+            static code_cache instance {};
+            return instance;
+        }
+
+        // nullptr on a miss
+        auto lookup(const j1t::vm::program &program, const j1t::hal::jit_backend &backend)
+            -> std::shared_ptr<j1t::hal::compiled_code>
+        {
+            const key                   wanted = key_of(program, backend);
+            std::lock_guard<std::mutex> lock(cache_mutex);
+
+            auto found = find(wanted, program);
+            if (found == recency.end())
+            {
+                ++counters.misses;
+                return nullptr;
+            }
+
+            ++counters.hits;
+            recency.splice(recency.begin(), recency, found);
+            return found->compiled;
+        }
+
+        // Returns the cached code or compiles and inserts it. Compiles
+        // outside the lock; when two threads miss on the same program the
+        // first insert wins. Propagates what backend.compile() throws and
+        // caches nothing if it returns nullptr.
+        auto get_or_compile(const j1t::vm::program &program, j1t::hal::jit_backend &backend)
+            -> std::shared_ptr<j1t::hal::compiled_code>
+        {
+            if (std::shared_ptr<j1t::hal::compiled_code> cached = lookup(program, backend))
+            {
+                return cached;
+            }
+
+            return fill(program, backend);
+        }
+
+        // the miss path of get_or_compile(): loads program from the disk
+        // cache or compiles (and persists) it, then inserts it
+        auto fill(const j1t::vm::program &program, j1t::hal::jit_backend &backend)
+            -> std::shared_ptr<j1t::hal::compiled_code>
+        {
+            const std::shared_ptr<disk_code_cache> disk = persistent();
+
+            std::shared_ptr<j1t::hal::compiled_code> compiled = disk ? disk->load(program, backend) : nullptr;
+            if (!compiled)
+            {
+                compiled = backend.compile(program);
+                if (!compiled)
+                {
+                    return nullptr;
+                }
+
+                if (disk)
+                {
+                    disk->store(program, backend, *compiled);
+                }
+            }
+
+            return insert(program, backend, std::move(compiled));
+        }
+
+        // returns the resident code for program, which is compiled unless
+        // another thread inserted first
+        auto insert(const j1t::vm::program                  &program,
+                    const j1t::hal::jit_backend             &backend,
+                    std::shared_ptr<j1t::hal::compiled_code> compiled) -> std::shared_ptr<j1t::hal::compiled_code>
+        {
+            const key       wanted = key_of(program, backend);
+            const uintmax_t bytes  = uintmax_t { compiled->code_size() } + program.code.size();
+
+            std::lock_guard<std::mutex> lock(cache_mutex);
+
+            auto found = find(wanted, program);
+            if (found != recency.end())
+            {
+                recency.splice(recency.begin(), recency, found);
+                return found->compiled;
+            }
+
+            // never resident, but still usable by the caller
+            if (bytes > budget)
+            {
+                return compiled;
+            }
+
+            recency.push_front(entry { wanted, program.code, compiled, bytes });
+            index.emplace(wanted.content, recency.begin());
+            counters.resident_bytes += bytes;
+            counters.entries        += 1u;
+
+            evict_to(budget);
+            return compiled;
+        }
+
+        // nullptr turns persistence off
+        auto set_disk_cache(std::shared_ptr<disk_code_cache> disk) -> void
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            disk_cache = std::move(disk);
+        }
+
+        auto set_budget(uintmax_t budget_bytes) -> void
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+
+            budget = budget_bytes;
+            evict_to(budget);
+        }
+
+        // drops every entry; not counted as evictions
+        auto clear(void) -> void
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+
+            index.clear();
+            recency.clear();
+            counters.resident_bytes = 0;
+            counters.entries        = 0;
+        }
+
+        auto stats(void) const -> statistics
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            return counters;
+        }
+
+      private:
+        struct key
+        {
+            // hash of the bytecode, seeded with backend
+            uint64_t content { 0 };
+            // backend name and target features
+            uint64_t backend { 0 };
+        };
+
+        struct entry
+        {
+            key                                      id {};
+            // compared on lookup; a hash match alone is not trusted
+            std::vector<uint8_t>                     code;
+            std::shared_ptr<j1t::hal::compiled_code> compiled;
+            uintmax_t                                bytes { 0 };
+        };
+
+        static auto key_of(const j1t::vm::program &program, const j1t::hal::jit_backend &backend) -> key
+        {
+            const char    *name     = backend.name();
+            const uint64_t features = backend.target_features().bits;
+
+            key result {};
+            result.backend = j1t::util::hash_bytes(std::span(reinterpret_cast<const uint8_t *>(name), strlen(name)), features);
+            result.content = j1t::util::hash_bytes(program.code, result.backend);
+            return result;
+        }
+
+        auto persistent(void) const -> std::shared_ptr<disk_code_cache>
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            return disk_cache;
+        }
+
+        // caller holds cache_mutex
+        auto find(const key &wanted, const j1t::vm::program &program) -> std::list<entry>::iterator
+        {
+            auto [first, last] = index.equal_range(wanted.content);
+            for (auto candidate = first; candidate != last; ++candidate)
+            {
+                const entry &resident = *candidate->second;
+                if (resident.id.backend == wanted.backend && resident.code == program.code)
+                {
+                    return candidate->second;
+                }
+            }
+
+            return recency.end();
+        }
+
+        // caller holds cache_mutex
+        auto evict_to(uintmax_t limit) -> void
+        {
+            while (counters.resident_bytes > limit && !recency.empty())
+            {
+                auto victim = std::prev(recency.end());
+
+                auto [first, last] = index.equal_range(victim->id.content);
+                for (auto candidate = first; candidate != last; ++candidate)
+                {
+                    if (candidate->second == victim)
+                    {
+                        index.erase(candidate);
+                        break;
+                    }
+                }
+
+                counters.resident_bytes -= victim->bytes;
+                counters.entries        -= 1u;
+                counters.evictions      += 1u;
+                recency.pop_back();
+            }
+        }
+
+      private:
+        mutable std::mutex                                            cache_mutex;
+        uintmax_t                                                     budget { DEFAULT_BUDGET_BYTES };
+        // most recently used first
+        std::list<entry>                                              recency;
+        std::unordered_multimap<uint64_t, std::list<entry>::iterator> index;
+        statistics                                                    counters {};
+        std::shared_ptr<disk_code_cache>                              disk_cache;
+    };
+}
+
+#endif
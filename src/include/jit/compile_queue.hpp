@@ -0,0 +1,164 @@
+#ifndef J1T_JIT_COMPILE_QUEUE_HPP
+#define J1T_JIT_COMPILE_QUEUE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <stop_token>
+#include <thread>
+
+#include <hal/interface/icache.hpp>
+#include <hal/interface/jit_backend.hpp>
+#include <jit/code_cache.hpp>
+#include <vm/interpreter.hpp>
+
+namespace j1t::jit
+{
+    class compile_queue;
+
+    // Compiles programs on a worker thread so the submitter keeps
+    // interpreting. A ticket's code becomes visible only after it has been
+    // fully written, flushed and finalized; the submitter polls the ticket at
+    // its own safe points and switches over once it is ready. Programs
+    // already in the code cache are ready on submission.
+    class compile_queue
+    {
+      public:
+        class ticket
+        {
+          public:
+            enum class status : uint8_t
+            {
+                PENDING,
+                READY,
+                FAILED,
+            };
+
+            explicit ticket(const j1t::vm::program &program)
+                : source(program)
+            {
+            }
+
+            auto state(void) const -> status
+            {
+                return progress.load(std::memory_order_acquire);
+            }
+
+            // nullptr until state() is READY; the first call on each thread
+            // after that must happen before the code is entered
+            auto code(void) const -> j1t::hal::compiled_code *
+            {
+                if (state() != status::READY)
+                {
+                    return nullptr;
+                }
+
+                j1t::hal::synchronize_instruction_stream();
+
+                return compiled.get();
+            }
+
+          private:
+            friend class compile_queue;
+
+            // the worker works on its own copy; the submitter may drop or
+            // modify its program while the compile is in flight
+            j1t::vm::program                         source;
+            std::shared_ptr<j1t::hal::compiled_code> compiled;
+            std::atomic<status>                      progress { status::PENDING };
+        };
+
+        explicit compile_queue(std::unique_ptr<j1t::hal::jit_backend> backend, code_cache &cache = code_cache::shared())
+            : backend(std::move(backend))
+            , cache(&cache)
+            , worker([this](std::stop_token stop) { serve(stop); })
+        {
+        }
+
+        compile_queue(const compile_queue &)                     = delete;
+        auto operator=(const compile_queue &) -> compile_queue & = delete;
+
+        auto submit(const j1t::vm::program &program) -> std::shared_ptr<ticket>
+        {
+            auto submitted = std::make_shared<ticket>(program);
+
+            // name() and target_features() are safe to call while the worker
+            // compiles
+            if (std::shared_ptr<j1t::hal::compiled_code> cached = cache->lookup(program, *backend))
+            {
+                submitted->compiled = std::move(cached);
+                submitted->progress.store(ticket::status::READY, std::memory_order_release);
+                return submitted;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                pending.push_back(submitted);
+            }
+            wake.notify_one();
+
+            return submitted;
+        }
+
+      private:
+        auto serve(std::stop_token stop) -> void
+        {
+            for (;;)
+            {
+                std::shared_ptr<ticket> next;
+
+                {
+                    std::unique_lock<std::mutex> lock(queue_mutex);
+                    if (!wake.wait(lock, stop, [this] { return !pending.empty(); }))
+                    {
+                        return;
+                    }
+
+                    next = std::move(pending.front());
+                    pending.pop_front();
+                }
+
+                // nobody is waiting for this one any more
+                if (next.use_count() == 1)
+                {
+                    continue;
+                }
+
+                compile(*next);
+            }
+        }
+
+        auto compile(ticket &target) -> void
+        {
+            // the backends reject what they cannot compile by throwing;
+            // install_code() has flushed and finalized before fill() returns,
+            // so the release below publishes complete code
+            try
+            {
+                target.compiled = cache->fill(target.source, *backend);
+            }
+            catch (const std::runtime_error &)
+            {
+                target.compiled.reset();
+            }
+
+            const ticket::status outcome = target.compiled ? ticket::status::READY : ticket::status::FAILED;
+            target.progress.store(outcome, std::memory_order_release);
+        }
+
+      private:
+        std::unique_ptr<j1t::hal::jit_backend> backend;
+        code_cache                            *cache { nullptr };
+        std::mutex                             queue_mutex;
+        std::condition_variable_any            wake;
+        std::deque<std::shared_ptr<ticket>>    pending;
+        // declared last: started after, and stopped and joined before,
+        // everything above; a compile in progress finishes first
+        std::jthread                           worker;
+    };
+}
+
+#endif
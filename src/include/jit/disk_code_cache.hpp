@@ -0,0 +1,329 @@
+#ifndef J1T_JIT_DISK_CODE_CACHE_HPP
+#define J1T_JIT_DISK_CODE_CACHE_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <hal/interface/code_image.hpp>
+#include <hal/interface/jit_backend.hpp>
+#include <hal/interface/mapped_file.hpp>
+#include <util/hash.hpp>
+#include <vm/interpreter.hpp>
+
+namespace j1t::jit
+{
+    class disk_code_cache;
+
+    // Compiled code persisted in a directory, one file per program and
+    // backend, so a new process can skip compiling programs an earlier one
+    // compiled. Files hold a code_image: the code, its entry points and the
+    // relocation table for helper addresses, which jit_backend::load()
+    // patches for this process. Files are written under a temporary name
+    // and renamed into place, so concurrent processes never read a partial
+    // file, and a payload hash rejects files damaged later. Every failure
+    // is treated as a miss; this is only a cache.
+    class disk_code_cache
+    {
+      public:
+        struct statistics
+        {
+            uint64_t hits { 0 };
+            uint64_t misses { 0 };
+            // files that exist but are corrupt, stale or do not match
+            uint64_t rejected { 0 };
+            uint64_t stores { 0 };
+        };
+
+        explicit disk_code_cache(std::filesystem::path directory)
+            : root(std::move(directory))
+        {
+            std::error_code ignored;
+            std::filesystem::create_directories(root, ignored);
+        }
+
+        auto directory(void) const -> const std::filesystem::path &
+        {
+            return root;
+        }
+
+        // nullptr when there is no usable file for program and backend
+        auto load(const j1t::vm::program &program, j1t::hal::jit_backend &backend)
+            -> std::unique_ptr<j1t::hal::compiled_code>
+        {
+            const std::filesystem::path path = path_of(program, backend);
+
+            std::error_code missing;
+            if (!std::filesystem::is_regular_file(path, missing))
+            {
+                counters.misses.fetch_add(1u, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            try
+            {
+                const j1t::hal::mapped_file              file(path);
+                std::optional<j1t::hal::code_image>      image = parse(file, program, backend);
+                std::unique_ptr<j1t::hal::compiled_code> code  = image ? backend.load(*image) : nullptr;
+                if (!code)
+                {
+                    counters.rejected.fetch_add(1u, std::memory_order_relaxed);
+                    return nullptr;
+                }
+
+                counters.hits.fetch_add(1u, std::memory_order_relaxed);
+                return code;
+            }
+            catch (const std::runtime_error &)
+            {
+                // removed under us, or no room in the code heap
+                counters.misses.fetch_add(1u, std::memory_order_relaxed);
+                return nullptr;
+            }
+        }
+
+        // false when the file could not be written
+        auto store(const j1t::vm::program &program, const j1t::hal::jit_backend &backend, const j1t::hal::compiled_code &compiled)
+            -> bool
+        {
+            const j1t::hal::code_image image = compiled.image();
+
+            file_header header {};
+            memcpy(header.magic, MAGIC, sizeof(MAGIC));
+            header.format_version      = FORMAT_VERSION;
+            header.generator_version   = backend.version();
+            header.backend_fingerprint = fingerprint_of(backend);
+            header.features            = image.features.bits;
+            header.bytecode_size       = static_cast<uint32_t>(program.code.size());
+            header.code_size           = static_cast<uint32_t>(image.code.size());
+            header.entry_point_count   = static_cast<uint32_t>(image.entry_points.size());
+            header.relocation_count    = static_cast<uint32_t>(image.relocations.size());
+            header.memory_fault_offset = image.memory_fault_offset;
+
+            std::vector<uint8_t> bytes;
+            auto                 append = [&](const void *source, std::size_t size) -> void
+            {
+                const auto *begin = static_cast<const uint8_t *>(source);
+                bytes.insert(bytes.end(), begin, begin + size);
+            };
+
+            append(&header, sizeof(header));
+            append(program.code.data(), program.code.size());
+            for (const j1t::hal::entry_point &point : image.entry_points)
+            {
+                const uint32_t words[2] = { point.pc, point.offset };
+                append(words, sizeof(words));
+            }
+            for (const j1t::hal::relocation &site : image.relocations)
+            {
+                const uint32_t words[2] = { site.offset, static_cast<uint32_t>(site.target) };
+                append(words, sizeof(words));
+            }
+            append(image.code.data(), image.code.size());
+
+            header.payload_hash = j1t::util::hash_bytes(std::span(bytes).subspan(sizeof(header)));
+            memcpy(bytes.data(), &header, sizeof(header));
+
+            const std::filesystem::path path      = path_of(program, backend);
+            std::filesystem::path       temporary = path;
+            temporary += unique_suffix();
+
+            {
+                std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+                out.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+                if (!out)
+                {
+                    std::error_code ignored;
+                    std::filesystem::remove(temporary, ignored);
+                    return false;
+                }
+            }
+
+            std::error_code failed;
+            std::filesystem::rename(temporary, path, failed);
+            if (failed)
+            {
+                std::error_code ignored;
+                std::filesystem::remove(temporary, ignored);
+                return false;
+            }
+
+            counters.stores.fetch_add(1u, std::memory_order_relaxed);
+            return true;
+        }
+
+        auto stats(void) const -> statistics
+        {
+            statistics result {};
+            result.hits     = counters.hits.load(std::memory_order_relaxed);
+            result.misses   = counters.misses.load(std::memory_order_relaxed);
+            result.rejected = counters.rejected.load(std::memory_order_relaxed);
+            result.stores   = counters.stores.load(std::memory_order_relaxed);
+            return result;
+        }
+
+      private:
+        static constexpr char     MAGIC[8] { 'J', '1', 'T', 'C', 'O', 'D', 'E', '\0' };
+        static constexpr uint32_t FORMAT_VERSION { 2u };
+
+        // followed by the bytecode, entry points and relocations as pairs of
+        // u32, then the code; all in host byte order
+        struct file_header
+        {
+            char     magic[8];
+            uint32_t format_version;
+            uint32_t generator_version;
+            uint64_t backend_fingerprint;
+            uint64_t features;
+            uint32_t bytecode_size;
+            uint32_t code_size;
+            uint32_t entry_point_count;
+            uint32_t relocation_count;
+            uint32_t memory_fault_offset;
+            uint32_t reserved;
+            // hash_bytes() of everything after the header
+            uint64_t payload_hash;
+        };
+
+        static auto fingerprint_of(const j1t::hal::jit_backend &backend) -> uint64_t
+        {
+            const char    *name    = backend.name();
+            const uint64_t version = backend.version();
+            const uint64_t seed    = j1t::util::hash_bytes(
+                std::span(reinterpret_cast<const uint8_t *>(&version), sizeof(version)),
+                backend.target_features().bits
+            );
+
+            return j1t::util::hash_bytes(std::span(reinterpret_cast<const uint8_t *>(name), strlen(name)), seed);
+        }
+
+        auto path_of(const j1t::vm::program &program, const j1t::hal::jit_backend &backend) const -> std::filesystem::path
+        {
+            static constexpr char HEX[] = "0123456789abcdef";
+
+            uint64_t key = j1t::util::hash_bytes(program.code, fingerprint_of(backend));
+            char     name[16 + sizeof(".j1tc")];
+            for (int i = 15; i >= 0; --i)
+            {
+                name[i]   = HEX[key & 0xFu];
+                key     >>= 4u;
+            }
+            memcpy(name + 16, ".j1tc", sizeof(".j1tc"));
+
+            return root / name;
+        }
+
+        static auto unique_suffix(void) -> std::string
+        {
+            static std::atomic<uint64_t> sequence { 0 };
+
+            const uint64_t thread = std::hash<std::thread::id> {}(std::this_thread::get_id());
+            const uint64_t now    = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+            const uint64_t unique = j1t::util::hash_mix(thread ^ now, sequence.fetch_add(1u) + 1u);
+
+            return "." + std::to_string(unique) + ".tmp";
+        }
+
+        static auto parse(const j1t::hal::mapped_file &file, const j1t::vm::program &program, const j1t::hal::jit_backend &backend)
+            -> std::optional<j1t::hal::code_image>
+        {
+            const uint8_t *cursor = file.data();
+            uintmax_t      left   = file.size();
+
+            auto take = [&](void *destination, uintmax_t size) -> bool
+            {
+                if (size > left)
+                {
+                    return false;
+                }
+
+                if (size != 0u)
+                {
+                    memcpy(destination, cursor, size);
+                }
+                cursor += size;
+                left   -= size;
+                return true;
+            };
+
+            file_header header {};
+            if (!take(&header, sizeof(header)) || memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0
+                || header.format_version != FORMAT_VERSION || header.generator_version != backend.version()
+                || header.backend_fingerprint != fingerprint_of(backend) || header.bytecode_size != program.code.size())
+            {
+                return std::nullopt;
+            }
+
+            // a damaged file must not turn into damaged code
+            if (j1t::util::hash_bytes(std::span(cursor, left)) != header.payload_hash)
+            {
+                return std::nullopt;
+            }
+
+            // a hash match alone is not trusted
+            if (header.bytecode_size > left || memcmp(cursor, program.code.data(), header.bytecode_size) != 0)
+            {
+                return std::nullopt;
+            }
+            cursor += header.bytecode_size;
+            left   -= header.bytecode_size;
+
+            const uint64_t table_bytes = (uint64_t { header.entry_point_count } + header.relocation_count) * 8u;
+            if (table_bytes + header.code_size != left)
+            {
+                return std::nullopt;
+            }
+
+            j1t::hal::code_image image {};
+            image.features.bits       = header.features;
+            image.memory_fault_offset = header.memory_fault_offset;
+
+            image.entry_points.resize(header.entry_point_count);
+            for (j1t::hal::entry_point &point : image.entry_points)
+            {
+                uint32_t words[2];
+                take(words, sizeof(words));
+                point = { .pc = words[0], .offset = words[1] };
+            }
+
+            image.relocations.resize(header.relocation_count);
+            for (j1t::hal::relocation &site : image.relocations)
+            {
+                uint32_t words[2];
+                take(words, sizeof(words));
+                site = { .offset = words[0], .target = static_cast<j1t::hal::relocation_target>(words[1]) };
+            }
+
+            image.code.resize(header.code_size);
+            take(image.code.data(), header.code_size);
+
+            return image;
+        }
+
+      private:
+        struct atomic_statistics
+        {
+            std::atomic<uint64_t> hits { 0 };
+            std::atomic<uint64_t> misses { 0 };
+            std::atomic<uint64_t> rejected { 0 };
+            std::atomic<uint64_t> stores { 0 };
+        };
+
+        std::filesystem::path root;
+        atomic_statistics     counters {};
+    };
+}
+
+#endif
@@ -1,21 +1,43 @@
 #ifndef J1T_JIT_ENGINE_HPP
 #define J1T_JIT_ENGINE_HPP
 
+#include <algorithm>
+#include <bit>
 #include <memory>
+#include <optional>
+#include <vector>
 
 #include <hal/interface/jit_backend.hpp>
+#include <hal/interface/linear_memory.hpp>
+#include <jit/code_cache.hpp>
 #include <print>
 #include <util/time.hpp>
 #include <vm/interpreter.hpp>
+#include <vm/optimizer.hpp>
 
 namespace j1t::jit
 {
     class engine;
 
+    // what the engines hand to the backend
+    enum class compile_tier : uint8_t
+    {
+        // the program as written
+        BASELINE,
+        // program::optimized(), worth its analysis for long-running code;
+        // programs it cannot optimize compile as BASELINE
+        OPTIMIZING,
+    };
+
     class engine
     {
       public:
-        engine(void) : backend(j1t::hal::make_native_jit_backend())
+        explicit engine(code_cache              &cache   = code_cache::shared(),
+                        j1t::hal::memory_sandbox sandbox = j1t::hal::memory_sandbox::GUARD_PAGES,
+                        compile_tier             tier    = compile_tier::BASELINE)
+            : backend(j1t::hal::make_native_jit_backend(j1t::hal::host_cpu_features(), sandbox))
+            , cache(&cache)
+            , tier(tier)
         {
         }
 
@@ -26,42 +48,161 @@ namespace j1t::jit
                 return std::unexpected(j1t::vm::interpreter::error::INVALID_OPCODE);
             }
 
+            // the interpreter fails only if a run reaches a missing local
+            if (!has_locals_for(program, state))
+            {
+                return baseline.run(program, state);
+            }
+
+            std::shared_ptr<const j1t::vm::optimized_program> optimized;
+            if (tier == compile_tier::OPTIMIZING)
+            {
+                optimized = program.optimized();
+                if (!optimized->is_optimized)
+                {
+                    optimized.reset();
+                }
+            }
+            const j1t::vm::program &target = optimized ? optimized->lowered : program;
+
             auto compiled = util::calculate_time(
-                [&]() -> std::unique_ptr<j1t::hal::compiled_code>
+                [&]() -> std::shared_ptr<j1t::hal::compiled_code>
                 {
                     std::print("JIT compiling...\n");
-                    return backend->compile(program);
+                    return cache->get_or_compile(target, *backend);
                 }
             );
-            // auto compiled = backend->compile(program);
             if (!compiled)
             {
                 return std::unexpected(j1t::vm::interpreter::error::INVALID_OPCODE);
             }
 
+            return util::calculate_time(
+                [&]() -> j1t::vm::interpreter::result<>
+                {
+                    std::print("JIT executing...\n");
+                    if (optimized)
+                    {
+                        return execute_optimized(*optimized, *compiled, compiled->entry(), state, 0u);
+                    }
+                    return execute(program, *compiled, compiled->entry(), state, 0u);
+                }
+            );
+        }
+
+        // Code compiled from a verified program does not check local indices,
+        // so execute() refuses states with fewer locals than it names; callers
+        // interpret those instead.
+        static auto has_locals_for(const j1t::vm::program &program, const j1t::vm::state &state) -> bool
+        {
+            const std::shared_ptr<const j1t::vm::verification> facts = program.verified();
+            return !facts->is_verified || state.locals.size() >= facts->locals_used;
+        }
+
+        // execute() for code compiled from optimized.lowered: extends
+        // state.locals by the temporaries for the run and then puts back
+        // whatever it held in their place
+        static auto execute_optimized(
+            const j1t::vm::optimized_program    &optimized,
+            j1t::hal::compiled_code             &compiled,
+            j1t::hal::compiled_code::entry_type entry,
+            j1t::vm::state                      &state,
+            std::size_t                         live_depth
+        ) -> j1t::vm::interpreter::result<>
+        {
+            if (state.locals.size() < optimized.first_temporary)
+            {
+                return std::unexpected(j1t::vm::interpreter::error::INVALID_LOCAL_INDEX);
+            }
+
+            const auto                  first_temporary = static_cast<std::ptrdiff_t>(optimized.first_temporary);
+            const std::vector<uint32_t> displaced(state.locals.begin() + first_temporary, state.locals.end());
+            state.locals.resize(optimized.locals_used);
+
+            auto result = execute(optimized.lowered, compiled, entry, state, live_depth);
+
+            state.locals.resize(optimized.first_temporary);
+            state.locals.insert(state.locals.end(), displaced.begin(), displaced.end());
+            return result;
+        }
+
+        // Runs entry, compiled->entry() or one of its entry_at() points, with
+        // the first live_depth words of state.stack as the operand stack.
+        // Prints nothing, so the tiered engine can switch over mid-run.
+        static auto execute(
+            const j1t::vm::program              &program,
+            j1t::hal::compiled_code             &compiled,
+            j1t::hal::compiled_code::entry_type entry,
+            j1t::vm::state                      &state,
+            std::size_t                         live_depth
+        ) -> j1t::vm::interpreter::result<>
+        {
+            // never run code that selected encodings this CPU lacks
+            if (!j1t::hal::host_cpu_features().includes(compiled.features()))
+            {
+                return std::unexpected(j1t::vm::interpreter::error::INVALID_OPCODE);
+            }
+
             static constexpr uintmax_t STACK_CAPACITY_WORDS = 4096;
 
-            if (state.stack.size() < STACK_CAPACITY_WORDS)
+            // verified code no longer bounds-checks pushes and local indices
+            // itself; give it the stack it needs and refuse too few locals
+            uintmax_t                                         stack_words = STACK_CAPACITY_WORDS;
+            const std::shared_ptr<const j1t::vm::verification> facts       = program.verified();
+            if (facts->is_verified)
+            {
+                if (state.locals.size() < facts->locals_used)
+                {
+                    return std::unexpected(j1t::vm::interpreter::error::INVALID_LOCAL_INDEX);
+                }
+                stack_words = std::max<uintmax_t>(stack_words, facts->max_stack_depth);
+            }
+
+            // room for the live stack on top
+            stack_words += live_depth;
+            if (state.stack.size() < stack_words)
             {
-                state.stack.resize(STACK_CAPACITY_WORDS);
+                state.stack.resize(stack_words);
             }
 
+            // compiled code does not bounds-check memory; run it on a copy
+            // that is safe for its sandbox, and copy back whatever happens
+            std::optional<j1t::hal::linear_memory> guarded;
+            std::vector<uint8_t>                   masked;
+
             j1t::hal::jit_context ctx {};
-            ctx.memory     = state.memory.empty() ? nullptr : state.memory.data();
+            if (compiled.sandbox() == j1t::hal::memory_sandbox::GUARD_PAGES)
+            {
+                guarded.emplace(state.memory);
+                ctx.memory = guarded->data();
+            }
+            else
+            {
+                // a LOAD_32 at the mask reads 3 bytes past it
+                const std::size_t span = std::bit_ceil(std::max<std::size_t>(state.memory.size(), 1u));
+                masked.resize(span + 3u);
+                std::copy(state.memory.begin(), state.memory.end(), masked.begin());
+                ctx.memory      = masked.data();
+                ctx.memory_mask = static_cast<uint32_t>(span - 1u);
+            }
             ctx.stack_base = state.stack.empty() ? nullptr : state.stack.data();
-            ctx.stack_top  = ctx.stack_base;
+            ctx.stack_top  = ctx.stack_base + static_cast<std::ptrdiff_t>(live_depth);
             ctx.stack_end  = ctx.stack_base + static_cast<std::ptrdiff_t>(state.stack.size());
             ctx.locals     = state.locals.empty() ? nullptr : state.locals.data();
             ctx.error_code = 0;
 
-            // uint32_t ret   = compiled->entry()(&ctx);
-            auto ret = util::calculate_time(
-                [&]() -> uint32_t
-                {
-                    std::print("JIT executing...\n");
-                    return compiled->entry()(&ctx);
-                }
-            );
+            uint32_t ret = 0;
+            if (!guarded)
+            {
+                ret = entry(&ctx);
+            }
+            else
+            {
+                const j1t::hal::memory_fault_scope scope(*guarded, compiled);
+                ret = entry(&ctx);
+            }
+            std::copy_n(ctx.memory, state.memory.size(), state.memory.begin());
+
             if (ctx.error_code != 0)
             {
                 switch (ctx.error_code)
@@ -70,7 +211,14 @@ namespace j1t::jit
                         return std::unexpected(j1t::vm::interpreter::error::STACK_UNDERFLOW);
 
                     case 2 :
-                        [[fallthrough]];
+                        return std::unexpected(j1t::vm::interpreter::error::STACK_OVERFLOW);
+
+                    case 3 :
+                        return std::unexpected(j1t::vm::interpreter::error::DIVISION_BY_ZERO);
+
+                    case 4 :
+                        return std::unexpected(j1t::vm::interpreter::error::MEMORY_OUT_OF_BOUNDS);
+
                     default :
                         return std::unexpected(j1t::vm::interpreter::error::INVALID_OPCODE);
                 }
@@ -97,6 +245,9 @@ namespace j1t::jit
 
       private:
         std::unique_ptr<j1t::hal::jit_backend> backend;
+        code_cache                            *cache { nullptr };
+        compile_tier                           tier { compile_tier::BASELINE };
+        j1t::vm::interpreter                   baseline { j1t::vm::interpreter::dispatch_mode::DECODED };
     };
 }
 
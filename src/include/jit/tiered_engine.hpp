@@ -0,0 +1,196 @@
+#ifndef J1T_JIT_TIERED_ENGINE_HPP
+#define J1T_JIT_TIERED_ENGINE_HPP
+
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <variant>
+#include <vector>
+
+#include <hal/interface/code_heap.hpp>
+#include <hal/interface/jit_backend.hpp>
+#include <jit/compile_queue.hpp>
+#include <jit/engine.hpp>
+#include <vm/interpreter.hpp>
+
+namespace j1t::jit
+{
+    class tiered_engine;
+
+    // Starts every run in the interpreter and counts taken backward jumps per
+    // loop header. Once a header reaches the threshold the program is
+    // compiled and execution moves into the compiled code at that header,
+    // carrying the live operand stack and locals over; short runs never pay
+    // for a compile.
+    //
+    // By default the compiled program is program::optimized(), entered at
+    // the pc its loop entries map the header to; a header it has no entry
+    // for finishes in the interpreter.
+    //
+    // In BACKGROUND mode the compile runs on a compile_queue worker while the
+    // interpreter keeps going; every further threshold iterations of the hot
+    // loop is a safe point at which the engine checks whether the code has
+    // been published and, if so, switches over.
+    class tiered_engine
+    {
+      public:
+        static constexpr uint32_t DEFAULT_HOT_LOOP_THRESHOLD = 1000;
+
+        enum class compile_mode : uint8_t
+        {
+            SYNCHRONOUS,
+            // falls back to SYNCHRONOUS when the code heap cannot be written
+            // while other threads run code from it
+            BACKGROUND,
+        };
+
+        explicit tiered_engine(uint32_t                 hot_loop_threshold = DEFAULT_HOT_LOOP_THRESHOLD,
+                               compile_mode             mode               = compile_mode::BACKGROUND,
+                               code_cache              &cache              = code_cache::shared(),
+                               j1t::hal::memory_sandbox sandbox            = j1t::hal::memory_sandbox::GUARD_PAGES,
+                               compile_tier             tier               = compile_tier::OPTIMIZING)
+            : backend(j1t::hal::make_native_jit_backend(j1t::hal::host_cpu_features(), sandbox))
+            , cache(&cache)
+            , threshold(hot_loop_threshold)
+            , mode(mode)
+            , tier(tier)
+        {
+        }
+
+        auto run(const j1t::vm::program &program, j1t::vm::state &state) -> j1t::vm::interpreter::result<>
+        {
+            using j1t::vm::interpreter;
+
+            std::vector<uint32_t>                   loop_counters(program.code.size() + 1u, 0u);
+            std::span<uint32_t>                     counting = loop_counters;
+            uint32_t                                start_pc = 0;
+            std::shared_ptr<compile_queue::ticket> submitted;
+            // what gets compiled, chosen at the first hot loop
+            std::shared_ptr<const j1t::vm::optimized_program> optimized;
+            const j1t::vm::program                           *target = nullptr;
+
+            // without a backend, or with too few locals for compiled code,
+            // the whole run stays in the interpreter
+            if ((!backend && !queue) || !engine::has_locals_for(program, state))
+            {
+                counting = {};
+            }
+
+            for (;;)
+            {
+                auto outcome = baseline.run_until_hot(program, state, start_pc, counting, threshold);
+                if (!outcome)
+                {
+                    return std::unexpected(outcome.error());
+                }
+
+                if (const interpreter::execution_info *info = std::get_if<interpreter::execution_info>(&outcome.value()))
+                {
+                    return *info;
+                }
+
+                const interpreter::hot_loop hot = std::get<interpreter::hot_loop>(outcome.value());
+
+                if (target == nullptr)
+                {
+                    if (tier == compile_tier::OPTIMIZING)
+                    {
+                        optimized = program.optimized();
+                        if (!optimized->is_optimized)
+                        {
+                            optimized.reset();
+                        }
+                    }
+                    target = optimized ? &optimized->lowered : &program;
+                }
+
+                std::shared_ptr<j1t::hal::compiled_code> owned;
+                j1t::hal::compiled_code                 *compiled = nullptr;
+
+                if (compile_queue *background = background_queue())
+                {
+                    if (!submitted)
+                    {
+                        submitted = background->submit(*target);
+                    }
+
+                    if (submitted->state() == compile_queue::ticket::status::PENDING)
+                    {
+                        // not published yet; interpret another threshold
+                        // iterations of this loop before looking again
+                        loop_counters[hot.pc] = 0;
+                        start_pc              = hot.pc;
+                        continue;
+                    }
+
+                    compiled = submitted->code();
+                }
+                else
+                {
+                    owned    = compile(*target);
+                    compiled = owned.get();
+                }
+
+                const std::optional<uint32_t>       entry_pc = optimized ? optimized->entry_pc(hot.pc) : hot.pc;
+                j1t::hal::compiled_code::entry_type entry    = compiled && entry_pc ? compiled->entry_at(*entry_pc) : nullptr;
+                if (entry != nullptr && optimized)
+                {
+                    return engine::execute_optimized(*optimized, *compiled, entry, state, state.stack.size());
+                }
+                if (entry != nullptr)
+                {
+                    return engine::execute(program, *compiled, entry, state, state.stack.size());
+                }
+
+                // no compiled code for this program; finish in the interpreter
+                start_pc = hot.pc;
+                counting = {};
+            }
+        }
+
+      private:
+        // created on the first hot loop so that constructing an engine does
+        // not map the shared code heap; takes over the backend
+        auto background_queue(void) -> compile_queue *
+        {
+            if (!queue && backend && mode == compile_mode::BACKGROUND)
+            {
+                if (j1t::hal::code_heap::shared().is_executable_while_writing())
+                {
+                    queue = std::make_unique<compile_queue>(std::move(backend), *cache);
+                }
+                else
+                {
+                    mode = compile_mode::SYNCHRONOUS;
+                }
+            }
+
+            return queue.get();
+        }
+
+        // the backends reject what they cannot compile by throwing
+        auto compile(const j1t::vm::program &program) -> std::shared_ptr<j1t::hal::compiled_code>
+        {
+            try
+            {
+                return cache->get_or_compile(program, *backend);
+            }
+            catch (const std::runtime_error &)
+            {
+                return nullptr;
+            }
+        }
+
+      private:
+        std::unique_ptr<j1t::hal::jit_backend> backend;
+        code_cache                            *cache { nullptr };
+        j1t::vm::interpreter                   baseline { j1t::vm::interpreter::dispatch_mode::DECODED };
+        uint32_t                               threshold { DEFAULT_HOT_LOOP_THRESHOLD };
+        compile_mode                           mode { compile_mode::BACKGROUND };
+        compile_tier                           tier { compile_tier::OPTIMIZING };
+        std::unique_ptr<compile_queue>         queue;
+    };
+}
+
+#endif
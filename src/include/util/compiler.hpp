@@ -0,0 +1,28 @@
+#ifndef J1T_UTIL_COMPILER_HPP
+#define J1T_UTIL_COMPILER_HPP
+
+// labels-as-values (`&&label`, `goto *pointer`) for threaded dispatch
+#if defined(__GNUC__) || defined(__clang__)
+#define J1T_HAS_COMPUTED_GOTO 1
+#else
+#define J1T_HAS_COMPUTED_GOTO 0
+#endif
+
+// guaranteed tail calls (`J1T_MUSTTAIL return f(...);`); without them a chain
+// of handler calls may grow the native stack by one frame per opcode
+#if defined(__has_cpp_attribute)
+#if __has_cpp_attribute(clang::musttail)
+#define J1T_HAS_MUSTTAIL 1
+#define J1T_MUSTTAIL [[clang::musttail]]
+#elif __has_cpp_attribute(gnu::musttail)
+#define J1T_HAS_MUSTTAIL 1
+#define J1T_MUSTTAIL [[gnu::musttail]]
+#endif
+#endif
+
+#ifndef J1T_HAS_MUSTTAIL
+#define J1T_HAS_MUSTTAIL 0
+#define J1T_MUSTTAIL
+#endif
+
+#endif
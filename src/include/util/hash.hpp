@@ -0,0 +1,51 @@
+#ifndef J1T_UTIL_HASH_HPP
+#define J1T_UTIL_HASH_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#include <span>
+
+namespace j1t::util
+{
+    // folds the 128-bit product of a and b into 64 bits
+    inline auto hash_mix(uint64_t a, uint64_t b) -> uint64_t
+    {
+        const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+
+        return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+    }
+
+    // Fast non-cryptographic 64-bit hash, eight bytes per multiply. Good
+    // enough to pick a bucket; callers that must not confuse two inputs still
+    // compare them.
+    inline auto hash_bytes(std::span<const uint8_t> bytes, uint64_t seed = 0u) -> uint64_t
+    {
+        static constexpr uint64_t K0 = 0x9E37'79B9'7F4A'7C15u;
+        static constexpr uint64_t K1 = 0xBF58'476D'1CE4'E5B9u;
+
+        uint64_t       h      = hash_mix(seed ^ K0, bytes.size() ^ K1);
+        const uint8_t *cursor = bytes.data();
+        std::size_t    left   = bytes.size();
+
+        while (left >= sizeof(uint64_t))
+        {
+            uint64_t word;
+            memcpy(&word, cursor, sizeof(word));
+
+            h       = hash_mix(word ^ K0, h ^ K1);
+            cursor += sizeof(word);
+            left   -= sizeof(word);
+        }
+
+        uint64_t tail = 0;
+        if (left != 0u)
+        {
+            memcpy(&tail, cursor, left);
+        }
+
+        return hash_mix(h ^ tail, K0);
+    }
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef J1T_UTIL_LAZY_CACHE_HPP
+#define J1T_UTIL_LAZY_CACHE_HPP
+
+#include <memory>
+#include <mutex>
+
+namespace j1t::util
+{
+    template<typename T>
+    class lazy_cache;
+
+    // value derived from its owner and computed on first use. Copies start
+    // empty, so a copied (and possibly modified) owner never sees a stale
+    // value; assigning to the owner resets it.
+    template<typename T>
+    class lazy_cache
+    {
+      public:
+        lazy_cache(void) = default;
+
+        lazy_cache(const lazy_cache &)
+        {
+        }
+
+        auto operator=(const lazy_cache &) -> lazy_cache &
+        {
+            reset();
+            return *this;
+        }
+
+        template<typename Factory>
+        auto get_or_create(Factory &&factory) const -> std::shared_ptr<const T>
+        {
+            std::lock_guard<std::mutex> lock(mutex_internal);
+            if (value_internal == nullptr)
+            {
+                value_internal = std::make_shared<const T>(factory());
+            }
+            return value_internal;
+        }
+
+        auto reset(void) -> void
+        {
+            std::lock_guard<std::mutex> lock(mutex_internal);
+            value_internal.reset();
+        }
+
+      private:
+        mutable std::mutex               mutex_internal;
+        mutable std::shared_ptr<const T> value_internal;
+    };
+}
+
+#endif
@@ -2,6 +2,7 @@
 #define J1T_UTIL_TIME_HPP
 
 #include <chrono>
+#include <format>
 #include <iostream>
 
 namespace j1t::util
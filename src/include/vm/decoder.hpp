@@ -0,0 +1,32 @@
+#ifndef J1T_VM_DECODER_HPP
+#define J1T_VM_DECODER_HPP
+
+#include <vector>
+
+#include <vm/instruction.hpp>
+
+namespace j1t::vm
+{
+    struct program;
+    struct decoded_program;
+
+    struct decoded_program
+    {
+        // one record per opcode in code order, terminated by OP_END_OF_CODE
+        // (or OP_TRUNCATED when the last immediate is cut off)
+        std::vector<instruction> instructions;
+
+        // false when a jump lands inside another instruction's immediate; the
+        // byte stream then has no single decoding and must be interpreted as is
+        bool is_linear { true };
+    };
+
+    auto decode(const program &target_program) -> decoded_program;
+
+    // pcs that some jump at the same or a later pc targets, ascending and
+    // without duplicates: the loop headers a tiered run can enter compiled
+    // code at
+    auto loop_headers(const decoded_program &decoded) -> std::vector<uint32_t>;
+}
+
+#endif
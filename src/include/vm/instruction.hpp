@@ -1,11 +1,35 @@
 #ifndef J1T_VM_INSTRUCTION_HPP
 #define J1T_VM_INSTRUCTION_HPP
 
+#include <stdint.h>
+
+#include <vm/opcodes.hpp>
+
 namespace j1t::vm
 {
+    // one fixed-width record of the decoded instruction stream
     struct instruction
     {
+        // operations that exist only in the decoded stream; raw values never
+        // produced by the decoder for a valid bytecode opcode
+        static constexpr uint8_t OP_END_OF_CODE { 0xF0 }; // fell off the end of program::code
+        static constexpr uint8_t OP_TRUNCATED { 0xF1 };   // immediate runs past the end
+        static constexpr uint8_t OP_INVALID { 0xF2 };     // unknown opcode byte
+
+        // jump target outside [0, code.size()]
+        static constexpr uint32_t INVALID_TARGET { 0xFFFF'FFFFu };
+
+        // op_to_raw(opcode) or one of the OP_* values above
+        uint8_t  op { op_to_raw(opcode::NOP) };
+        // PUSH value, LOCAL_* index or jump offset, already widened
+        uint32_t immediate { 0 };
+        // jumps: index of the target record
+        uint32_t target { 0 };
+        // byte offset of the opcode in program::code
+        uint32_t pc { 0 };
     };
+
+    static_assert(sizeof(instruction) == 16);
 }
 
 #endif
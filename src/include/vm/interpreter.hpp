@@ -5,13 +5,20 @@
 #include <optional>
 #include <span>
 #include <stdint.h>
+#include <variant>
 #include <vector>
 
+#include <util/lazy_cache.hpp>
+#include <vm/decoder.hpp>
 #include <vm/opcodes.hpp>
+#include <vm/translator.hpp>
+#include <vm/verifier.hpp>
 
 namespace j1t::vm
 {
     class interpreter;
+    class ngram_profiler;
+    struct optimized_program;
     struct program;
     struct state;
 
@@ -27,6 +34,7 @@ namespace j1t::vm
             DIVISION_BY_ZERO,
             MEMORY_OUT_OF_BOUNDS,
             NON_TERMINATED_PROGRAM,
+            STACK_OVERFLOW,
         };
 
         static constexpr const char *error_to_string(error err)
@@ -54,6 +62,9 @@ namespace j1t::vm
                 case error::NON_TERMINATED_PROGRAM :
                     return "Non-terminated program";
 
+                case error::STACK_OVERFLOW :
+                    return "Stack overflow";
+
                 default :
                     return "Unknown error";
             }
@@ -68,10 +79,92 @@ namespace j1t::vm
         template<typename T = execution_info>
         using result = std::expected<T, error>;
 
+        // where run_until_hot() stopped: the loop header whose counter reached
+        // the threshold, not yet executed
+        struct hot_loop
+        {
+            uint32_t pc;
+        };
+
+        enum class dispatch_mode
+        {
+            // portable while + switch loop
+            SWITCH,
+            // labels-as-values table, one indirect jump per handler; same as
+            // SWITCH on compilers without computed goto
+            THREADED,
+            // runs over program::decoded() records instead of re-parsing the
+            // bytes; falls back to THREADED for non-linear programs
+            DECODED,
+            // runs program::translated(), three-address code over a register
+            // file instead of the operand stack; falls back to DECODED when
+            // the program has no translation, the initial stack is not empty
+            // or state::locals is too small
+            REGISTER,
+            // one function per handler over program::decoded(), chained by
+            // guaranteed tail calls with the interpreter state in argument
+            // registers; falls back to DECODED for unverified programs, a
+            // non-empty initial stack, too few state::locals or compilers
+            // without musttail
+            TAIL_CALL,
+            // THREADED with the top of the operand stack held in a local and
+            // the rest in a fixed array of MAX_STACK_SIZE slots; deeper
+            // stacks fail with STACK_OVERFLOW
+            STACK_CACHED,
+        };
+
       public:
+        interpreter(void) = default;
+        explicit interpreter(dispatch_mode mode);
+
         auto run(const program &target_program, state &initial_state) -> result<>;
 
+        auto mode(void) const -> dispatch_mode;
+
+        // while a profiler is attached every run uses the SWITCH loop, which
+        // reports each opcode to it; pass nullptr to detach
+        auto set_profiler(ngram_profiler *profiler) -> void;
+
+        // Runs like DECODED from start_pc (0, or a pc an earlier call stopped
+        // at) and counts taken backward jumps in loop_counters, indexed by the
+        // target pc (code.size() + 1 entries). Once a count reaches threshold
+        // the run stops in front of that loop header and returns it, with
+        // state holding the live stack and locals there. An empty
+        // loop_counters runs to the end without counting.
+        auto run_until_hot(
+            const program      &target_program,
+            state              &initial_state,
+            uint32_t            start_pc,
+            std::span<uint32_t> loop_counters,
+            uint32_t            threshold
+        ) -> result<std::variant<execution_info, hot_loop>>;
+
       private:
+        auto run_switch(const program &target_program, state &initial_state) -> result<>;
+        auto run_threaded(const program &target_program, state &initial_state) -> result<>;
+        auto run_decoded(const program &target_program, state &initial_state) -> result<>;
+        struct hot_loop_watch
+        {
+            std::span<uint32_t>     counters;
+            uint32_t                threshold { 0 };
+            std::optional<uint32_t> hot_pc {};
+        };
+
+        template<bool IS_VERIFIED, bool IS_COUNTING = false>
+        auto run_decoded_records(
+            const decoded_program &decoded,
+            state                 &initial_state,
+            uint32_t               start_index = 0,
+            hot_loop_watch        *watch       = nullptr
+        ) -> result<>;
+        auto run_register(const program &target_program, state &initial_state) -> result<>;
+        auto run_tail_call(const program &target_program, state &initial_state) -> result<>;
+        auto run_stack_cached(const program &target_program, state &initial_state) -> result<>;
+
+      private:
+        dispatch_mode   mode_internal { dispatch_mode::SWITCH };
+        ngram_profiler *profiler_internal { nullptr };
+
         inline static constexpr uint32_t MAX_STACK_SIZE  = 1024;
         inline static constexpr uint32_t MAX_MEMORY_SIZE = 65536;
     };
@@ -79,6 +172,25 @@ namespace j1t::vm
     struct program
     {
         std::vector<uint8_t> code;
+
+        // decode(*this) with superinstructions fused, computed on first use and
+        // shared by later runs
+        auto decoded(void) const -> std::shared_ptr<const decoded_program>;
+
+        // translate(*this), computed on first use and shared by later runs
+        auto translated(void) const -> std::shared_ptr<const register_program>;
+
+        // verify(decode(*this)), computed on first use and shared by later runs
+        auto verified(void) const -> std::shared_ptr<const verification>;
+
+        // optimize(*this), computed on first use and shared by later runs;
+        // declared in vm/optimizer.hpp
+        auto optimized(void) const -> std::shared_ptr<const optimized_program>;
+
+        util::lazy_cache<decoded_program>   decoded_cache {};
+        util::lazy_cache<register_program>  translated_cache {};
+        util::lazy_cache<verification>      verified_cache {};
+        util::lazy_cache<optimized_program> optimized_cache {};
     };
 
     struct state
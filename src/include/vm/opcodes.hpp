@@ -55,6 +55,86 @@ namespace j1t::vm
     {
         return std::to_underlying(op);
     }
+
+    inline constexpr auto is_valid_opcode(uint8_t raw) -> bool
+    {
+        return raw <= op_to_raw(opcode::READ_8_UNSIGNED);
+    }
+
+    // size of the little-endian u32/i32 operand that follows the opcode byte
+    inline constexpr auto immediate_size(opcode op) -> uint32_t
+    {
+        switch (op)
+        {
+            case opcode::PUSH :
+            case opcode::LOCAL_GET :
+            case opcode::LOCAL_SET :
+            case opcode::JUMP :
+            case opcode::JUMP_IF_ZERO :
+            case opcode::JUMP_IF_NOT_ZERO :
+                return 4;
+
+            default :
+                return 0;
+        }
+    }
+
+    inline constexpr auto is_jump(opcode op) -> bool
+    {
+        return op == opcode::JUMP || op == opcode::JUMP_IF_ZERO || op == opcode::JUMP_IF_NOT_ZERO;
+    }
+
+    inline constexpr auto op_to_string(opcode op) -> const char *
+    {
+        switch (op)
+        {
+            case opcode::NOP :
+                return "NOP";
+            case opcode::PUSH :
+                return "PUSH";
+            case opcode::POP :
+                return "POP";
+            case opcode::LOCAL_GET :
+                return "LOCAL_GET";
+            case opcode::LOCAL_SET :
+                return "LOCAL_SET";
+            case opcode::ADD :
+                return "ADD";
+            case opcode::SUB :
+                return "SUB";
+            case opcode::MUL :
+                return "MUL";
+            case opcode::DIV :
+                return "DIV";
+            case opcode::EQ :
+                return "EQ";
+            case opcode::LESS_THAN_SIGNED :
+                return "LESS_THAN_SIGNED";
+            case opcode::LESS_THAN_UNSIGNED :
+                return "LESS_THAN_UNSIGNED";
+            case opcode::LOAD_8_UNSIGNED :
+                return "LOAD_8_UNSIGNED";
+            case opcode::LOAD_16_UNSIGNED :
+                return "LOAD_16_UNSIGNED";
+            case opcode::LOAD_32 :
+                return "LOAD_32";
+            case opcode::STORE_8 :
+                return "STORE_8";
+            case opcode::JUMP :
+                return "JUMP";
+            case opcode::JUMP_IF_ZERO :
+                return "JUMP_IF_ZERO";
+            case opcode::JUMP_IF_NOT_ZERO :
+                return "JUMP_IF_NOT_ZERO";
+            case opcode::RET :
+                return "RET";
+            case opcode::PRINT :
+                return "PRINT";
+            case opcode::READ_8_UNSIGNED :
+                return "READ_8_UNSIGNED";
+        }
+        return "UNKNOWN";
+    }
 }
 
 #endif
@@ -0,0 +1,66 @@
+#ifndef J1T_VM_OPTIMIZER_HPP
+#define J1T_VM_OPTIMIZER_HPP
+
+#include <optional>
+#include <stdint.h>
+#include <vector>
+
+#include <vm/interpreter.hpp>
+
+namespace j1t::vm
+{
+    struct optimized_program;
+
+    // A verified program rewritten by optimize(). Run from pc 0 on the same
+    // state, lowered prints, stores, returns and fails like the original and
+    // leaves the same locals and memory behind; the operand stack has the same
+    // layout at every block boundary, so a run of the original stopped at one
+    // of its loop headers can continue in lowered at the matching pc.
+    struct optimized_program
+    {
+        struct loop_entry
+        {
+            uint32_t original_pc;
+            uint32_t pc;
+        };
+
+        program lowered {};
+
+        // lowered keeps values it reuses in the locals [first_temporary,
+        // locals_used), past every local the original touches; they hold
+        // nothing on entry
+        uint32_t first_temporary { 0 };
+        uint32_t locals_used { 0 };
+
+        // reachable loop headers of the original, ascending; pc may be a stub
+        // that computes the invariants of the loops around the header first
+        std::vector<loop_entry> loop_entries;
+
+        // false when the program fails verify() or is too large to analyse
+        // (too many locals or phis); lowered is then empty
+        bool is_optimized { false };
+
+        // where lowered continues a run stopped at the original's loop header
+        auto entry_pc(uint32_t original_pc) const -> std::optional<uint32_t>;
+    };
+
+    // Lifts the program into SSA form over its basic blocks (one value per
+    // local, stack slot and memory state at each block entry, merged by phis
+    // that are dropped again when all their inputs agree), then
+    //
+    //   - folds constants and the branches they decide, and forwards values
+    //     through LOCAL_SET / LOCAL_GET,
+    //   - numbers values globally: a computation already available in a
+    //     dominating block, or in a local, is not repeated,
+    //   - computes what a natural loop would compute the same on every
+    //     iteration once in a preheader in front of it, when that cannot trap,
+    //   - drops the code whose results nothing needs anymore,
+    //
+    // and lowers the result back to bytecode, so every interpreter and
+    // backend runs it unchanged. Trapping operations stay in place unless an
+    // earlier identical one has already succeeded, and every LOCAL_SET that
+    // changes a local stays, so errors leave the same state behind.
+    auto optimize(const program &target_program) -> optimized_program;
+}
+
+#endif
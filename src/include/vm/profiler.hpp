@@ -0,0 +1,45 @@
+#ifndef J1T_VM_PROFILER_HPP
+#define J1T_VM_PROFILER_HPP
+
+#include <array>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+namespace j1t::vm
+{
+    class ngram_profiler;
+
+    // Counts how often each straight-line sequence of 2..MAX_LENGTH opcodes
+    // executes; the input for choosing SUPERINSTRUCTIONS. A sequence is cut at
+    // every taken jump, since a fused handler can only cover fall-through code.
+    class ngram_profiler
+    {
+      public:
+        static constexpr uint32_t MAX_LENGTH { 4 };
+
+        struct ngram
+        {
+            uint32_t                        length;
+            std::array<uint8_t, MAX_LENGTH> ops;
+            uint64_t                        count;
+        };
+
+      public:
+        // called once per executed opcode, before it runs
+        auto record(uint32_t opcode_pc, uint8_t raw_opcode) -> void;
+
+        // most frequent first
+        auto top(std::size_t count) const -> std::vector<ngram>;
+
+        auto reset(void) -> void;
+
+      private:
+        std::unordered_map<uint64_t, uint64_t> counts_internal;
+        std::array<uint8_t, MAX_LENGTH>        window_internal {};
+        uint32_t                               window_length_internal { 0 };
+        uint32_t                               next_pc_internal { 0 };
+    };
+}
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef J1T_VM_SUPERINSTRUCTIONS_HPP
+#define J1T_VM_SUPERINSTRUCTIONS_HPP
+
+#include <array>
+#include <stdint.h>
+
+#include <vm/decoder.hpp>
+#include <vm/opcodes.hpp>
+
+namespace j1t::vm
+{
+    // Fused operations of the decoded stream. A superinstruction replaces only
+    // the op of the first record it covers: the covered records stay in place,
+    // so jumps into the middle of a fused sequence still work, and the fused
+    // handler reads their immediates and skips past them. Handlers raise the
+    // same errors in the same order as the unfused sequence.
+    enum : uint8_t
+    {
+        OP_LOCAL_GET_LOCAL_GET = 0xC0,
+        OP_LOCAL_LOCAL_MUL,
+        OP_LOCAL_LOCAL_EQ_JUMP_IF_NOT_ZERO,
+        OP_LOCAL_LOCAL_LESS_THAN_SIGNED_JUMP_IF_NOT_ZERO,
+        OP_LOCAL_PUSH_EQ_JUMP_IF_NOT_ZERO,
+        OP_LOCAL_PUSH_ADD_LOCAL_SET,
+        OP_LOCAL_ADD_LOCAL_SET,
+        OP_LOCAL_GET_LOCAL_SET,
+        OP_LOCAL_ADD,
+        OP_ADD_LOCAL_SET,
+        OP_PUSH_LOCAL_SET,
+        OP_PUSH_MUL,
+        OP_PUSH_DIV,
+    };
+
+    struct superinstruction
+    {
+        static constexpr uint32_t MAX_LENGTH { 4 };
+
+        uint8_t                        op;
+        uint32_t                       length;
+        std::array<opcode, MAX_LENGTH> pattern;
+        const char                    *name;
+    };
+
+    // matched longest first. Picked from the n-gram profile of mandelbrot
+    // (see ngram_profiler); extend it from profiles of other workloads.
+    inline constexpr superinstruction SUPERINSTRUCTIONS[] = {
+        {
+            OP_LOCAL_LOCAL_EQ_JUMP_IF_NOT_ZERO,
+            4,
+            { opcode::LOCAL_GET, opcode::LOCAL_GET, opcode::EQ, opcode::JUMP_IF_NOT_ZERO },
+            "LOCAL_LOCAL_EQ_JUMP_IF_NOT_ZERO",
+        },
+        {
+            OP_LOCAL_LOCAL_LESS_THAN_SIGNED_JUMP_IF_NOT_ZERO,
+            4,
+            { opcode::LOCAL_GET, opcode::LOCAL_GET, opcode::LESS_THAN_SIGNED, opcode::JUMP_IF_NOT_ZERO },
+            "LOCAL_LOCAL_LESS_THAN_SIGNED_JUMP_IF_NOT_ZERO",
+        },
+        {
+            OP_LOCAL_PUSH_EQ_JUMP_IF_NOT_ZERO,
+            4,
+            { opcode::LOCAL_GET, opcode::PUSH, opcode::EQ, opcode::JUMP_IF_NOT_ZERO },
+            "LOCAL_PUSH_EQ_JUMP_IF_NOT_ZERO",
+        },
+        {
+            OP_LOCAL_PUSH_ADD_LOCAL_SET,
+            4,
+            { opcode::LOCAL_GET, opcode::PUSH, opcode::ADD, opcode::LOCAL_SET },
+            "LOCAL_PUSH_ADD_LOCAL_SET",
+        },
+        {
+            OP_LOCAL_LOCAL_MUL,
+            3,
+            { opcode::LOCAL_GET, opcode::LOCAL_GET, opcode::MUL },
+            "LOCAL_LOCAL_MUL",
+        },
+        {
+            OP_LOCAL_ADD_LOCAL_SET,
+            3,
+            { opcode::LOCAL_GET, opcode::ADD, opcode::LOCAL_SET },
+            "LOCAL_ADD_LOCAL_SET",
+        },
+        {
+            OP_LOCAL_GET_LOCAL_GET,
+            2,
+            { opcode::LOCAL_GET, opcode::LOCAL_GET },
+            "LOCAL_GET_LOCAL_GET",
+        },
+        {
+            OP_LOCAL_GET_LOCAL_SET,
+            2,
+            { opcode::LOCAL_GET, opcode::LOCAL_SET },
+            "LOCAL_GET_LOCAL_SET",
+        },
+        {
+            OP_LOCAL_ADD,
+            2,
+            { opcode::LOCAL_GET, opcode::ADD },
+            "LOCAL_ADD",
+        },
+        {
+            OP_ADD_LOCAL_SET,
+            2,
+            { opcode::ADD, opcode::LOCAL_SET },
+            "ADD_LOCAL_SET",
+        },
+        {
+            OP_PUSH_LOCAL_SET,
+            2,
+            { opcode::PUSH, opcode::LOCAL_SET },
+            "PUSH_LOCAL_SET",
+        },
+        {
+            OP_PUSH_MUL,
+            2,
+            { opcode::PUSH, opcode::MUL },
+            "PUSH_MUL",
+        },
+        {
+            OP_PUSH_DIV,
+            2,
+            { opcode::PUSH, opcode::DIV },
+            "PUSH_DIV",
+        },
+    };
+
+    // peephole pass over a decoded stream; returns the number of fused records
+    auto fuse_superinstructions(decoded_program &decoded) -> uint32_t;
+}
+
+#endif
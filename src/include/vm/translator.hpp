@@ -0,0 +1,86 @@
+#ifndef J1T_VM_TRANSLATOR_HPP
+#define J1T_VM_TRANSLATOR_HPP
+
+#include <stdint.h>
+#include <vector>
+
+namespace j1t::vm
+{
+    struct program;
+    struct register_instruction;
+    struct register_program;
+
+    // three-address operations over the register file of a register_program
+    enum class register_op : uint8_t
+    {
+        MOVE,
+        ADD,
+        SUB,
+        MUL,
+        DIV,
+        EQ,
+        LESS_THAN_SIGNED,
+        LESS_THAN_UNSIGNED,
+        LOAD_8_UNSIGNED,
+        LOAD_16_UNSIGNED,
+        LOAD_32,
+        // memory[a] = b
+        STORE_8,
+        JUMP,
+        JUMP_IF_ZERO,
+        JUMP_IF_NOT_ZERO,
+        // a compare followed by JUMP_IF_ZERO / JUMP_IF_NOT_ZERO
+        JUMP_IF_EQ,
+        JUMP_IF_NOT_EQ,
+        JUMP_IF_LESS_THAN_SIGNED,
+        JUMP_IF_GREATER_EQUAL_SIGNED,
+        JUMP_IF_LESS_THAN_UNSIGNED,
+        JUMP_IF_GREATER_EQUAL_UNSIGNED,
+        RET,
+        PRINT,
+        READ_8_UNSIGNED,
+        // raises interpreter::error(a)
+        FAIL,
+    };
+
+    struct register_instruction
+    {
+        register_op op { register_op::MOVE };
+        // register indices; FAIL keeps the error in a
+        uint32_t    destination { 0 };
+        uint32_t    a { 0 };
+        uint32_t    b { 0 };
+        // jumps: index of the target instruction, RET: pc reported on return
+        // (b then holds the number of stack slots left below the result)
+        uint32_t    target { 0 };
+    };
+
+    static_assert(sizeof(register_instruction) == 20);
+
+    // The register file is laid out as
+    //
+    //   [0, locals_used)                   state::locals
+    //   [locals_used, + temporaries)       one register per operand stack slot
+    //   [+ temporaries, registers.size())  PUSH immediates
+    //
+    // so every operand is a plain register index.
+    struct register_program
+    {
+        std::vector<register_instruction> instructions;
+
+        // initial register file: zeroed locals and temporaries, then constants
+        std::vector<uint32_t> registers;
+
+        uint32_t locals_used { 0 };
+        uint32_t temporaries { 0 };
+
+        // false when the program fails verify() or uses too many locals; it
+        // must then be interpreted on its operand stack. Assumes an empty
+        // initial stack.
+        bool is_translated { false };
+    };
+
+    auto translate(const program &target_program) -> register_program;
+}
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef J1T_VM_VERIFIER_HPP
+#define J1T_VM_VERIFIER_HPP
+
+#include <stdint.h>
+#include <vector>
+
+#include <vm/decoder.hpp>
+
+namespace j1t::vm
+{
+    struct verification;
+    struct stack_effect;
+
+    // Static facts about a program started on an empty operand stack. When
+    // is_verified holds, every reachable instruction
+    //
+    //   - is a valid opcode with its full immediate,
+    //   - jumps only to opcode boundaries (or the end of the code),
+    //   - finds at least as many stack slots as it pops, and the stack depth
+    //     is the same on every path that reaches it,
+    //
+    // so the engines only need to check, once per run, that state::locals
+    // has locals_used entries and the stack has room for max_stack_depth.
+    struct verification
+    {
+        static constexpr uint32_t UNREACHABLE { 0xFFFF'FFFFu };
+
+        // stack depth before each record of the verified decoded_program,
+        // UNREACHABLE for dead code
+        std::vector<uint32_t> depths;
+
+        uint32_t max_stack_depth { 0 };
+        // one past the highest local index used by reachable code
+        uint32_t locals_used { 0 };
+
+        bool is_verified { false };
+    };
+
+    struct stack_effect
+    {
+        uint32_t pops;
+        uint32_t pushes;
+    };
+
+    // slots op pops (checked before it runs) and then pushes; jumps and
+    // NOP move nothing
+    auto stack_effect_of(opcode op) -> stack_effect;
+
+    // expects decode() output, not program::decoded() with fused records
+    auto verify(const decoded_program &decoded) -> verification;
+}
+
+#endif
@@ -1,11 +1,16 @@
 #include <vm/assembler.hpp>
 #include <vm/interpreter.hpp>
 #include <vm/opcodes.hpp>
+#include <vm/profiler.hpp>
 
 #include <jit/engine.hpp>
+#include <jit/tiered_engine.hpp>
 
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
@@ -320,6 +325,7 @@ namespace
 }
 
 #include <chrono>
+#include <format>
 #include <iostream>
 
 inline constexpr auto calculate_time(auto function) -> decltype(auto)
@@ -337,7 +343,38 @@ inline constexpr auto calculate_time(auto function) -> decltype(auto)
     return result;
 }
 
-int main(void)
+// counts executed opcode sequences on the switch loop; the top entries are the
+// candidates for vm::SUPERINSTRUCTIONS
+auto print_profile(const j1t::vm::program &program) -> int
+{
+    j1t::vm::state state {};
+    state.locals.resize(512, 0);
+
+    j1t::vm::ngram_profiler profiler {};
+    j1t::vm::interpreter    interpreter {};
+    interpreter.set_profiler(&profiler);
+
+    std::printf("Profiling interpreter...\n");
+    auto result = interpreter.run(program, state);
+    if (!result)
+    {
+        std::printf("interpreter error: %s\n", j1t::vm::interpreter::error_to_string(result.error()));
+        return 1;
+    }
+
+    for (const j1t::vm::ngram_profiler::ngram &entry : profiler.top(24))
+    {
+        std::printf("\n%12llu ", static_cast<unsigned long long>(entry.count));
+        for (uint32_t i = 0; i < entry.length; ++i)
+        {
+            std::printf(" %s", j1t::vm::op_to_string(static_cast<j1t::vm::opcode>(entry.ops[i])));
+        }
+    }
+    std::printf("\n");
+    return 0;
+}
+
+int main(int argc, char **argv)
 {
     try
     {
@@ -347,6 +384,17 @@ int main(void)
 
         j1t::vm::program program = build_mandelbrot_program(width, height, max_iter);
 
+        if (argc > 1 && std::strcmp(argv[1], "--profile") == 0)
+        {
+            return print_profile(program);
+        }
+
+        // persist compiled code across runs
+        if (const char *cache_directory = std::getenv("J1T_CODE_CACHE_DIR"))
+        {
+            j1t::jit::code_cache::shared().set_disk_cache(std::make_shared<j1t::jit::disk_code_cache>(cache_directory));
+        }
+
         j1t::vm::state state {};
         state.locals.resize(512, 0);
         state.stack.clear();
@@ -367,6 +415,46 @@ int main(void)
             return 1;
         }
 
+        // the other dispatch modes must agree with the switch loop
+        struct dispatch_variant
+        {
+            const char                          *name;
+            j1t::vm::interpreter::dispatch_mode mode;
+        };
+
+        static constexpr dispatch_variant variants[] = {
+            { "threaded", j1t::vm::interpreter::dispatch_mode::THREADED },
+            { "decoded", j1t::vm::interpreter::dispatch_mode::DECODED },
+            { "register", j1t::vm::interpreter::dispatch_mode::REGISTER },
+            { "tail-call", j1t::vm::interpreter::dispatch_mode::TAIL_CALL },
+            { "stack-cached", j1t::vm::interpreter::dispatch_mode::STACK_CACHED },
+        };
+
+        for (const dispatch_variant &variant : variants)
+        {
+            std::printf("\nRunning %s interpreter...\n", variant.name);
+            j1t::vm::state v_state {};
+            v_state.locals.resize(512, 0);
+
+            j1t::vm::interpreter variant_interpreter { variant.mode };
+            auto                 variant_result = calculate_time(
+                [&]()
+                {
+                    return variant_interpreter.run(program, v_state);
+                }
+            );
+            if (!variant_result)
+            {
+                std::printf("%s interpreter error: %s\n", variant.name, j1t::vm::interpreter::error_to_string(variant_result.error()));
+                return 1;
+            }
+            if (variant_result->return_value != result->return_value)
+            {
+                std::printf("%s interpreter returned %u, expected %u\n", variant.name, variant_result->return_value, result->return_value);
+                return 1;
+            }
+        }
+
         std::printf("\nRunning JIT...\n");
         j1t::vm::state j_state {};
         j_state.locals.resize(512, 0);
@@ -387,6 +475,50 @@ int main(void)
             return 1;
         }
 
+        std::printf("\nRunning optimizing JIT...\n");
+        j1t::vm::state o_state {};
+        o_state.locals.resize(512, 0);
+
+        j1t::jit::engine optimizing_engine { j1t::jit::code_cache::shared(), j1t::hal::memory_sandbox::GUARD_PAGES, j1t::jit::compile_tier::OPTIMIZING };
+        auto             optimizing_result = calculate_time(
+            [&]()
+            {
+                return optimizing_engine.run(program, o_state);
+            }
+        );
+        if (!optimizing_result)
+        {
+            std::printf("optimizing JIT error: %s\n", j1t::vm::interpreter::error_to_string(optimizing_result.error()));
+            return 1;
+        }
+        if (optimizing_result->return_value != result->return_value)
+        {
+            std::printf("optimizing JIT returned %u, expected %u\n", optimizing_result->return_value, result->return_value);
+            return 1;
+        }
+
+        std::printf("\nRunning tiered...\n");
+        j1t::vm::state t_state {};
+        t_state.locals.resize(512, 0);
+
+        j1t::jit::tiered_engine tiered_engine {};
+        auto                    tiered_result = calculate_time(
+            [&]()
+            {
+                return tiered_engine.run(program, t_state);
+            }
+        );
+        if (!tiered_result)
+        {
+            std::printf("tiered error: %s\n", j1t::vm::interpreter::error_to_string(tiered_result.error()));
+            return 1;
+        }
+        if (tiered_result->return_value != result->return_value)
+        {
+            std::printf("tiered returned %u, expected %u\n", tiered_result->return_value, result->return_value);
+            return 1;
+        }
+
         std::printf("\nret=%u\n", result->return_value);
         return 0;
     }
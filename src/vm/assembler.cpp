@@ -1,6 +1,9 @@
 #include <vm/assembler.hpp>
 #include <vm/emitter.hpp>
 
+#include <cstdio>
+#include <cstdlib>
+
 namespace j1t::vm
 {
     auto assembler::create_label(void) -> label
@@ -191,7 +194,8 @@ namespace j1t::vm
     auto assembler::to_program(void) -> const program &
     {
         static program prog;
-        prog.code = std::move(code);
+        // assign a fresh program so cached decode results are dropped too
+        prog = program { std::move(code) };
         return prog;
     }
 }
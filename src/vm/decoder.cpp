@@ -0,0 +1,138 @@
+#include <vm/decoder.hpp>
+#include <vm/interpreter.hpp>
+#include <vm/superinstructions.hpp>
+
+#include <algorithm>
+
+namespace
+{
+    constexpr uint32_t NO_RECORD { 0xFFFF'FFFFu };
+}
+
+namespace j1t::vm
+{
+    auto decode(const program &target_program) -> decoded_program
+    {
+        const std::vector<uint8_t> &code      = target_program.code;
+        const uint32_t              code_size = static_cast<uint32_t>(code.size());
+
+        decoded_program decoded {};
+        decoded.instructions.reserve(code_size / 2u + 1u);
+
+        // byte offset -> record index, for resolving jump targets
+        std::vector<uint32_t> record_at(code_size + 1u, NO_RECORD);
+
+        uint32_t pc = 0;
+        while (pc < code_size)
+        {
+            instruction record {};
+            record.pc     = pc;
+            record_at[pc] = static_cast<uint32_t>(decoded.instructions.size());
+
+            const uint8_t raw        = code[pc];
+            const bool    is_invalid = !is_valid_opcode(raw);
+            pc += 1u;
+
+            if (is_invalid)
+            {
+                record.op = instruction::OP_INVALID;
+            }
+            else if (immediate_size(static_cast<opcode>(raw)) != 0u)
+            {
+                if (code_size - pc < 4u)
+                {
+                    // execution stops here either way; the cut-off bytes are
+                    // left without records
+                    record.op = instruction::OP_TRUNCATED;
+                    decoded.instructions.push_back(record);
+                    break;
+                }
+
+                record.op        = raw;
+                record.immediate = static_cast<uint32_t>(code[pc]) | (static_cast<uint32_t>(code[pc + 1]) << 8)
+                                 | (static_cast<uint32_t>(code[pc + 2]) << 16)
+                                 | (static_cast<uint32_t>(code[pc + 3]) << 24);
+                pc += 4u;
+            }
+            else
+            {
+                record.op = raw;
+            }
+
+            decoded.instructions.push_back(record);
+        }
+
+        if (pc >= code_size)
+        {
+            instruction end_record {};
+            end_record.op        = instruction::OP_END_OF_CODE;
+            end_record.pc        = code_size;
+            record_at[code_size] = static_cast<uint32_t>(decoded.instructions.size());
+            decoded.instructions.push_back(end_record);
+        }
+
+        for (instruction &record : decoded.instructions)
+        {
+            if (!is_valid_opcode(record.op) || !is_jump(static_cast<opcode>(record.op)))
+            {
+                continue;
+            }
+
+            const int64_t target_pc
+                = static_cast<int64_t>(record.pc) + static_cast<int64_t>(static_cast<int32_t>(record.immediate));
+
+            if (target_pc < 0 || target_pc > static_cast<int64_t>(code_size))
+            {
+                record.target = instruction::INVALID_TARGET;
+                continue;
+            }
+
+            record.target = record_at[static_cast<uint32_t>(target_pc)];
+            if (record.target == NO_RECORD)
+            {
+                decoded.is_linear = false;
+            }
+        }
+
+        return decoded;
+    }
+
+    auto loop_headers(const decoded_program &decoded) -> std::vector<uint32_t>
+    {
+        std::vector<uint32_t> headers;
+
+        for (const instruction &record : decoded.instructions)
+        {
+            // fusion only rewrites the first record of a sequence and no
+            // sequence starts with a jump, so every jump keeps its op
+            if (!is_valid_opcode(record.op) || !is_jump(static_cast<opcode>(record.op))
+                || record.target >= decoded.instructions.size())
+            {
+                continue;
+            }
+
+            const uint32_t target_pc = decoded.instructions[record.target].pc;
+            if (target_pc <= record.pc)
+            {
+                headers.push_back(target_pc);
+            }
+        }
+
+        std::sort(headers.begin(), headers.end());
+        headers.erase(std::unique(headers.begin(), headers.end()), headers.end());
+
+        return headers;
+    }
+
+    auto program::decoded(void) const -> std::shared_ptr<const decoded_program>
+    {
+        return decoded_cache.get_or_create(
+            [this]()
+            {
+                decoded_program decoded = decode(*this);
+                fuse_superinstructions(decoded);
+                return decoded;
+            }
+        );
+    }
+}
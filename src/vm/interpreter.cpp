@@ -1,8 +1,57 @@
 #include <vm/interpreter.hpp>
+#include <vm/profiler.hpp>
+
+#include <cstdio>
 
 namespace j1t::vm
 {
+    interpreter::interpreter(dispatch_mode mode)
+        : mode_internal(mode)
+    {
+    }
+
+    auto interpreter::mode(void) const -> dispatch_mode
+    {
+        return mode_internal;
+    }
+
+    auto interpreter::set_profiler(ngram_profiler *profiler) -> void
+    {
+        profiler_internal = profiler;
+    }
+
     auto interpreter::run(const program &target_program, state &initial_state) -> result<>
+    {
+        if (profiler_internal != nullptr)
+        {
+            return run_switch(target_program, initial_state);
+        }
+
+        switch (mode_internal)
+        {
+            case dispatch_mode::THREADED :
+                return run_threaded(target_program, initial_state);
+
+            case dispatch_mode::DECODED :
+                return run_decoded(target_program, initial_state);
+
+            case dispatch_mode::REGISTER :
+                return run_register(target_program, initial_state);
+
+            case dispatch_mode::TAIL_CALL :
+                return run_tail_call(target_program, initial_state);
+
+            case dispatch_mode::STACK_CACHED :
+                return run_stack_cached(target_program, initial_state);
+
+            case dispatch_mode::SWITCH :
+                [[fallthrough]];
+            default :
+                return run_switch(target_program, initial_state);
+        }
+    }
+
+    auto interpreter::run_switch(const program &target_program, state &initial_state) -> result<>
     {
         uint32_t                       pc   = 0;
         const std::span<const uint8_t> code = target_program.code;
@@ -91,6 +140,11 @@ namespace j1t::vm
 
             opcode op = static_cast<opcode>(opcode_u8.value());
 
+            if (profiler_internal != nullptr)
+            {
+                profiler_internal->record(opcode_pc, opcode_u8.value());
+            }
+
             switch (op)
             {
                 case opcode::NOP :
@@ -221,7 +275,9 @@ namespace j1t::vm
                             return std::unexpected(error::DIVISION_BY_ZERO);
                         }
 
-                        int32_t result = lhs / rhs;
+                        // INT32_MIN / -1 overflows (and traps on x86-64); wrap
+                        // like SDIV on aarch64
+                        int32_t result = (rhs == -1) ? static_cast<int32_t>(0u - static_cast<uint32_t>(lhs)) : lhs / rhs;
 
                         push_u32(static_cast<uint32_t>(result));
                         break;
@@ -268,7 +324,7 @@ namespace j1t::vm
                         }
 
                         uint32_t addr = address.value();
-                        if (addr + 1 >= initial_state.memory.size())
+                        if (static_cast<uint64_t>(addr) + 1 >= initial_state.memory.size())
                         {
                             return std::unexpected(error::MEMORY_OUT_OF_BOUNDS);
                         }
@@ -356,7 +412,7 @@ namespace j1t::vm
                         }
 
                         uint32_t addr = address.value();
-                        if (addr + 3 >= initial_state.memory.size())
+                        if (static_cast<uint64_t>(addr) + 3 >= initial_state.memory.size())
                         {
                             return std::unexpected(error::MEMORY_OUT_OF_BOUNDS);
                         }
@@ -0,0 +1,696 @@
+#include <vm/interpreter.hpp>
+#include <vm/superinstructions.hpp>
+
+#include <util/compiler.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+
+namespace j1t::vm
+{
+    // Same semantics and error order as run_switch(), over the records of
+    // program::decoded(): immediates are pre-widened and jumps go straight to
+    // their target record, so no handler touches program::code.
+    auto interpreter::run_decoded(const program &target_program, state &initial_state) -> result<>
+    {
+        const std::shared_ptr<const decoded_program> decoded = target_program.decoded();
+        if (!decoded->is_linear)
+        {
+            return run_threaded(target_program, initial_state);
+        }
+
+        // a verified program cannot underflow or index past locals_used, so
+        // those checks go once the run itself starts inside the verified facts
+        const std::shared_ptr<const verification> facts = target_program.verified();
+        if (facts->is_verified && initial_state.stack.empty() && initial_state.locals.size() >= facts->locals_used)
+        {
+            initial_state.stack.reserve(facts->max_stack_depth);
+            return run_decoded_records<true>(*decoded, initial_state);
+        }
+
+        return run_decoded_records<false>(*decoded, initial_state);
+    }
+
+    // A superinstruction handler checks every precondition of its sequence up
+    // front; if any fails it re-runs the sequence one record at a time through
+    // the plain handlers, which then raise the error exactly as they would have.
+    auto interpreter::run_until_hot(
+        const program      &target_program,
+        state              &initial_state,
+        uint32_t            start_pc,
+        std::span<uint32_t> loop_counters,
+        uint32_t            threshold
+    ) -> result<std::variant<execution_info, hot_loop>>
+    {
+        const std::shared_ptr<const decoded_program> decoded = target_program.decoded();
+        if (!decoded->is_linear)
+        {
+            // no record to resume at and nothing a backend could compile
+            if (start_pc != 0u)
+            {
+                return std::unexpected(error::PC_OUT_OF_RANGE);
+            }
+            return run_threaded(target_program, initial_state);
+        }
+
+        const std::vector<instruction> &instructions = decoded->instructions;
+        const auto                      start        = std::lower_bound(
+            instructions.begin(),
+            instructions.end(),
+            start_pc,
+            [](const instruction &record, uint32_t pc)
+            {
+                return record.pc < pc;
+            }
+        );
+        if (start == instructions.end() || start->pc != start_pc)
+        {
+            return std::unexpected(error::PC_OUT_OF_RANGE);
+        }
+
+        const uint32_t start_index = static_cast<uint32_t>(start - instructions.begin());
+        const bool     is_counting = !loop_counters.empty();
+        if (is_counting && loop_counters.size() <= target_program.code.size())
+        {
+            return std::unexpected(error::PC_OUT_OF_RANGE);
+        }
+
+        hot_loop_watch watch {
+            .counters  = loop_counters,
+            .threshold = threshold,
+        };
+
+        // only a run from the top has the stack the verifier assumed
+        const std::shared_ptr<const verification> facts = target_program.verified();
+        const bool is_verified = facts->is_verified && start_index == 0u && initial_state.stack.empty()
+                              && initial_state.locals.size() >= facts->locals_used;
+
+        result<> outcome {};
+        if (is_verified)
+        {
+            initial_state.stack.reserve(facts->max_stack_depth);
+            outcome = is_counting ? run_decoded_records<true, true>(*decoded, initial_state, start_index, &watch)
+                                  : run_decoded_records<true, false>(*decoded, initial_state, start_index);
+        }
+        else
+        {
+            outcome = is_counting ? run_decoded_records<false, true>(*decoded, initial_state, start_index, &watch)
+                                  : run_decoded_records<false, false>(*decoded, initial_state, start_index);
+        }
+
+        if (!outcome)
+        {
+            return std::unexpected(outcome.error());
+        }
+        if (watch.hot_pc.has_value())
+        {
+            return hot_loop { .pc = watch.hot_pc.value() };
+        }
+        return outcome.value();
+    }
+
+    template<bool IS_VERIFIED, bool IS_COUNTING>
+    auto interpreter::run_decoded_records(
+        const decoded_program &decoded,
+        state                 &initial_state,
+        uint32_t               start_index,
+        hot_loop_watch        *watch
+    ) -> result<>
+    {
+        const instruction *const instructions = decoded.instructions.data();
+        const instruction       *ip           = instructions + start_index;
+
+        static_cast<void>(watch);
+
+        std::vector<uint32_t> &stack  = initial_state.stack;
+        std::vector<uint32_t> &locals = initial_state.locals;
+        std::vector<uint8_t>  &memory = initial_state.memory;
+
+#define J1T_REQUIRE(condition, error_value)      \
+    do                                           \
+    {                                            \
+        if (!(condition)) [[unlikely]]           \
+        {                                        \
+            return std::unexpected(error_value); \
+        }                                        \
+    } while (0)
+
+// stack depth and local index checks, which verified programs cannot fail
+#define J1T_CHECKED(condition) (!IS_VERIFIED && (condition))
+#define J1T_REQUIRE_CHECKED(condition, error_value) \
+    do                                              \
+    {                                               \
+        if constexpr (!IS_VERIFIED)                 \
+        {                                           \
+            J1T_REQUIRE(condition, error_value);    \
+        }                                           \
+    } while (0)
+
+#define J1T_UNFUSED(name) goto op_##name
+
+// taken backward jumps count towards their target when run_until_hot() asked
+// for it; the run then stops in front of a header that got hot
+#define J1T_JUMP(record)                                                                     \
+    do                                                                                       \
+    {                                                                                        \
+        J1T_REQUIRE((record).target != instruction::INVALID_TARGET, error::PC_OUT_OF_RANGE); \
+        const uint32_t jump_pc = (record).pc;                                                \
+        ip                     = instructions + (record).target;                             \
+        if constexpr (IS_COUNTING)                                                           \
+        {                                                                                    \
+            if (ip->pc <= jump_pc && ++watch->counters[ip->pc] >= watch->threshold)          \
+            {                                                                                \
+                watch->hot_pc = ip->pc;                                                      \
+                return execution_info {};                                                    \
+            }                                                                                \
+        }                                                                                    \
+    } while (0)
+
+#if J1T_HAS_COMPUTED_GOTO
+        const void *dispatch_table[256];
+        std::fill(std::begin(dispatch_table), std::end(dispatch_table), &&op_invalid);
+
+        dispatch_table[op_to_raw(opcode::NOP)]                = &&op_nop;
+        dispatch_table[op_to_raw(opcode::PUSH)]               = &&op_push;
+        dispatch_table[op_to_raw(opcode::POP)]                = &&op_pop;
+        dispatch_table[op_to_raw(opcode::LOCAL_GET)]          = &&op_local_get;
+        dispatch_table[op_to_raw(opcode::LOCAL_SET)]          = &&op_local_set;
+        dispatch_table[op_to_raw(opcode::ADD)]                = &&op_add;
+        dispatch_table[op_to_raw(opcode::SUB)]                = &&op_sub;
+        dispatch_table[op_to_raw(opcode::MUL)]                = &&op_mul;
+        dispatch_table[op_to_raw(opcode::DIV)]                = &&op_div;
+        dispatch_table[op_to_raw(opcode::EQ)]                 = &&op_eq;
+        dispatch_table[op_to_raw(opcode::LESS_THAN_SIGNED)]   = &&op_less_than_signed;
+        dispatch_table[op_to_raw(opcode::LESS_THAN_UNSIGNED)] = &&op_less_than_unsigned;
+        dispatch_table[op_to_raw(opcode::LOAD_8_UNSIGNED)]    = &&op_load_8_unsigned;
+        dispatch_table[op_to_raw(opcode::LOAD_16_UNSIGNED)]   = &&op_load_16_unsigned;
+        dispatch_table[op_to_raw(opcode::LOAD_32)]            = &&op_load_32;
+        dispatch_table[op_to_raw(opcode::STORE_8)]            = &&op_store_8;
+        dispatch_table[op_to_raw(opcode::JUMP)]               = &&op_jump;
+        dispatch_table[op_to_raw(opcode::JUMP_IF_ZERO)]       = &&op_jump_if_zero;
+        dispatch_table[op_to_raw(opcode::JUMP_IF_NOT_ZERO)]   = &&op_jump_if_not_zero;
+        dispatch_table[op_to_raw(opcode::RET)]                = &&op_ret;
+        dispatch_table[op_to_raw(opcode::PRINT)]              = &&op_print;
+        dispatch_table[op_to_raw(opcode::READ_8_UNSIGNED)]    = &&op_read_8_unsigned;
+        dispatch_table[instruction::OP_END_OF_CODE]           = &&op_end_of_code;
+        dispatch_table[instruction::OP_TRUNCATED]             = &&op_truncated;
+
+        dispatch_table[OP_LOCAL_GET_LOCAL_GET]                           = &&op_local_get_local_get;
+        dispatch_table[OP_LOCAL_LOCAL_MUL]                               = &&op_local_local_mul;
+        dispatch_table[OP_LOCAL_LOCAL_EQ_JUMP_IF_NOT_ZERO]               = &&op_local_local_eq_jump_if_not_zero;
+        dispatch_table[OP_LOCAL_LOCAL_LESS_THAN_SIGNED_JUMP_IF_NOT_ZERO] = &&op_local_local_less_than_signed_jump_if_not_zero;
+        dispatch_table[OP_LOCAL_PUSH_EQ_JUMP_IF_NOT_ZERO]                = &&op_local_push_eq_jump_if_not_zero;
+        dispatch_table[OP_LOCAL_PUSH_ADD_LOCAL_SET]                      = &&op_local_push_add_local_set;
+        dispatch_table[OP_LOCAL_ADD_LOCAL_SET]                           = &&op_local_add_local_set;
+        dispatch_table[OP_LOCAL_GET_LOCAL_SET]                           = &&op_local_get_local_set;
+        dispatch_table[OP_LOCAL_ADD]                                     = &&op_local_add;
+        dispatch_table[OP_ADD_LOCAL_SET]                                 = &&op_add_local_set;
+        dispatch_table[OP_PUSH_LOCAL_SET]                                = &&op_push_local_set;
+        dispatch_table[OP_PUSH_MUL]                                      = &&op_push_mul;
+        dispatch_table[OP_PUSH_DIV]                                      = &&op_push_div;
+
+#define J1T_TARGET(raw, name) op_##name:
+#define J1T_FALLBACK_TARGET(raw, name) op_##name:
+#define J1T_NEXT()                      \
+    do                                  \
+    {                                   \
+        goto *dispatch_table[ip->op];   \
+    } while (0)
+#define J1T_DISPATCH_BEGIN() J1T_NEXT();
+#define J1T_DISPATCH_END()
+#else
+#define J1T_TARGET(raw, name) case (raw):
+#define J1T_FALLBACK_TARGET(raw, name) \
+    case (raw):                        \
+    op_##name:
+#define J1T_NEXT() continue
+#define J1T_DISPATCH_BEGIN() \
+    for (;;)                 \
+    {                        \
+        switch (ip->op)      \
+        {
+#define J1T_DISPATCH_END()                                  \
+    default :                                               \
+        return std::unexpected(error::INVALID_OPCODE);      \
+        }                                                   \
+        }
+#endif
+
+        J1T_DISPATCH_BEGIN()
+
+        J1T_TARGET(op_to_raw(opcode::NOP), nop)
+        {
+            ++ip;
+            J1T_NEXT();
+        }
+
+        J1T_FALLBACK_TARGET(op_to_raw(opcode::PUSH), push)
+        {
+            stack.push_back(ip->immediate);
+            ++ip;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::POP), pop)
+        {
+            J1T_REQUIRE_CHECKED(!stack.empty(), error::STACK_UNDERFLOW);
+            stack.pop_back();
+            ++ip;
+            J1T_NEXT();
+        }
+
+        J1T_FALLBACK_TARGET(op_to_raw(opcode::LOCAL_GET), local_get)
+        {
+            const uint32_t index = ip->immediate;
+            J1T_REQUIRE_CHECKED(index < locals.size(), error::INVALID_LOCAL_INDEX);
+            stack.push_back(locals[index]);
+            ++ip;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::LOCAL_SET), local_set)
+        {
+            const uint32_t index = ip->immediate;
+            J1T_REQUIRE_CHECKED(index < locals.size(), error::INVALID_LOCAL_INDEX);
+            J1T_REQUIRE_CHECKED(!stack.empty(), error::STACK_UNDERFLOW);
+            locals[index] = stack.back();
+            stack.pop_back();
+            ++ip;
+            J1T_NEXT();
+        }
+
+        J1T_FALLBACK_TARGET(op_to_raw(opcode::ADD), add)
+        {
+            J1T_REQUIRE_CHECKED(stack.size() >= 2u, error::STACK_UNDERFLOW);
+            uint32_t rhs = stack.back();
+            stack.pop_back();
+            stack.back() += rhs;
+            ++ip;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::SUB), sub)
+        {
+            J1T_REQUIRE_CHECKED(stack.size() >= 2u, error::STACK_UNDERFLOW);
+            uint32_t rhs = stack.back();
+            stack.pop_back();
+            stack.back() -= rhs;
+            ++ip;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::MUL), mul)
+        {
+            J1T_REQUIRE_CHECKED(stack.size() >= 2u, error::STACK_UNDERFLOW);
+            uint32_t rhs = stack.back();
+            stack.pop_back();
+            stack.back() *= rhs;
+            ++ip;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::DIV), div)
+        {
+            J1T_REQUIRE_CHECKED(stack.size() >= 2u, error::STACK_UNDERFLOW);
+            int32_t rhs = static_cast<int32_t>(stack.back());
+            stack.pop_back();
+            int32_t lhs = static_cast<int32_t>(stack.back());
+            stack.pop_back();
+
+            J1T_REQUIRE(rhs != 0, error::DIVISION_BY_ZERO);
+
+            // INT32_MIN / -1 wraps, see run_switch()
+            int32_t result = (rhs == -1) ? static_cast<int32_t>(0u - static_cast<uint32_t>(lhs)) : lhs / rhs;
+            stack.push_back(static_cast<uint32_t>(result));
+            ++ip;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::EQ), eq)
+        {
+            J1T_REQUIRE_CHECKED(stack.size() >= 2u, error::STACK_UNDERFLOW);
+            uint32_t rhs = stack.back();
+            stack.pop_back();
+            stack.back() = (stack.back() == rhs) ? 1u : 0u;
+            ++ip;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::LESS_THAN_SIGNED), less_than_signed)
+        {
+            J1T_REQUIRE_CHECKED(stack.size() >= 2u, error::STACK_UNDERFLOW);
+            int32_t rhs = static_cast<int32_t>(stack.back());
+            stack.pop_back();
+            stack.back() = (static_cast<int32_t>(stack.back()) < rhs) ? 1u : 0u;
+            ++ip;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::LESS_THAN_UNSIGNED), less_than_unsigned)
+        {
+            J1T_REQUIRE_CHECKED(stack.size() >= 2u, error::STACK_UNDERFLOW);
+            uint32_t rhs = stack.back();
+            stack.pop_back();
+            stack.back() = (stack.back() < rhs) ? 1u : 0u;
+            ++ip;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::LOAD_8_UNSIGNED), load_8_unsigned)
+        {
+            J1T_REQUIRE_CHECKED(!stack.empty(), error::STACK_UNDERFLOW);
+            uint32_t addr = stack.back();
+            J1T_REQUIRE(addr < memory.size(), error::MEMORY_OUT_OF_BOUNDS);
+            stack.back() = static_cast<uint32_t>(memory[addr]);
+            ++ip;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::LOAD_16_UNSIGNED), load_16_unsigned)
+        {
+            J1T_REQUIRE_CHECKED(!stack.empty(), error::STACK_UNDERFLOW);
+            uint32_t addr = stack.back();
+            J1T_REQUIRE(static_cast<uint64_t>(addr) + 1u < memory.size(), error::MEMORY_OUT_OF_BOUNDS);
+            stack.back() = static_cast<uint32_t>(memory[addr]) | (static_cast<uint32_t>(memory[addr + 1]) << 8);
+            ++ip;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::LOAD_32), load_32)
+        {
+            J1T_REQUIRE_CHECKED(!stack.empty(), error::STACK_UNDERFLOW);
+            uint32_t addr = stack.back();
+            J1T_REQUIRE(static_cast<uint64_t>(addr) + 3u < memory.size(), error::MEMORY_OUT_OF_BOUNDS);
+            stack.back() = static_cast<uint32_t>(memory[addr]) | (static_cast<uint32_t>(memory[addr + 1]) << 8)
+                         | (static_cast<uint32_t>(memory[addr + 2]) << 16)
+                         | (static_cast<uint32_t>(memory[addr + 3]) << 24);
+            ++ip;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::STORE_8), store_8)
+        {
+            J1T_REQUIRE_CHECKED(stack.size() >= 2u, error::STACK_UNDERFLOW);
+            uint32_t value = stack.back();
+            stack.pop_back();
+            uint32_t addr = stack.back();
+            stack.pop_back();
+            J1T_REQUIRE(addr < memory.size(), error::MEMORY_OUT_OF_BOUNDS);
+            memory[addr] = static_cast<uint8_t>(value & 0xFFu);
+            ++ip;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::JUMP), jump)
+        {
+            J1T_JUMP(*ip);
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::JUMP_IF_ZERO), jump_if_zero)
+        {
+            J1T_REQUIRE_CHECKED(!stack.empty(), error::STACK_UNDERFLOW);
+            uint32_t condition = stack.back();
+            stack.pop_back();
+            if (condition == 0u)
+            {
+                J1T_JUMP(*ip);
+            }
+            else
+            {
+                ++ip;
+            }
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::JUMP_IF_NOT_ZERO), jump_if_not_zero)
+        {
+            J1T_REQUIRE_CHECKED(!stack.empty(), error::STACK_UNDERFLOW);
+            uint32_t condition = stack.back();
+            stack.pop_back();
+            if (condition != 0u)
+            {
+                J1T_JUMP(*ip);
+            }
+            else
+            {
+                ++ip;
+            }
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::RET), ret)
+        {
+            J1T_REQUIRE_CHECKED(!stack.empty(), error::STACK_UNDERFLOW);
+            uint32_t value = stack.back();
+            stack.pop_back();
+
+            execution_info info {
+                .pc           = ip->pc + 1u,
+                .return_value = value,
+            };
+
+            return info;
+        }
+
+        J1T_TARGET(op_to_raw(opcode::PRINT), print)
+        {
+            J1T_REQUIRE_CHECKED(!stack.empty(), error::STACK_UNDERFLOW);
+            uint32_t value = stack.back();
+            stack.pop_back();
+            putchar(static_cast<uint8_t>(value));
+            ++ip;
+            J1T_NEXT();
+        }
+
+        // HACK: for brainfuck
+        J1T_TARGET(op_to_raw(opcode::READ_8_UNSIGNED), read_8_unsigned)
+        {
+            int c = std::getchar();
+            if (c == EOF)
+            {
+                c = 0;
+            }
+
+            stack.push_back(static_cast<uint32_t>(static_cast<uint8_t>(c)));
+            ++ip;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(OP_LOCAL_GET_LOCAL_GET, local_get_local_get)
+        {
+            const uint32_t first  = ip[0].immediate;
+            const uint32_t second = ip[1].immediate;
+            if (J1T_CHECKED(first >= locals.size() || second >= locals.size())) [[unlikely]]
+            {
+                J1T_UNFUSED(local_get);
+            }
+            stack.push_back(locals[first]);
+            stack.push_back(locals[second]);
+            ip += 2;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(OP_LOCAL_LOCAL_MUL, local_local_mul)
+        {
+            const uint32_t first  = ip[0].immediate;
+            const uint32_t second = ip[1].immediate;
+            if (J1T_CHECKED(first >= locals.size() || second >= locals.size())) [[unlikely]]
+            {
+                J1T_UNFUSED(local_get);
+            }
+            stack.push_back(locals[first] * locals[second]);
+            ip += 3;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(OP_LOCAL_LOCAL_EQ_JUMP_IF_NOT_ZERO, local_local_eq_jump_if_not_zero)
+        {
+            const uint32_t first  = ip[0].immediate;
+            const uint32_t second = ip[1].immediate;
+            if (J1T_CHECKED(first >= locals.size() || second >= locals.size())) [[unlikely]]
+            {
+                J1T_UNFUSED(local_get);
+            }
+            if (locals[first] == locals[second])
+            {
+                J1T_JUMP(ip[3]);
+            }
+            else
+            {
+                ip += 4;
+            }
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(OP_LOCAL_LOCAL_LESS_THAN_SIGNED_JUMP_IF_NOT_ZERO, local_local_less_than_signed_jump_if_not_zero)
+        {
+            const uint32_t first  = ip[0].immediate;
+            const uint32_t second = ip[1].immediate;
+            if (J1T_CHECKED(first >= locals.size() || second >= locals.size())) [[unlikely]]
+            {
+                J1T_UNFUSED(local_get);
+            }
+            if (static_cast<int32_t>(locals[first]) < static_cast<int32_t>(locals[second]))
+            {
+                J1T_JUMP(ip[3]);
+            }
+            else
+            {
+                ip += 4;
+            }
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(OP_LOCAL_PUSH_EQ_JUMP_IF_NOT_ZERO, local_push_eq_jump_if_not_zero)
+        {
+            const uint32_t index = ip[0].immediate;
+            if (J1T_CHECKED(index >= locals.size())) [[unlikely]]
+            {
+                J1T_UNFUSED(local_get);
+            }
+            if (locals[index] == ip[1].immediate)
+            {
+                J1T_JUMP(ip[3]);
+            }
+            else
+            {
+                ip += 4;
+            }
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(OP_LOCAL_PUSH_ADD_LOCAL_SET, local_push_add_local_set)
+        {
+            const uint32_t source      = ip[0].immediate;
+            const uint32_t destination = ip[3].immediate;
+            if (J1T_CHECKED(source >= locals.size() || destination >= locals.size())) [[unlikely]]
+            {
+                J1T_UNFUSED(local_get);
+            }
+            locals[destination] = locals[source] + ip[1].immediate;
+            ip += 4;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(OP_LOCAL_ADD_LOCAL_SET, local_add_local_set)
+        {
+            const uint32_t source      = ip[0].immediate;
+            const uint32_t destination = ip[2].immediate;
+            if (J1T_CHECKED(source >= locals.size() || destination >= locals.size() || stack.empty())) [[unlikely]]
+            {
+                J1T_UNFUSED(local_get);
+            }
+            locals[destination] = stack.back() + locals[source];
+            stack.pop_back();
+            ip += 3;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(OP_LOCAL_GET_LOCAL_SET, local_get_local_set)
+        {
+            const uint32_t source      = ip[0].immediate;
+            const uint32_t destination = ip[1].immediate;
+            if (J1T_CHECKED(source >= locals.size() || destination >= locals.size())) [[unlikely]]
+            {
+                J1T_UNFUSED(local_get);
+            }
+            locals[destination] = locals[source];
+            ip += 2;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(OP_LOCAL_ADD, local_add)
+        {
+            const uint32_t index = ip[0].immediate;
+            if (J1T_CHECKED(index >= locals.size() || stack.empty())) [[unlikely]]
+            {
+                J1T_UNFUSED(local_get);
+            }
+            stack.back() += locals[index];
+            ip += 2;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(OP_ADD_LOCAL_SET, add_local_set)
+        {
+            const uint32_t destination = ip[1].immediate;
+            if (J1T_CHECKED(stack.size() < 2u || destination >= locals.size())) [[unlikely]]
+            {
+                J1T_UNFUSED(add);
+            }
+            uint32_t rhs = stack.back();
+            stack.pop_back();
+            locals[destination] = stack.back() + rhs;
+            stack.pop_back();
+            ip += 2;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(OP_PUSH_LOCAL_SET, push_local_set)
+        {
+            const uint32_t destination = ip[1].immediate;
+            if (J1T_CHECKED(destination >= locals.size())) [[unlikely]]
+            {
+                J1T_UNFUSED(push);
+            }
+            locals[destination] = ip[0].immediate;
+            ip += 2;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(OP_PUSH_MUL, push_mul)
+        {
+            if (J1T_CHECKED(stack.empty())) [[unlikely]]
+            {
+                J1T_UNFUSED(push);
+            }
+            stack.back() *= ip[0].immediate;
+            ip += 2;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(OP_PUSH_DIV, push_div)
+        {
+            const int32_t rhs = static_cast<int32_t>(ip[0].immediate);
+            if (J1T_CHECKED(stack.empty()) || rhs == 0) [[unlikely]]
+            {
+                J1T_UNFUSED(push);
+            }
+            int32_t lhs    = static_cast<int32_t>(stack.back());
+            int32_t result = (rhs == -1) ? static_cast<int32_t>(0u - static_cast<uint32_t>(lhs)) : lhs / rhs;
+            stack.back()   = static_cast<uint32_t>(result);
+            ip += 2;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(instruction::OP_TRUNCATED, truncated)
+        {
+            return std::unexpected(error::PC_OUT_OF_RANGE);
+        }
+
+        J1T_TARGET(instruction::OP_END_OF_CODE, end_of_code)
+        {
+            return std::unexpected(error::NON_TERMINATED_PROGRAM);
+        }
+
+        J1T_TARGET(instruction::OP_INVALID, invalid)
+        {
+            return std::unexpected(error::INVALID_OPCODE);
+        }
+
+        J1T_DISPATCH_END()
+
+#undef J1T_DISPATCH_END
+#undef J1T_DISPATCH_BEGIN
+#undef J1T_NEXT
+#undef J1T_FALLBACK_TARGET
+#undef J1T_TARGET
+#undef J1T_JUMP
+#undef J1T_UNFUSED
+#undef J1T_REQUIRE_CHECKED
+#undef J1T_CHECKED
+#undef J1T_REQUIRE
+    }
+}
@@ -0,0 +1,311 @@
+#include <vm/interpreter.hpp>
+
+#include <util/compiler.hpp>
+
+#include <algorithm>
+#include <cstdio>
+
+namespace j1t::vm
+{
+    // Runs program::translated(). The operand stack only exists at the edges:
+    // locals are copied into the register file on entry and back on every
+    // exit, and RET hands the slots left below its result to state::stack.
+    auto interpreter::run_register(const program &target_program, state &initial_state) -> result<>
+    {
+        const std::shared_ptr<const register_program> translated = target_program.translated();
+        if (!translated->is_translated || !initial_state.stack.empty()
+            || initial_state.locals.size() < translated->locals_used)
+        {
+            return run_decoded(target_program, initial_state);
+        }
+
+        std::vector<uint32_t> &locals = initial_state.locals;
+        std::vector<uint8_t>  &memory = initial_state.memory;
+
+        std::vector<uint32_t> registers = translated->registers;
+        std::copy_n(locals.begin(), translated->locals_used, registers.begin());
+
+        auto execute = [&]() -> result<>
+        {
+            const register_instruction *const instructions = translated->instructions.data();
+            const register_instruction       *ip           = instructions;
+            uint32_t *const                   r            = registers.data();
+
+#define J1T_REQUIRE(condition, error_value)      \
+    do                                           \
+    {                                            \
+        if (!(condition)) [[unlikely]]           \
+        {                                        \
+            return std::unexpected(error_value); \
+        }                                        \
+    } while (0)
+
+#define J1T_BRANCH(condition)                                  \
+    do                                                         \
+    {                                                          \
+        ip = (condition) ? instructions + ip->target : ip + 1; \
+    } while (0)
+
+#if J1T_HAS_COMPUTED_GOTO
+            static constexpr std::size_t OP_COUNT = static_cast<std::size_t>(register_op::FAIL) + 1u;
+
+            const void *dispatch_table[OP_COUNT];
+            dispatch_table[static_cast<std::size_t>(register_op::MOVE)]                           = &&op_move;
+            dispatch_table[static_cast<std::size_t>(register_op::ADD)]                            = &&op_add;
+            dispatch_table[static_cast<std::size_t>(register_op::SUB)]                            = &&op_sub;
+            dispatch_table[static_cast<std::size_t>(register_op::MUL)]                            = &&op_mul;
+            dispatch_table[static_cast<std::size_t>(register_op::DIV)]                            = &&op_div;
+            dispatch_table[static_cast<std::size_t>(register_op::EQ)]                             = &&op_eq;
+            dispatch_table[static_cast<std::size_t>(register_op::LESS_THAN_SIGNED)]               = &&op_less_than_signed;
+            dispatch_table[static_cast<std::size_t>(register_op::LESS_THAN_UNSIGNED)]             = &&op_less_than_unsigned;
+            dispatch_table[static_cast<std::size_t>(register_op::LOAD_8_UNSIGNED)]                = &&op_load_8_unsigned;
+            dispatch_table[static_cast<std::size_t>(register_op::LOAD_16_UNSIGNED)]               = &&op_load_16_unsigned;
+            dispatch_table[static_cast<std::size_t>(register_op::LOAD_32)]                        = &&op_load_32;
+            dispatch_table[static_cast<std::size_t>(register_op::STORE_8)]                        = &&op_store_8;
+            dispatch_table[static_cast<std::size_t>(register_op::JUMP)]                           = &&op_jump;
+            dispatch_table[static_cast<std::size_t>(register_op::JUMP_IF_ZERO)]                   = &&op_jump_if_zero;
+            dispatch_table[static_cast<std::size_t>(register_op::JUMP_IF_NOT_ZERO)]               = &&op_jump_if_not_zero;
+            dispatch_table[static_cast<std::size_t>(register_op::JUMP_IF_EQ)]                     = &&op_jump_if_eq;
+            dispatch_table[static_cast<std::size_t>(register_op::JUMP_IF_NOT_EQ)]                 = &&op_jump_if_not_eq;
+            dispatch_table[static_cast<std::size_t>(register_op::JUMP_IF_LESS_THAN_SIGNED)]       = &&op_jump_if_less_than_signed;
+            dispatch_table[static_cast<std::size_t>(register_op::JUMP_IF_GREATER_EQUAL_SIGNED)]   = &&op_jump_if_greater_equal_signed;
+            dispatch_table[static_cast<std::size_t>(register_op::JUMP_IF_LESS_THAN_UNSIGNED)]     = &&op_jump_if_less_than_unsigned;
+            dispatch_table[static_cast<std::size_t>(register_op::JUMP_IF_GREATER_EQUAL_UNSIGNED)] = &&op_jump_if_greater_equal_unsigned;
+            dispatch_table[static_cast<std::size_t>(register_op::RET)]                            = &&op_ret;
+            dispatch_table[static_cast<std::size_t>(register_op::PRINT)]                          = &&op_print;
+            dispatch_table[static_cast<std::size_t>(register_op::READ_8_UNSIGNED)]                = &&op_read_8_unsigned;
+            dispatch_table[static_cast<std::size_t>(register_op::FAIL)]                           = &&op_fail;
+
+#define J1T_TARGET(op, name) op_##name:
+#define J1T_NEXT()                                              \
+    do                                                          \
+    {                                                           \
+        goto *dispatch_table[static_cast<std::size_t>(ip->op)]; \
+    } while (0)
+#define J1T_DISPATCH_BEGIN() J1T_NEXT();
+#define J1T_DISPATCH_END()
+#else
+#define J1T_TARGET(op, name) case (op):
+#define J1T_NEXT() continue
+#define J1T_DISPATCH_BEGIN() \
+    for (;;)                 \
+    {                        \
+        switch (ip->op)      \
+        {
+#define J1T_DISPATCH_END()                             \
+    default :                                          \
+        return std::unexpected(error::INVALID_OPCODE); \
+        }                                              \
+        }
+#endif
+
+            J1T_DISPATCH_BEGIN()
+
+            J1T_TARGET(register_op::MOVE, move)
+            {
+                r[ip->destination] = r[ip->a];
+                ++ip;
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::ADD, add)
+            {
+                r[ip->destination] = r[ip->a] + r[ip->b];
+                ++ip;
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::SUB, sub)
+            {
+                r[ip->destination] = r[ip->a] - r[ip->b];
+                ++ip;
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::MUL, mul)
+            {
+                r[ip->destination] = r[ip->a] * r[ip->b];
+                ++ip;
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::DIV, div)
+            {
+                int32_t lhs = static_cast<int32_t>(r[ip->a]);
+                int32_t rhs = static_cast<int32_t>(r[ip->b]);
+                J1T_REQUIRE(rhs != 0, error::DIVISION_BY_ZERO);
+
+                // INT32_MIN / -1 wraps, see run_switch()
+                int32_t result     = (rhs == -1) ? static_cast<int32_t>(0u - static_cast<uint32_t>(lhs)) : lhs / rhs;
+                r[ip->destination] = static_cast<uint32_t>(result);
+                ++ip;
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::EQ, eq)
+            {
+                r[ip->destination] = (r[ip->a] == r[ip->b]) ? 1u : 0u;
+                ++ip;
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::LESS_THAN_SIGNED, less_than_signed)
+            {
+                r[ip->destination] = (static_cast<int32_t>(r[ip->a]) < static_cast<int32_t>(r[ip->b])) ? 1u : 0u;
+                ++ip;
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::LESS_THAN_UNSIGNED, less_than_unsigned)
+            {
+                r[ip->destination] = (r[ip->a] < r[ip->b]) ? 1u : 0u;
+                ++ip;
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::LOAD_8_UNSIGNED, load_8_unsigned)
+            {
+                uint32_t addr = r[ip->a];
+                J1T_REQUIRE(addr < memory.size(), error::MEMORY_OUT_OF_BOUNDS);
+                r[ip->destination] = static_cast<uint32_t>(memory[addr]);
+                ++ip;
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::LOAD_16_UNSIGNED, load_16_unsigned)
+            {
+                uint32_t addr = r[ip->a];
+                J1T_REQUIRE(static_cast<uint64_t>(addr) + 1u < memory.size(), error::MEMORY_OUT_OF_BOUNDS);
+                r[ip->destination] = static_cast<uint32_t>(memory[addr]) | (static_cast<uint32_t>(memory[addr + 1]) << 8);
+                ++ip;
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::LOAD_32, load_32)
+            {
+                uint32_t addr = r[ip->a];
+                J1T_REQUIRE(static_cast<uint64_t>(addr) + 3u < memory.size(), error::MEMORY_OUT_OF_BOUNDS);
+                r[ip->destination] = static_cast<uint32_t>(memory[addr]) | (static_cast<uint32_t>(memory[addr + 1]) << 8)
+                                   | (static_cast<uint32_t>(memory[addr + 2]) << 16)
+                                   | (static_cast<uint32_t>(memory[addr + 3]) << 24);
+                ++ip;
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::STORE_8, store_8)
+            {
+                uint32_t addr = r[ip->a];
+                J1T_REQUIRE(addr < memory.size(), error::MEMORY_OUT_OF_BOUNDS);
+                memory[addr] = static_cast<uint8_t>(r[ip->b] & 0xFFu);
+                ++ip;
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::JUMP, jump)
+            {
+                ip = instructions + ip->target;
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::JUMP_IF_ZERO, jump_if_zero)
+            {
+                J1T_BRANCH(r[ip->a] == 0u);
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::JUMP_IF_NOT_ZERO, jump_if_not_zero)
+            {
+                J1T_BRANCH(r[ip->a] != 0u);
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::JUMP_IF_EQ, jump_if_eq)
+            {
+                J1T_BRANCH(r[ip->a] == r[ip->b]);
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::JUMP_IF_NOT_EQ, jump_if_not_eq)
+            {
+                J1T_BRANCH(r[ip->a] != r[ip->b]);
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::JUMP_IF_LESS_THAN_SIGNED, jump_if_less_than_signed)
+            {
+                J1T_BRANCH(static_cast<int32_t>(r[ip->a]) < static_cast<int32_t>(r[ip->b]));
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::JUMP_IF_GREATER_EQUAL_SIGNED, jump_if_greater_equal_signed)
+            {
+                J1T_BRANCH(static_cast<int32_t>(r[ip->a]) >= static_cast<int32_t>(r[ip->b]));
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::JUMP_IF_LESS_THAN_UNSIGNED, jump_if_less_than_unsigned)
+            {
+                J1T_BRANCH(r[ip->a] < r[ip->b]);
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::JUMP_IF_GREATER_EQUAL_UNSIGNED, jump_if_greater_equal_unsigned)
+            {
+                J1T_BRANCH(r[ip->a] >= r[ip->b]);
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::RET, ret)
+            {
+                const uint32_t *const slots = r + translated->locals_used;
+                initial_state.stack.assign(slots, slots + ip->b);
+
+                execution_info info {
+                    .pc           = ip->target,
+                    .return_value = r[ip->a],
+                };
+
+                return info;
+            }
+
+            J1T_TARGET(register_op::PRINT, print)
+            {
+                putchar(static_cast<uint8_t>(r[ip->a]));
+                ++ip;
+                J1T_NEXT();
+            }
+
+            // HACK: for brainfuck
+            J1T_TARGET(register_op::READ_8_UNSIGNED, read_8_unsigned)
+            {
+                int c = std::getchar();
+                if (c == EOF)
+                {
+                    c = 0;
+                }
+
+                r[ip->destination] = static_cast<uint32_t>(static_cast<uint8_t>(c));
+                ++ip;
+                J1T_NEXT();
+            }
+
+            J1T_TARGET(register_op::FAIL, fail)
+            {
+                return std::unexpected(static_cast<error>(ip->a));
+            }
+
+            J1T_DISPATCH_END()
+
+#undef J1T_DISPATCH_END
+#undef J1T_DISPATCH_BEGIN
+#undef J1T_NEXT
+#undef J1T_TARGET
+#undef J1T_BRANCH
+#undef J1T_REQUIRE
+        };
+
+        result<> outcome = execute();
+        std::copy_n(registers.begin(), translated->locals_used, locals.begin());
+        return outcome;
+    }
+}
@@ -0,0 +1,399 @@
+#include <vm/interpreter.hpp>
+
+#include <util/compiler.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <iterator>
+
+namespace
+{
+    inline auto load_u32_le(const uint8_t *pointer) -> uint32_t
+    {
+        return static_cast<uint32_t>(pointer[0]) | (static_cast<uint32_t>(pointer[1]) << 8)
+             | (static_cast<uint32_t>(pointer[2]) << 16) | (static_cast<uint32_t>(pointer[3]) << 24);
+    }
+}
+
+namespace j1t::vm
+{
+    // Same semantics and error order as run_threaded(), except that the
+    // operand stack is a fixed array of MAX_STACK_SIZE slots with the top
+    // element held in a local, so binary operators touch memory once and
+    // never go through std::vector. Pushing past MAX_STACK_SIZE raises
+    // STACK_OVERFLOW.
+    //
+    // For a depth of n, the element at 1-based position k < n lives in
+    // slots[k] and element n in top; slots[0] is a scratch slot that absorbs
+    // the stale top when pushing onto an empty stack, so no handler has to
+    // special-case depth 0.
+    auto interpreter::run_stack_cached(const program &target_program, state &initial_state) -> result<>
+    {
+        if (initial_state.stack.size() > MAX_STACK_SIZE)
+        {
+            return run_threaded(target_program, initial_state);
+        }
+
+        const uint8_t *const  code      = target_program.code.data();
+        const uint32_t        code_size = static_cast<uint32_t>(target_program.code.size());
+        std::vector<uint32_t> &locals    = initial_state.locals;
+        std::vector<uint8_t>  &memory    = initial_state.memory;
+
+        std::array<uint32_t, MAX_STACK_SIZE + 1> slots;
+        uint32_t *const                          base  = slots.data();
+        uint32_t *const                          limit = base + MAX_STACK_SIZE;
+        uint32_t                                *sp    = base + initial_state.stack.size();
+        uint32_t                                 top   = 0;
+
+        if (!initial_state.stack.empty())
+        {
+            std::copy(initial_state.stack.begin(), initial_state.stack.end() - 1, base + 1);
+            top = initial_state.stack.back();
+        }
+
+        uint32_t pc        = 0;
+        uint32_t opcode_pc = 0;
+        result<> outcome {};
+
+#define J1T_FAIL(error_value)                    \
+    do                                           \
+    {                                            \
+        outcome = std::unexpected(error_value);  \
+        goto spill;                              \
+    } while (0)
+
+#define J1T_REQUIRE(condition, error_value) \
+    do                                      \
+    {                                       \
+        if (!(condition)) [[unlikely]]      \
+        {                                   \
+            J1T_FAIL(error_value);          \
+        }                                   \
+    } while (0)
+
+#define J1T_REQUIRE_DEPTH(depth) J1T_REQUIRE(sp - base >= (depth), error::STACK_UNDERFLOW)
+
+#define J1T_PUSH(value)                                         \
+    do                                                          \
+    {                                                           \
+        J1T_REQUIRE(sp < limit, error::STACK_OVERFLOW);         \
+        *sp++ = top;                                            \
+        top   = (value);                                        \
+    } while (0)
+
+        // pc <= code_size holds whenever a handler runs, so the subtraction
+        // cannot wrap
+#define J1T_READ_U32(destination)                                  \
+    do                                                             \
+    {                                                              \
+        J1T_REQUIRE(code_size - pc >= 4u, error::PC_OUT_OF_RANGE); \
+        (destination) = load_u32_le(code + pc);                    \
+        pc += 4u;                                                  \
+    } while (0)
+
+        // relative to the opcode; landing exactly on code_size ends the loop
+        // like the switch interpreter does
+#define J1T_JUMP_RELATIVE(relative_offset)                                                        \
+    do                                                                                            \
+    {                                                                                             \
+        int64_t next = static_cast<int64_t>(opcode_pc) + static_cast<int64_t>(relative_offset);   \
+        J1T_REQUIRE(next >= 0 && next <= static_cast<int64_t>(code_size), error::PC_OUT_OF_RANGE); \
+        pc = static_cast<uint32_t>(next);                                                         \
+    } while (0)
+
+#if J1T_HAS_COMPUTED_GOTO
+        const void *dispatch_table[256];
+        std::fill(std::begin(dispatch_table), std::end(dispatch_table), &&op_invalid);
+
+        dispatch_table[op_to_raw(opcode::NOP)]                = &&op_nop;
+        dispatch_table[op_to_raw(opcode::PUSH)]               = &&op_push;
+        dispatch_table[op_to_raw(opcode::POP)]                = &&op_pop;
+        dispatch_table[op_to_raw(opcode::LOCAL_GET)]          = &&op_local_get;
+        dispatch_table[op_to_raw(opcode::LOCAL_SET)]          = &&op_local_set;
+        dispatch_table[op_to_raw(opcode::ADD)]                = &&op_add;
+        dispatch_table[op_to_raw(opcode::SUB)]                = &&op_sub;
+        dispatch_table[op_to_raw(opcode::MUL)]                = &&op_mul;
+        dispatch_table[op_to_raw(opcode::DIV)]                = &&op_div;
+        dispatch_table[op_to_raw(opcode::EQ)]                 = &&op_eq;
+        dispatch_table[op_to_raw(opcode::LESS_THAN_SIGNED)]   = &&op_less_than_signed;
+        dispatch_table[op_to_raw(opcode::LESS_THAN_UNSIGNED)] = &&op_less_than_unsigned;
+        dispatch_table[op_to_raw(opcode::LOAD_8_UNSIGNED)]    = &&op_load_8_unsigned;
+        dispatch_table[op_to_raw(opcode::LOAD_16_UNSIGNED)]   = &&op_load_16_unsigned;
+        dispatch_table[op_to_raw(opcode::LOAD_32)]            = &&op_load_32;
+        dispatch_table[op_to_raw(opcode::STORE_8)]            = &&op_store_8;
+        dispatch_table[op_to_raw(opcode::JUMP)]               = &&op_jump;
+        dispatch_table[op_to_raw(opcode::JUMP_IF_ZERO)]       = &&op_jump_if_zero;
+        dispatch_table[op_to_raw(opcode::JUMP_IF_NOT_ZERO)]   = &&op_jump_if_not_zero;
+        dispatch_table[op_to_raw(opcode::RET)]                = &&op_ret;
+        dispatch_table[op_to_raw(opcode::PRINT)]              = &&op_print;
+        dispatch_table[op_to_raw(opcode::READ_8_UNSIGNED)]    = &&op_read_8_unsigned;
+
+#define J1T_TARGET(raw, name) op_##name:
+#define J1T_NEXT()                        \
+    do                                    \
+    {                                     \
+        if (pc >= code_size)              \
+        {                                 \
+            goto op_end;                  \
+        }                                 \
+        opcode_pc = pc;                   \
+        goto *dispatch_table[code[pc++]]; \
+    } while (0)
+#define J1T_DISPATCH_BEGIN() J1T_NEXT();
+#define J1T_DISPATCH_END()                             \
+    op_invalid:                                        \
+        J1T_FAIL(error::INVALID_OPCODE);               \
+    op_end:                                            \
+        J1T_FAIL(error::NON_TERMINATED_PROGRAM);
+#else
+#define J1T_TARGET(raw, name) case (raw):
+#define J1T_NEXT() continue
+#define J1T_DISPATCH_BEGIN()                                 \
+    for (;;)                                                 \
+    {                                                        \
+        J1T_REQUIRE(pc < code_size, error::NON_TERMINATED_PROGRAM); \
+        opcode_pc = pc;                                      \
+        switch (code[pc++])                                  \
+        {
+#define J1T_DISPATCH_END()                 \
+    default :                              \
+        J1T_FAIL(error::INVALID_OPCODE);   \
+        }                                  \
+        }
+#endif
+
+        J1T_DISPATCH_BEGIN()
+
+        J1T_TARGET(op_to_raw(opcode::NOP), nop)
+        {
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::PUSH), push)
+        {
+            uint32_t imm32;
+            J1T_READ_U32(imm32);
+            J1T_PUSH(imm32);
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::POP), pop)
+        {
+            J1T_REQUIRE_DEPTH(1);
+            top = *--sp;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::LOCAL_GET), local_get)
+        {
+            uint32_t index;
+            J1T_READ_U32(index);
+            J1T_REQUIRE(index < locals.size(), error::INVALID_LOCAL_INDEX);
+            J1T_PUSH(locals[index]);
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::LOCAL_SET), local_set)
+        {
+            uint32_t index;
+            J1T_READ_U32(index);
+            J1T_REQUIRE(index < locals.size(), error::INVALID_LOCAL_INDEX);
+            J1T_REQUIRE_DEPTH(1);
+            locals[index] = top;
+            top           = *--sp;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::ADD), add)
+        {
+            J1T_REQUIRE_DEPTH(2);
+            top = *--sp + top;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::SUB), sub)
+        {
+            J1T_REQUIRE_DEPTH(2);
+            top = *--sp - top;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::MUL), mul)
+        {
+            J1T_REQUIRE_DEPTH(2);
+            top = *--sp * top;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::DIV), div)
+        {
+            J1T_REQUIRE_DEPTH(2);
+            int32_t rhs = static_cast<int32_t>(top);
+            int32_t lhs = static_cast<int32_t>(*--sp);
+
+            if (rhs == 0) [[unlikely]]
+            {
+                // both operands are gone, as in the other modes
+                top = *--sp;
+                J1T_FAIL(error::DIVISION_BY_ZERO);
+            }
+
+            // INT32_MIN / -1 wraps, see run_switch()
+            int32_t result = (rhs == -1) ? static_cast<int32_t>(0u - static_cast<uint32_t>(lhs)) : lhs / rhs;
+            top            = static_cast<uint32_t>(result);
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::EQ), eq)
+        {
+            J1T_REQUIRE_DEPTH(2);
+            top = (*--sp == top) ? 1u : 0u;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::LESS_THAN_SIGNED), less_than_signed)
+        {
+            J1T_REQUIRE_DEPTH(2);
+            top = (static_cast<int32_t>(*--sp) < static_cast<int32_t>(top)) ? 1u : 0u;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::LESS_THAN_UNSIGNED), less_than_unsigned)
+        {
+            J1T_REQUIRE_DEPTH(2);
+            top = (*--sp < top) ? 1u : 0u;
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::LOAD_8_UNSIGNED), load_8_unsigned)
+        {
+            J1T_REQUIRE_DEPTH(1);
+            J1T_REQUIRE(top < memory.size(), error::MEMORY_OUT_OF_BOUNDS);
+            top = static_cast<uint32_t>(memory[top]);
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::LOAD_16_UNSIGNED), load_16_unsigned)
+        {
+            J1T_REQUIRE_DEPTH(1);
+            J1T_REQUIRE(static_cast<uint64_t>(top) + 1u < memory.size(), error::MEMORY_OUT_OF_BOUNDS);
+            top = static_cast<uint32_t>(memory[top]) | (static_cast<uint32_t>(memory[top + 1]) << 8);
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::LOAD_32), load_32)
+        {
+            J1T_REQUIRE_DEPTH(1);
+            J1T_REQUIRE(static_cast<uint64_t>(top) + 3u < memory.size(), error::MEMORY_OUT_OF_BOUNDS);
+            top = load_u32_le(memory.data() + top);
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::STORE_8), store_8)
+        {
+            J1T_REQUIRE_DEPTH(2);
+            uint32_t value = top;
+            uint32_t addr  = *--sp;
+            top            = *--sp;
+            J1T_REQUIRE(addr < memory.size(), error::MEMORY_OUT_OF_BOUNDS);
+            memory[addr] = static_cast<uint8_t>(value & 0xFFu);
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::JUMP), jump)
+        {
+            uint32_t relative_offset;
+            J1T_READ_U32(relative_offset);
+            J1T_JUMP_RELATIVE(static_cast<int32_t>(relative_offset));
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::JUMP_IF_ZERO), jump_if_zero)
+        {
+            uint32_t relative_offset;
+            J1T_READ_U32(relative_offset);
+            J1T_REQUIRE_DEPTH(1);
+            uint32_t condition = top;
+            top                = *--sp;
+            if (condition == 0u)
+            {
+                J1T_JUMP_RELATIVE(static_cast<int32_t>(relative_offset));
+            }
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::JUMP_IF_NOT_ZERO), jump_if_not_zero)
+        {
+            uint32_t relative_offset;
+            J1T_READ_U32(relative_offset);
+            J1T_REQUIRE_DEPTH(1);
+            uint32_t condition = top;
+            top                = *--sp;
+            if (condition != 0u)
+            {
+                J1T_JUMP_RELATIVE(static_cast<int32_t>(relative_offset));
+            }
+            J1T_NEXT();
+        }
+
+        J1T_TARGET(op_to_raw(opcode::RET), ret)
+        {
+            J1T_REQUIRE_DEPTH(1);
+            uint32_t value = top;
+            top            = *--sp;
+
+            outcome = execution_info {
+                .pc           = pc,
+                .return_value = value,
+            };
+            goto spill;
+        }
+
+        J1T_TARGET(op_to_raw(opcode::PRINT), print)
+        {
+            J1T_REQUIRE_DEPTH(1);
+            uint32_t value = top;
+            top            = *--sp;
+            putchar(static_cast<uint8_t>(value));
+            J1T_NEXT();
+        }
+
+        // HACK: for brainfuck
+        J1T_TARGET(op_to_raw(opcode::READ_8_UNSIGNED), read_8_unsigned)
+        {
+            int c = std::getchar();
+            if (c == EOF)
+            {
+                c = 0;
+            }
+
+            J1T_PUSH(static_cast<uint32_t>(static_cast<uint8_t>(c)));
+            J1T_NEXT();
+        }
+
+        J1T_DISPATCH_END()
+
+#undef J1T_DISPATCH_END
+#undef J1T_DISPATCH_BEGIN
+#undef J1T_NEXT
+#undef J1T_TARGET
+#undef J1T_JUMP_RELATIVE
+#undef J1T_READ_U32
+#undef J1T_PUSH
+#undef J1T_REQUIRE_DEPTH
+#undef J1T_REQUIRE
+#undef J1T_FAIL
+
+    spill:
+        // hand the stack back in state::stack on every exit
+        initial_state.stack.clear();
+        if (sp != base)
+        {
+            initial_state.stack.assign(base + 1, sp);
+            initial_state.stack.push_back(top);
+        }
+
+        return outcome;
+    }
+}
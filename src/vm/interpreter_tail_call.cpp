@@ -0,0 +1,440 @@
+#include <vm/interpreter.hpp>
+#include <vm/superinstructions.hpp>
+
+#include <util/compiler.hpp>
+
+#include <array>
+#include <cstdio>
+
+#if J1T_HAS_MUSTTAIL
+namespace
+{
+    using j1t::vm::instruction;
+    using j1t::vm::interpreter;
+    using j1t::vm::op_to_raw;
+    using j1t::vm::opcode;
+
+    // what the handlers do not keep in argument registers
+    struct tail_call_frame
+    {
+        const instruction     *instructions;
+        uint32_t              *stack_base;
+        std::size_t            memory_size;
+        uint32_t              *stack_top;
+        interpreter::result<> outcome;
+    };
+
+    // ip, stack pointer, locals and memory travel in argument registers from
+    // handler to handler; every handler ends in a tail call to the next one
+    using handler = void (*)(const instruction *ip, uint32_t *sp, uint32_t *locals, uint8_t *memory, tail_call_frame *frame);
+
+#define J1T_HANDLER(name) \
+    auto name(const instruction *ip, uint32_t *sp, uint32_t *locals, uint8_t *memory, tail_call_frame *frame) -> void
+
+// clang-format off
+#define J1T_TAIL_CALL_HANDLERS(X)                                                                                       \
+    X(op_to_raw(opcode::NOP), nop)                                                                                      \
+    X(op_to_raw(opcode::PUSH), push)                                                                                    \
+    X(op_to_raw(opcode::POP), pop)                                                                                      \
+    X(op_to_raw(opcode::LOCAL_GET), local_get)                                                                          \
+    X(op_to_raw(opcode::LOCAL_SET), local_set)                                                                          \
+    X(op_to_raw(opcode::ADD), add)                                                                                      \
+    X(op_to_raw(opcode::SUB), sub)                                                                                      \
+    X(op_to_raw(opcode::MUL), mul)                                                                                      \
+    X(op_to_raw(opcode::DIV), div)                                                                                      \
+    X(op_to_raw(opcode::EQ), eq)                                                                                        \
+    X(op_to_raw(opcode::LESS_THAN_SIGNED), less_than_signed)                                                            \
+    X(op_to_raw(opcode::LESS_THAN_UNSIGNED), less_than_unsigned)                                                        \
+    X(op_to_raw(opcode::LOAD_8_UNSIGNED), load_8_unsigned)                                                              \
+    X(op_to_raw(opcode::LOAD_16_UNSIGNED), load_16_unsigned)                                                            \
+    X(op_to_raw(opcode::LOAD_32), load_32)                                                                              \
+    X(op_to_raw(opcode::STORE_8), store_8)                                                                              \
+    X(op_to_raw(opcode::JUMP), jump)                                                                                    \
+    X(op_to_raw(opcode::JUMP_IF_ZERO), jump_if_zero)                                                                    \
+    X(op_to_raw(opcode::JUMP_IF_NOT_ZERO), jump_if_not_zero)                                                            \
+    X(op_to_raw(opcode::RET), ret)                                                                                      \
+    X(op_to_raw(opcode::PRINT), print)                                                                                  \
+    X(op_to_raw(opcode::READ_8_UNSIGNED), read_8_unsigned)                                                              \
+    X(instruction::OP_END_OF_CODE, end_of_code)                                                                         \
+    X(j1t::vm::OP_LOCAL_GET_LOCAL_GET, local_get_local_get)                                                             \
+    X(j1t::vm::OP_LOCAL_LOCAL_MUL, local_local_mul)                                                                     \
+    X(j1t::vm::OP_LOCAL_LOCAL_EQ_JUMP_IF_NOT_ZERO, local_local_eq_jump_if_not_zero)                                     \
+    X(j1t::vm::OP_LOCAL_LOCAL_LESS_THAN_SIGNED_JUMP_IF_NOT_ZERO, local_local_less_than_signed_jump_if_not_zero)         \
+    X(j1t::vm::OP_LOCAL_PUSH_EQ_JUMP_IF_NOT_ZERO, local_push_eq_jump_if_not_zero)                                       \
+    X(j1t::vm::OP_LOCAL_PUSH_ADD_LOCAL_SET, local_push_add_local_set)                                                   \
+    X(j1t::vm::OP_LOCAL_ADD_LOCAL_SET, local_add_local_set)                                                             \
+    X(j1t::vm::OP_LOCAL_GET_LOCAL_SET, local_get_local_set)                                                             \
+    X(j1t::vm::OP_LOCAL_ADD, local_add)                                                                                 \
+    X(j1t::vm::OP_ADD_LOCAL_SET, add_local_set)                                                                         \
+    X(j1t::vm::OP_PUSH_LOCAL_SET, push_local_set)                                                                       \
+    X(j1t::vm::OP_PUSH_MUL, push_mul)                                                                                   \
+    X(j1t::vm::OP_PUSH_DIV, push_div)
+    // clang-format on
+
+#define J1T_DECLARE_HANDLER(raw, name) J1T_HANDLER(op_##name);
+    J1T_TAIL_CALL_HANDLERS(J1T_DECLARE_HANDLER)
+    J1T_HANDLER(op_invalid);
+#undef J1T_DECLARE_HANDLER
+
+    constexpr std::array<handler, 256> HANDLERS = []
+    {
+        std::array<handler, 256> table {};
+        table.fill(&op_invalid);
+
+#define J1T_REGISTER_HANDLER(raw, name) table[(raw)] = &op_##name;
+        J1T_TAIL_CALL_HANDLERS(J1T_REGISTER_HANDLER)
+#undef J1T_REGISTER_HANDLER
+
+        return table;
+    }();
+
+#define J1T_NEXT(next_ip)                                                             \
+    do                                                                                \
+    {                                                                                 \
+        const instruction *const target_ip = (next_ip);                               \
+        J1T_MUSTTAIL return HANDLERS[target_ip->op](target_ip, sp, locals, memory, frame); \
+    } while (0)
+
+#define J1T_FAIL(error_value)                              \
+    do                                                     \
+    {                                                      \
+        frame->stack_top = sp;                             \
+        frame->outcome   = std::unexpected(error_value);   \
+        return;                                            \
+    } while (0)
+
+#define J1T_REQUIRE(condition, error_value) \
+    do                                      \
+    {                                       \
+        if (!(condition)) [[unlikely]]      \
+        {                                   \
+            J1T_FAIL(error_value);          \
+        }                                   \
+    } while (0)
+
+    J1T_HANDLER(op_nop)
+    {
+        J1T_NEXT(ip + 1);
+    }
+
+    J1T_HANDLER(op_push)
+    {
+        *sp++ = ip->immediate;
+        J1T_NEXT(ip + 1);
+    }
+
+    J1T_HANDLER(op_pop)
+    {
+        --sp;
+        J1T_NEXT(ip + 1);
+    }
+
+    J1T_HANDLER(op_local_get)
+    {
+        *sp++ = locals[ip->immediate];
+        J1T_NEXT(ip + 1);
+    }
+
+    J1T_HANDLER(op_local_set)
+    {
+        locals[ip->immediate] = *--sp;
+        J1T_NEXT(ip + 1);
+    }
+
+    J1T_HANDLER(op_add)
+    {
+        --sp;
+        sp[-1] += sp[0];
+        J1T_NEXT(ip + 1);
+    }
+
+    J1T_HANDLER(op_sub)
+    {
+        --sp;
+        sp[-1] -= sp[0];
+        J1T_NEXT(ip + 1);
+    }
+
+    J1T_HANDLER(op_mul)
+    {
+        --sp;
+        sp[-1] *= sp[0];
+        J1T_NEXT(ip + 1);
+    }
+
+    J1T_HANDLER(op_div)
+    {
+        int32_t rhs = static_cast<int32_t>(sp[-1]);
+        int32_t lhs = static_cast<int32_t>(sp[-2]);
+        sp -= 2;
+
+        J1T_REQUIRE(rhs != 0, interpreter::error::DIVISION_BY_ZERO);
+
+        // INT32_MIN / -1 wraps, see run_switch()
+        int32_t result = (rhs == -1) ? static_cast<int32_t>(0u - static_cast<uint32_t>(lhs)) : lhs / rhs;
+        *sp++          = static_cast<uint32_t>(result);
+        J1T_NEXT(ip + 1);
+    }
+
+    J1T_HANDLER(op_eq)
+    {
+        --sp;
+        sp[-1] = (sp[-1] == sp[0]) ? 1u : 0u;
+        J1T_NEXT(ip + 1);
+    }
+
+    J1T_HANDLER(op_less_than_signed)
+    {
+        --sp;
+        sp[-1] = (static_cast<int32_t>(sp[-1]) < static_cast<int32_t>(sp[0])) ? 1u : 0u;
+        J1T_NEXT(ip + 1);
+    }
+
+    J1T_HANDLER(op_less_than_unsigned)
+    {
+        --sp;
+        sp[-1] = (sp[-1] < sp[0]) ? 1u : 0u;
+        J1T_NEXT(ip + 1);
+    }
+
+    J1T_HANDLER(op_load_8_unsigned)
+    {
+        uint32_t addr = sp[-1];
+        J1T_REQUIRE(addr < frame->memory_size, interpreter::error::MEMORY_OUT_OF_BOUNDS);
+        sp[-1] = static_cast<uint32_t>(memory[addr]);
+        J1T_NEXT(ip + 1);
+    }
+
+    J1T_HANDLER(op_load_16_unsigned)
+    {
+        uint32_t addr = sp[-1];
+        J1T_REQUIRE(static_cast<uint64_t>(addr) + 1u < frame->memory_size, interpreter::error::MEMORY_OUT_OF_BOUNDS);
+        sp[-1] = static_cast<uint32_t>(memory[addr]) | (static_cast<uint32_t>(memory[addr + 1]) << 8);
+        J1T_NEXT(ip + 1);
+    }
+
+    J1T_HANDLER(op_load_32)
+    {
+        uint32_t addr = sp[-1];
+        J1T_REQUIRE(static_cast<uint64_t>(addr) + 3u < frame->memory_size, interpreter::error::MEMORY_OUT_OF_BOUNDS);
+        sp[-1] = static_cast<uint32_t>(memory[addr]) | (static_cast<uint32_t>(memory[addr + 1]) << 8)
+               | (static_cast<uint32_t>(memory[addr + 2]) << 16) | (static_cast<uint32_t>(memory[addr + 3]) << 24);
+        J1T_NEXT(ip + 1);
+    }
+
+    J1T_HANDLER(op_store_8)
+    {
+        uint32_t value = sp[-1];
+        uint32_t addr  = sp[-2];
+        sp -= 2;
+        J1T_REQUIRE(addr < frame->memory_size, interpreter::error::MEMORY_OUT_OF_BOUNDS);
+        memory[addr] = static_cast<uint8_t>(value & 0xFFu);
+        J1T_NEXT(ip + 1);
+    }
+
+    J1T_HANDLER(op_jump)
+    {
+        J1T_NEXT(frame->instructions + ip->target);
+    }
+
+    J1T_HANDLER(op_jump_if_zero)
+    {
+        uint32_t condition = *--sp;
+        J1T_NEXT(condition == 0u ? frame->instructions + ip->target : ip + 1);
+    }
+
+    J1T_HANDLER(op_jump_if_not_zero)
+    {
+        uint32_t condition = *--sp;
+        J1T_NEXT(condition != 0u ? frame->instructions + ip->target : ip + 1);
+    }
+
+    J1T_HANDLER(op_ret)
+    {
+        uint32_t value   = *--sp;
+        frame->stack_top = sp;
+
+        static_cast<void>(locals);
+        static_cast<void>(memory);
+
+        frame->outcome = interpreter::execution_info {
+            .pc           = ip->pc + 1u,
+            .return_value = value,
+        };
+    }
+
+    J1T_HANDLER(op_print)
+    {
+        putchar(static_cast<uint8_t>(*--sp));
+        J1T_NEXT(ip + 1);
+    }
+
+    // HACK: for brainfuck
+    J1T_HANDLER(op_read_8_unsigned)
+    {
+        int c = std::getchar();
+        if (c == EOF)
+        {
+            c = 0;
+        }
+
+        *sp++ = static_cast<uint32_t>(static_cast<uint8_t>(c));
+        J1T_NEXT(ip + 1);
+    }
+
+    J1T_HANDLER(op_end_of_code)
+    {
+        static_cast<void>(ip);
+        static_cast<void>(locals);
+        static_cast<void>(memory);
+        J1T_FAIL(interpreter::error::NON_TERMINATED_PROGRAM);
+    }
+
+    // verified programs never reach it
+    J1T_HANDLER(op_invalid)
+    {
+        static_cast<void>(ip);
+        static_cast<void>(locals);
+        static_cast<void>(memory);
+        J1T_FAIL(interpreter::error::INVALID_OPCODE);
+    }
+
+    // superinstructions; without the checks of a verified program only
+    // PUSH_DIV can fail, and then hands over to the plain PUSH and DIV
+
+    J1T_HANDLER(op_local_get_local_get)
+    {
+        sp[0] = locals[ip[0].immediate];
+        sp[1] = locals[ip[1].immediate];
+        sp += 2;
+        J1T_NEXT(ip + 2);
+    }
+
+    J1T_HANDLER(op_local_local_mul)
+    {
+        *sp++ = locals[ip[0].immediate] * locals[ip[1].immediate];
+        J1T_NEXT(ip + 3);
+    }
+
+    J1T_HANDLER(op_local_local_eq_jump_if_not_zero)
+    {
+        const bool is_taken = locals[ip[0].immediate] == locals[ip[1].immediate];
+        J1T_NEXT(is_taken ? frame->instructions + ip[3].target : ip + 4);
+    }
+
+    J1T_HANDLER(op_local_local_less_than_signed_jump_if_not_zero)
+    {
+        const bool is_taken = static_cast<int32_t>(locals[ip[0].immediate]) < static_cast<int32_t>(locals[ip[1].immediate]);
+        J1T_NEXT(is_taken ? frame->instructions + ip[3].target : ip + 4);
+    }
+
+    J1T_HANDLER(op_local_push_eq_jump_if_not_zero)
+    {
+        const bool is_taken = locals[ip[0].immediate] == ip[1].immediate;
+        J1T_NEXT(is_taken ? frame->instructions + ip[3].target : ip + 4);
+    }
+
+    J1T_HANDLER(op_local_push_add_local_set)
+    {
+        locals[ip[3].immediate] = locals[ip[0].immediate] + ip[1].immediate;
+        J1T_NEXT(ip + 4);
+    }
+
+    J1T_HANDLER(op_local_add_local_set)
+    {
+        locals[ip[2].immediate] = *--sp + locals[ip[0].immediate];
+        J1T_NEXT(ip + 3);
+    }
+
+    J1T_HANDLER(op_local_get_local_set)
+    {
+        locals[ip[1].immediate] = locals[ip[0].immediate];
+        J1T_NEXT(ip + 2);
+    }
+
+    J1T_HANDLER(op_local_add)
+    {
+        sp[-1] += locals[ip[0].immediate];
+        J1T_NEXT(ip + 2);
+    }
+
+    J1T_HANDLER(op_add_local_set)
+    {
+        sp -= 2;
+        locals[ip[1].immediate] = sp[0] + sp[1];
+        J1T_NEXT(ip + 2);
+    }
+
+    J1T_HANDLER(op_push_local_set)
+    {
+        locals[ip[1].immediate] = ip[0].immediate;
+        J1T_NEXT(ip + 2);
+    }
+
+    J1T_HANDLER(op_push_mul)
+    {
+        sp[-1] *= ip[0].immediate;
+        J1T_NEXT(ip + 2);
+    }
+
+    J1T_HANDLER(op_push_div)
+    {
+        const int32_t rhs = static_cast<int32_t>(ip[0].immediate);
+        if (rhs == 0) [[unlikely]]
+        {
+            J1T_MUSTTAIL return op_push(ip, sp, locals, memory, frame);
+        }
+
+        int32_t lhs    = static_cast<int32_t>(sp[-1]);
+        int32_t result = (rhs == -1) ? static_cast<int32_t>(0u - static_cast<uint32_t>(lhs)) : lhs / rhs;
+        sp[-1]         = static_cast<uint32_t>(result);
+        J1T_NEXT(ip + 2);
+    }
+
+#undef J1T_REQUIRE
+#undef J1T_FAIL
+#undef J1T_NEXT
+#undef J1T_TAIL_CALL_HANDLERS
+#undef J1T_HANDLER
+}
+#endif
+
+namespace j1t::vm
+{
+    // One function per handler over the program::decoded() records. Only
+    // verified programs run here: with the stack depth and local indices
+    // proven, the stack is a plain array and the handlers need no checks
+    // beyond memory bounds and division by zero.
+    auto interpreter::run_tail_call(const program &target_program, state &initial_state) -> result<>
+    {
+#if J1T_HAS_MUSTTAIL
+        const std::shared_ptr<const verification> facts = target_program.verified();
+        if (!facts->is_verified || !initial_state.stack.empty() || initial_state.locals.size() < facts->locals_used)
+        {
+            return run_decoded(target_program, initial_state);
+        }
+
+        const std::shared_ptr<const decoded_program> decoded = target_program.decoded();
+
+        // never empty, so data() is never null
+        std::vector<uint32_t> stack(static_cast<std::size_t>(facts->max_stack_depth) + 1u);
+
+        tail_call_frame frame {
+            .instructions = decoded->instructions.data(),
+            .stack_base   = stack.data(),
+            .memory_size  = initial_state.memory.size(),
+            .stack_top    = stack.data(),
+            .outcome      = std::unexpected(error::INVALID_OPCODE),
+        };
+
+        const instruction *const entry = frame.instructions;
+        HANDLERS[entry->op](entry, stack.data(), initial_state.locals.data(), initial_state.memory.data(), &frame);
+
+        initial_state.stack.assign(frame.stack_base, frame.stack_top);
+        return frame.outcome;
+#else
+        // one native frame per executed opcode would overflow the stack
+        return run_decoded(target_program, initial_state);
+#endif
+    }
+}
@@ -0,0 +1,339 @@
+#include <vm/interpreter.hpp>
+
+#include <util/compiler.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+
+namespace
+{
+    inline auto load_u32_le(const uint8_t *pointer) -> uint32_t
+    {
+        return static_cast<uint32_t>(pointer[0]) | (static_cast<uint32_t>(pointer[1]) << 8)
+             | (static_cast<uint32_t>(pointer[2]) << 16) | (static_cast<uint32_t>(pointer[3]) << 24);
+    }
+}
+
+namespace j1t::vm
+{
+#if J1T_HAS_COMPUTED_GOTO
+    // Same semantics and error order as run_switch(); operands are read with a
+    // single remaining-length check instead of the optional-returning readers,
+    // and every handler dispatches the next opcode itself.
+    auto interpreter::run_threaded(const program &target_program, state &initial_state) -> result<>
+    {
+        const uint8_t *const  code      = target_program.code.data();
+        const uint32_t        code_size = static_cast<uint32_t>(target_program.code.size());
+        std::vector<uint32_t> &stack     = initial_state.stack;
+        std::vector<uint32_t> &locals    = initial_state.locals;
+        std::vector<uint8_t>  &memory    = initial_state.memory;
+
+        uint32_t pc        = 0;
+        uint32_t opcode_pc = 0;
+
+        const void *dispatch_table[256];
+        std::fill(std::begin(dispatch_table), std::end(dispatch_table), &&op_invalid);
+
+        dispatch_table[op_to_raw(opcode::NOP)]                = &&op_nop;
+        dispatch_table[op_to_raw(opcode::PUSH)]               = &&op_push;
+        dispatch_table[op_to_raw(opcode::POP)]                = &&op_pop;
+        dispatch_table[op_to_raw(opcode::LOCAL_GET)]          = &&op_local_get;
+        dispatch_table[op_to_raw(opcode::LOCAL_SET)]          = &&op_local_set;
+        dispatch_table[op_to_raw(opcode::ADD)]                = &&op_add;
+        dispatch_table[op_to_raw(opcode::SUB)]                = &&op_sub;
+        dispatch_table[op_to_raw(opcode::MUL)]                = &&op_mul;
+        dispatch_table[op_to_raw(opcode::DIV)]                = &&op_div;
+        dispatch_table[op_to_raw(opcode::EQ)]                 = &&op_eq;
+        dispatch_table[op_to_raw(opcode::LESS_THAN_SIGNED)]   = &&op_less_than_signed;
+        dispatch_table[op_to_raw(opcode::LESS_THAN_UNSIGNED)] = &&op_less_than_unsigned;
+        dispatch_table[op_to_raw(opcode::LOAD_8_UNSIGNED)]    = &&op_load_8_unsigned;
+        dispatch_table[op_to_raw(opcode::LOAD_16_UNSIGNED)]   = &&op_load_16_unsigned;
+        dispatch_table[op_to_raw(opcode::LOAD_32)]            = &&op_load_32;
+        dispatch_table[op_to_raw(opcode::STORE_8)]            = &&op_store_8;
+        dispatch_table[op_to_raw(opcode::JUMP)]               = &&op_jump;
+        dispatch_table[op_to_raw(opcode::JUMP_IF_ZERO)]       = &&op_jump_if_zero;
+        dispatch_table[op_to_raw(opcode::JUMP_IF_NOT_ZERO)]   = &&op_jump_if_not_zero;
+        dispatch_table[op_to_raw(opcode::RET)]                = &&op_ret;
+        dispatch_table[op_to_raw(opcode::PRINT)]              = &&op_print;
+        dispatch_table[op_to_raw(opcode::READ_8_UNSIGNED)]    = &&op_read_8_unsigned;
+
+#define J1T_DISPATCH()                            \
+    do                                            \
+    {                                             \
+        if (pc >= code_size)                      \
+        {                                         \
+            goto op_end;                          \
+        }                                         \
+        opcode_pc = pc;                           \
+        goto *dispatch_table[code[pc++]];         \
+    } while (0)
+
+#define J1T_REQUIRE(condition, error_value)       \
+    do                                            \
+    {                                             \
+        if (!(condition)) [[unlikely]]            \
+        {                                         \
+            return std::unexpected(error_value);  \
+        }                                         \
+    } while (0)
+
+        // pc <= code_size holds whenever a handler runs, so the subtraction
+        // cannot wrap
+#define J1T_READ_U32(destination)                                           \
+    do                                                                      \
+    {                                                                       \
+        J1T_REQUIRE(code_size - pc >= 4u, error::PC_OUT_OF_RANGE);          \
+        (destination) = load_u32_le(code + pc);                             \
+        pc += 4u;                                                           \
+    } while (0)
+
+        // relative to the opcode; landing exactly on code_size ends the loop
+        // like the switch interpreter does
+#define J1T_JUMP_RELATIVE(relative_offset)                                                        \
+    do                                                                                            \
+    {                                                                                             \
+        int64_t next = static_cast<int64_t>(opcode_pc) + static_cast<int64_t>(relative_offset);   \
+        J1T_REQUIRE(next >= 0 && next <= static_cast<int64_t>(code_size), error::PC_OUT_OF_RANGE); \
+        pc = static_cast<uint32_t>(next);                                                         \
+    } while (0)
+
+        J1T_DISPATCH();
+
+    op_nop:
+        J1T_DISPATCH();
+
+    op_push:
+    {
+        uint32_t imm32;
+        J1T_READ_U32(imm32);
+        stack.push_back(imm32);
+        J1T_DISPATCH();
+    }
+
+    op_pop:
+    {
+        J1T_REQUIRE(!stack.empty(), error::STACK_UNDERFLOW);
+        stack.pop_back();
+        J1T_DISPATCH();
+    }
+
+    op_local_get:
+    {
+        uint32_t index;
+        J1T_READ_U32(index);
+        J1T_REQUIRE(index < locals.size(), error::INVALID_LOCAL_INDEX);
+        stack.push_back(locals[index]);
+        J1T_DISPATCH();
+    }
+
+    op_local_set:
+    {
+        uint32_t index;
+        J1T_READ_U32(index);
+        J1T_REQUIRE(index < locals.size(), error::INVALID_LOCAL_INDEX);
+        J1T_REQUIRE(!stack.empty(), error::STACK_UNDERFLOW);
+        locals[index] = stack.back();
+        stack.pop_back();
+        J1T_DISPATCH();
+    }
+
+    op_add:
+    {
+        J1T_REQUIRE(stack.size() >= 2u, error::STACK_UNDERFLOW);
+        uint32_t rhs = stack.back();
+        stack.pop_back();
+        stack.back() += rhs;
+        J1T_DISPATCH();
+    }
+
+    op_sub:
+    {
+        J1T_REQUIRE(stack.size() >= 2u, error::STACK_UNDERFLOW);
+        uint32_t rhs = stack.back();
+        stack.pop_back();
+        stack.back() -= rhs;
+        J1T_DISPATCH();
+    }
+
+    op_mul:
+    {
+        J1T_REQUIRE(stack.size() >= 2u, error::STACK_UNDERFLOW);
+        uint32_t rhs = stack.back();
+        stack.pop_back();
+        stack.back() *= rhs;
+        J1T_DISPATCH();
+    }
+
+    op_div:
+    {
+        J1T_REQUIRE(stack.size() >= 2u, error::STACK_UNDERFLOW);
+        int32_t rhs = static_cast<int32_t>(stack.back());
+        stack.pop_back();
+        int32_t lhs = static_cast<int32_t>(stack.back());
+        stack.pop_back();
+
+        J1T_REQUIRE(rhs != 0, error::DIVISION_BY_ZERO);
+
+        // INT32_MIN / -1 wraps, see run_switch()
+        int32_t result = (rhs == -1) ? static_cast<int32_t>(0u - static_cast<uint32_t>(lhs)) : lhs / rhs;
+        stack.push_back(static_cast<uint32_t>(result));
+        J1T_DISPATCH();
+    }
+
+    op_eq:
+    {
+        J1T_REQUIRE(stack.size() >= 2u, error::STACK_UNDERFLOW);
+        uint32_t rhs = stack.back();
+        stack.pop_back();
+        stack.back() = (stack.back() == rhs) ? 1u : 0u;
+        J1T_DISPATCH();
+    }
+
+    op_less_than_signed:
+    {
+        J1T_REQUIRE(stack.size() >= 2u, error::STACK_UNDERFLOW);
+        int32_t rhs = static_cast<int32_t>(stack.back());
+        stack.pop_back();
+        stack.back() = (static_cast<int32_t>(stack.back()) < rhs) ? 1u : 0u;
+        J1T_DISPATCH();
+    }
+
+    op_less_than_unsigned:
+    {
+        J1T_REQUIRE(stack.size() >= 2u, error::STACK_UNDERFLOW);
+        uint32_t rhs = stack.back();
+        stack.pop_back();
+        stack.back() = (stack.back() < rhs) ? 1u : 0u;
+        J1T_DISPATCH();
+    }
+
+    op_load_8_unsigned:
+    {
+        J1T_REQUIRE(!stack.empty(), error::STACK_UNDERFLOW);
+        uint32_t addr = stack.back();
+        J1T_REQUIRE(addr < memory.size(), error::MEMORY_OUT_OF_BOUNDS);
+        stack.back() = static_cast<uint32_t>(memory[addr]);
+        J1T_DISPATCH();
+    }
+
+    op_load_16_unsigned:
+    {
+        J1T_REQUIRE(!stack.empty(), error::STACK_UNDERFLOW);
+        uint32_t addr = stack.back();
+        J1T_REQUIRE(static_cast<uint64_t>(addr) + 1u < memory.size(), error::MEMORY_OUT_OF_BOUNDS);
+        stack.back() = static_cast<uint32_t>(memory[addr]) | (static_cast<uint32_t>(memory[addr + 1]) << 8);
+        J1T_DISPATCH();
+    }
+
+    op_load_32:
+    {
+        J1T_REQUIRE(!stack.empty(), error::STACK_UNDERFLOW);
+        uint32_t addr = stack.back();
+        J1T_REQUIRE(static_cast<uint64_t>(addr) + 3u < memory.size(), error::MEMORY_OUT_OF_BOUNDS);
+        stack.back() = load_u32_le(memory.data() + addr);
+        J1T_DISPATCH();
+    }
+
+    op_store_8:
+    {
+        J1T_REQUIRE(stack.size() >= 2u, error::STACK_UNDERFLOW);
+        uint32_t value = stack.back();
+        stack.pop_back();
+        uint32_t addr = stack.back();
+        stack.pop_back();
+        J1T_REQUIRE(addr < memory.size(), error::MEMORY_OUT_OF_BOUNDS);
+        memory[addr] = static_cast<uint8_t>(value & 0xFFu);
+        J1T_DISPATCH();
+    }
+
+    op_jump:
+    {
+        uint32_t relative_offset;
+        J1T_READ_U32(relative_offset);
+        J1T_JUMP_RELATIVE(static_cast<int32_t>(relative_offset));
+        J1T_DISPATCH();
+    }
+
+    op_jump_if_zero:
+    {
+        uint32_t relative_offset;
+        J1T_READ_U32(relative_offset);
+        J1T_REQUIRE(!stack.empty(), error::STACK_UNDERFLOW);
+        uint32_t condition = stack.back();
+        stack.pop_back();
+        if (condition == 0u)
+        {
+            J1T_JUMP_RELATIVE(static_cast<int32_t>(relative_offset));
+        }
+        J1T_DISPATCH();
+    }
+
+    op_jump_if_not_zero:
+    {
+        uint32_t relative_offset;
+        J1T_READ_U32(relative_offset);
+        J1T_REQUIRE(!stack.empty(), error::STACK_UNDERFLOW);
+        uint32_t condition = stack.back();
+        stack.pop_back();
+        if (condition != 0u)
+        {
+            J1T_JUMP_RELATIVE(static_cast<int32_t>(relative_offset));
+        }
+        J1T_DISPATCH();
+    }
+
+    op_ret:
+    {
+        J1T_REQUIRE(!stack.empty(), error::STACK_UNDERFLOW);
+        uint32_t value = stack.back();
+        stack.pop_back();
+
+        execution_info info {
+            .pc           = pc,
+            .return_value = value,
+        };
+
+        return info;
+    }
+
+    op_print:
+    {
+        J1T_REQUIRE(!stack.empty(), error::STACK_UNDERFLOW);
+        uint32_t value = stack.back();
+        stack.pop_back();
+        putchar(static_cast<uint8_t>(value));
+        J1T_DISPATCH();
+    }
+
+    // HACK: for brainfuck
+    op_read_8_unsigned:
+    {
+        int c = std::getchar();
+        if (c == EOF)
+        {
+            c = 0;
+        }
+
+        stack.push_back(static_cast<uint32_t>(static_cast<uint8_t>(c)));
+        J1T_DISPATCH();
+    }
+
+    op_invalid:
+        return std::unexpected(error::INVALID_OPCODE);
+
+    op_end:
+        return std::unexpected(error::NON_TERMINATED_PROGRAM);
+
+#undef J1T_JUMP_RELATIVE
+#undef J1T_READ_U32
+#undef J1T_REQUIRE
+#undef J1T_DISPATCH
+    }
+#else
+    auto interpreter::run_threaded(const program &target_program, state &initial_state) -> result<>
+    {
+        return run_switch(target_program, initial_state);
+    }
+#endif
+}
@@ -0,0 +1,1897 @@
+#include <util/hash.hpp>
+#include <vm/assembler.hpp>
+#include <vm/decoder.hpp>
+#include <vm/interpreter.hpp>
+#include <vm/optimizer.hpp>
+#include <vm/verifier.hpp>
+
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+
+namespace
+{
+    constexpr uint32_t UNREACHED { j1t::vm::verification::UNREACHABLE };
+    constexpr uint32_t NONE { 0xFFFF'FFFFu };
+    // producer of a stack slot that was live into the block
+    constexpr uint32_t ENTRY_SLOT { 0xFFFF'FFFEu };
+
+    // phis per block are one per local, the memory state and each live stack
+    // slot; larger programs are left alone
+    constexpr uint64_t MAX_PHIS { 1u << 20 };
+    // rounds of folding and phi removal before taking what is known so far
+    constexpr uint32_t MAX_ROUNDS { 32 };
+    constexpr uint32_t MAX_TEMPORARIES { 256 };
+    // programs using more locals are left alone, which keeps slot counts
+    // and temporary indices far from wrapping
+    constexpr uint32_t MAX_OPTIMIZED_LOCALS { 1u << 16 };
+    // reloading a temporary costs about as much as recomputing this
+    constexpr uint8_t MIN_REUSE_COST { 3 };
+    // ops a loop invariant may take to rebuild from locals and constants
+    constexpr uint32_t MAX_HOISTED_OPS { 16 };
+
+    enum class value_kind : uint8_t
+    {
+        // a is the constant
+        CONSTANT,
+        // contents of slot a (a local, or the memory) when the run starts
+        ENTRY,
+        // merge of slot b at the entry of block a
+        PHI,
+        // op applied to a and b; memory reads take the memory state as b
+        OPERATION,
+        // result of READ_8_UNSIGNED, or memory after STORE_8, at record a
+        EFFECT,
+    };
+
+    struct ssa_value
+    {
+        value_kind kind { value_kind::CONSTANT };
+        uint8_t    op { 0 };
+        uint32_t   a { 0 };
+        uint32_t   b { 0 };
+
+        auto operator==(const ssa_value &) const -> bool = default;
+    };
+
+    struct ssa_value_hash
+    {
+        auto operator()(const ssa_value &key) const -> std::size_t
+        {
+            const uint64_t head     = (uint64_t { static_cast<uint8_t>(key.kind) } << 8u) | key.op;
+            const uint64_t operands = (uint64_t { key.a } << 32u) | key.b;
+
+            return static_cast<std::size_t>(j1t::util::hash_mix(operands ^ 0x9E37'79B9'7F4A'7C15u, head ^ 0xBF58'476D'1CE4'E5B9u));
+        }
+    };
+
+    enum class branch_fold : uint8_t
+    {
+        UNKNOWN,
+        TAKEN,
+        NOT_TAKEN,
+    };
+
+    // what the SSA form says about one record, from the last round
+    struct record_facts
+    {
+        // value pushed, NONE when the record pushes nothing
+        uint32_t    value { NONE };
+        // values popped and the records that pushed them (ENTRY_SLOT for slots
+        // live into the block), bottom first
+        uint32_t    operands[2] { NONE, NONE };
+        uint32_t    producers[2] { NONE, NONE };
+        uint8_t     operand_count { 0 };
+        // a local holding value right before the record, or NONE
+        uint32_t    holder { NONE };
+        // LOCAL_SET of the value the local already holds
+        bool        is_redundant_set { false };
+        branch_fold branch { branch_fold::UNKNOWN };
+    };
+
+    struct ssa_block
+    {
+        // records [first, end)
+        uint32_t              first { 0 };
+        uint32_t              end { 0 };
+        // value of the phi for slot 0; slots are the locals, the memory state
+        // and the stack slots live on entry
+        uint32_t              first_phi { 0 };
+        uint32_t              slots { 0 };
+        std::vector<uint32_t> successors;
+        std::vector<uint32_t> predecessors;
+        // slot values when the block is left
+        std::vector<uint32_t> exit;
+        bool                  is_reachable { true };
+    };
+
+    // a natural loop: its header and every block that reaches one of the
+    // header's back edges without passing the header
+    struct natural_loop
+    {
+        uint32_t              header { 0 };
+        // the innermost loop containing the header, or NONE
+        uint32_t              parent { NONE };
+        // blocks a tiered run can start at inside the loop
+        std::vector<uint32_t> entries;
+        // values computed once in front of the loop instead of in it
+        std::vector<uint32_t> invariants;
+    };
+
+    // how a record that pushes a value is lowered
+    enum class emission : uint8_t
+    {
+        ORIGINAL,
+        CONSTANT,
+        // LOCAL_GET of a local that already holds the value
+        LOCAL,
+        // LOCAL_GET of the temporary a dominating computation stored it in
+        TEMPORARY,
+        // LOCAL_GET of the temporary the preheader of a loop stored it in
+        INVARIANT,
+    };
+
+    auto is_compare(j1t::vm::opcode op) -> bool
+    {
+        using j1t::vm::opcode;
+
+        return op == opcode::EQ || op == opcode::LESS_THAN_SIGNED || op == opcode::LESS_THAN_UNSIGNED;
+    }
+
+    auto is_load(j1t::vm::opcode op) -> bool
+    {
+        using j1t::vm::opcode;
+
+        return op == opcode::LOAD_8_UNSIGNED || op == opcode::LOAD_16_UNSIGNED || op == opcode::LOAD_32;
+    }
+
+    // arithmetic and loads: worth a lookup before computing them again
+    auto is_reusable(j1t::vm::opcode op) -> bool
+    {
+        using j1t::vm::opcode;
+
+        return op == opcode::ADD || op == opcode::SUB || op == opcode::MUL || op == opcode::DIV || is_load(op);
+    }
+
+    auto is_commutative(j1t::vm::opcode op) -> bool
+    {
+        using j1t::vm::opcode;
+
+        return op == opcode::ADD || op == opcode::MUL || op == opcode::EQ;
+    }
+
+    // rough cycles, for deciding what to keep in a temporary
+    auto cost_of(j1t::vm::opcode op) -> uint32_t
+    {
+        using j1t::vm::opcode;
+
+        switch (op)
+        {
+            case opcode::MUL :
+                return 3;
+
+            case opcode::DIV :
+                return 20;
+
+            case opcode::LOAD_8_UNSIGNED :
+            case opcode::LOAD_16_UNSIGNED :
+            case opcode::LOAD_32 :
+                return 2;
+
+            default :
+                return 1;
+        }
+    }
+
+    // same results as vm::interpreter; nothing for a division by zero, which
+    // has to stay and fail
+    auto evaluate(j1t::vm::opcode op, uint32_t lhs, uint32_t rhs) -> std::optional<uint32_t>
+    {
+        using j1t::vm::opcode;
+
+        switch (op)
+        {
+            case opcode::ADD :
+                return lhs + rhs;
+
+            case opcode::SUB :
+                return lhs - rhs;
+
+            case opcode::MUL :
+                return lhs * rhs;
+
+            case opcode::DIV :
+                if (rhs == 0u)
+                {
+                    return std::nullopt;
+                }
+                if (static_cast<int32_t>(rhs) == -1)
+                {
+                    return 0u - lhs;
+                }
+                return static_cast<uint32_t>(static_cast<int32_t>(lhs) / static_cast<int32_t>(rhs));
+
+            case opcode::EQ :
+                return lhs == rhs ? 1u : 0u;
+
+            case opcode::LESS_THAN_SIGNED :
+                return static_cast<int32_t>(lhs) < static_cast<int32_t>(rhs) ? 1u : 0u;
+
+            case opcode::LESS_THAN_UNSIGNED :
+                return lhs < rhs ? 1u : 0u;
+
+            default :
+                return std::nullopt;
+        }
+    }
+
+    class ssa_optimizer
+    {
+      public:
+        ssa_optimizer(const j1t::vm::decoded_program &decoded, const j1t::vm::verification &facts)
+            : records(decoded.instructions)
+            , depths(facts.depths)
+            , locals_used(facts.locals_used)
+            , memory_slot(facts.locals_used)
+            , headers(j1t::vm::loop_headers(decoded))
+        {
+        }
+
+        // false when the program is too large to analyse
+        auto run(j1t::vm::optimized_program &output) -> bool
+        {
+            if (!build_blocks())
+            {
+                return false;
+            }
+
+            for (uint32_t round = 0;; ++round)
+            {
+                execute_blocks();
+                const bool is_cfg_changed = update_edges();
+                if (round + 1u == MAX_ROUNDS)
+                {
+                    break;
+                }
+
+                // the last execution matches the final phis once none goes
+                if (!remove_trivial_phis() && !is_cfg_changed)
+                {
+                    break;
+                }
+            }
+
+            number_values();
+            hoist_invariants();
+            lower(output);
+            return true;
+        }
+
+      private:
+        auto build_blocks(void) -> bool
+        {
+            using j1t::vm::instruction;
+            using j1t::vm::opcode;
+
+            std::vector<bool> is_leader(records.size(), false);
+            is_leader[0]                  = true;
+            is_leader[records.size() - 1] = true;
+
+            for (uint32_t index = 0; index + 1u < records.size(); ++index)
+            {
+                if (depths[index] == UNREACHED)
+                {
+                    continue;
+                }
+
+                const opcode op = static_cast<opcode>(records[index].op);
+                if (j1t::vm::is_jump(op))
+                {
+                    is_leader[records[index].target] = true;
+                }
+                if (j1t::vm::is_jump(op) || op == opcode::RET)
+                {
+                    is_leader[index + 1u] = true;
+                }
+            }
+
+            block_of.assign(records.size(), NONE);
+            uint64_t phis = 0;
+
+            for (uint32_t index = 0; index < records.size(); ++index)
+            {
+                if (depths[index] == UNREACHED)
+                {
+                    continue;
+                }
+
+                if (is_leader[index] || depths[index - 1u] == UNREACHED)
+                {
+                    const uint64_t slots = uint64_t { memory_slot } + 1u + depths[index];
+                    phis                += slots;
+                    if (phis > MAX_PHIS)
+                    {
+                        return false;
+                    }
+
+                    ssa_block block {};
+                    block.first = index;
+                    block.slots = static_cast<uint32_t>(slots);
+                    blocks.push_back(std::move(block));
+                }
+
+                block_of[index]   = static_cast<uint32_t>(blocks.size() - 1u);
+                blocks.back().end = index + 1u;
+            }
+
+            for (uint32_t b = 0; b < blocks.size(); ++b)
+            {
+                blocks[b].first_phi = static_cast<uint32_t>(values.size());
+                for (uint32_t slot = 0; slot < blocks[b].slots; ++slot)
+                {
+                    add_value(ssa_value { value_kind::PHI, 0, b, slot }, 0);
+                }
+            }
+
+            facts.assign(records.size(), record_facts {});
+            return true;
+        }
+
+        auto add_value(const ssa_value &key, uint32_t cost) -> uint32_t
+        {
+            const uint32_t id = static_cast<uint32_t>(values.size());
+            values.push_back(key);
+            parent.push_back(id);
+            costs.push_back(static_cast<uint8_t>(std::min<uint32_t>(cost, 0xFFu)));
+            return id;
+        }
+
+        auto intern(const ssa_value &key, uint32_t cost) -> uint32_t
+        {
+            auto it = interned.find(key);
+            if (it != interned.end())
+            {
+                return it->second;
+            }
+
+            const uint32_t id = add_value(key, cost);
+            interned.emplace(key, id);
+            return id;
+        }
+
+        // the value v was found equal to, following removed phis
+        auto find(uint32_t v) -> uint32_t
+        {
+            while (parent[v] != v)
+            {
+                parent[v] = parent[parent[v]];
+                v         = parent[v];
+            }
+            return v;
+        }
+
+        auto constant(uint32_t c) -> uint32_t
+        {
+            return intern(ssa_value { value_kind::CONSTANT, 0, c, 0 }, 0);
+        }
+
+        auto is_constant(uint32_t v) const -> bool
+        {
+            return values[v].kind == value_kind::CONSTANT;
+        }
+
+        auto binary(j1t::vm::opcode op, uint32_t lhs, uint32_t rhs) -> uint32_t
+        {
+            using j1t::vm::opcode;
+
+            const bool is_lhs_constant = is_constant(lhs);
+            const bool is_rhs_constant = is_constant(rhs);
+            const auto is_lhs          = [&](uint32_t c) -> bool { return is_lhs_constant && values[lhs].a == c; };
+            const auto is_rhs          = [&](uint32_t c) -> bool { return is_rhs_constant && values[rhs].a == c; };
+
+            if (is_lhs_constant && is_rhs_constant)
+            {
+                if (std::optional<uint32_t> folded = evaluate(op, values[lhs].a, values[rhs].a))
+                {
+                    return constant(*folded);
+                }
+            }
+
+            switch (op)
+            {
+                case opcode::ADD :
+                    if (is_lhs(0u))
+                    {
+                        return rhs;
+                    }
+                    if (is_rhs(0u))
+                    {
+                        return lhs;
+                    }
+                    break;
+
+                case opcode::SUB :
+                    if (is_rhs(0u))
+                    {
+                        return lhs;
+                    }
+                    if (lhs == rhs)
+                    {
+                        return constant(0u);
+                    }
+                    break;
+
+                case opcode::MUL :
+                    if (is_lhs(0u) || is_rhs(0u))
+                    {
+                        return constant(0u);
+                    }
+                    if (is_lhs(1u))
+                    {
+                        return rhs;
+                    }
+                    if (is_rhs(1u))
+                    {
+                        return lhs;
+                    }
+                    break;
+
+                case opcode::DIV :
+                    if (is_rhs(1u))
+                    {
+                        return lhs;
+                    }
+                    break;
+
+                case opcode::EQ :
+                    if (lhs == rhs)
+                    {
+                        return constant(1u);
+                    }
+                    break;
+
+                case opcode::LESS_THAN_SIGNED :
+                case opcode::LESS_THAN_UNSIGNED :
+                    if (lhs == rhs)
+                    {
+                        return constant(0u);
+                    }
+                    break;
+
+                default :
+                    break;
+            }
+
+            if (is_commutative(op) && lhs > rhs)
+            {
+                std::swap(lhs, rhs);
+            }
+
+            return intern(
+                ssa_value { value_kind::OPERATION, j1t::vm::op_to_raw(op), lhs, rhs },
+                cost_of(op) + costs[lhs] + costs[rhs]
+            );
+        }
+
+        // symbolically runs block b on its entry phis, as far as they are
+        // resolved, and records what each record sees
+        auto execute_block(uint32_t b) -> void
+        {
+            using j1t::vm::instruction;
+            using j1t::vm::opcode;
+
+            ssa_block &block = blocks[b];
+
+            std::vector<uint32_t> &slots = block.exit;
+            slots.resize(block.slots);
+            for (uint32_t slot = 0; slot < block.slots; ++slot)
+            {
+                slots[slot] = find(block.first_phi + slot);
+            }
+
+            // the stack lives on top of the locals and the memory state
+            std::vector<uint32_t> producers(block.slots - memory_slot - 1u, ENTRY_SLOT);
+
+            holders.clear();
+            for (uint32_t local = 0; local < locals_used; ++local)
+            {
+                holders.try_emplace(slots[local], local);
+            }
+
+            for (uint32_t index = block.first; index < block.end; ++index)
+            {
+                const instruction &record = records[index];
+                record_facts      &seen   = facts[index];
+                seen                      = record_facts {};
+
+                auto push = [&](uint32_t value) -> void
+                {
+                    seen.value = value;
+                    slots.push_back(value);
+                    producers.push_back(index);
+                };
+
+                auto pop = [&](uint8_t count) -> void
+                {
+                    seen.operand_count = count;
+                    for (uint8_t k = count; k-- > 0;)
+                    {
+                        seen.operands[k]  = slots.back();
+                        seen.producers[k] = producers.back();
+                        slots.pop_back();
+                        producers.pop_back();
+                    }
+                };
+
+                auto look_up_holder = [&](uint32_t value) -> void
+                {
+                    auto it = holders.find(value);
+                    if (it != holders.end() && slots[it->second] == value)
+                    {
+                        seen.holder = it->second;
+                    }
+                };
+
+                if (record.op == instruction::OP_END_OF_CODE)
+                {
+                    break;
+                }
+
+                const opcode op = static_cast<opcode>(record.op);
+                switch (op)
+                {
+                    case opcode::PUSH :
+                        push(constant(record.immediate));
+                        break;
+
+                    case opcode::POP :
+                    case opcode::RET :
+                    case opcode::PRINT :
+                        pop(1);
+                        break;
+
+                    case opcode::LOCAL_GET :
+                        push(slots[record.immediate]);
+                        break;
+
+                    case opcode::LOCAL_SET :
+                    {
+                        pop(1);
+                        const uint32_t local = record.immediate;
+                        const uint32_t value = seen.operands[0];
+                        if (slots[local] == value)
+                        {
+                            seen.is_redundant_set = true;
+                            break;
+                        }
+
+                        auto previous = holders.find(slots[local]);
+                        if (previous != holders.end() && previous->second == local)
+                        {
+                            holders.erase(previous);
+                        }
+                        slots[local]    = value;
+                        holders[value] = local;
+                        break;
+                    }
+
+                    case opcode::ADD :
+                    case opcode::SUB :
+                    case opcode::MUL :
+                    case opcode::DIV :
+                    case opcode::EQ :
+                    case opcode::LESS_THAN_SIGNED :
+                    case opcode::LESS_THAN_UNSIGNED :
+                    {
+                        pop(2);
+                        const uint32_t value = binary(op, seen.operands[0], seen.operands[1]);
+                        look_up_holder(value);
+                        push(value);
+                        break;
+                    }
+
+                    case opcode::LOAD_8_UNSIGNED :
+                    case opcode::LOAD_16_UNSIGNED :
+                    case opcode::LOAD_32 :
+                    {
+                        pop(1);
+                        const uint32_t address = seen.operands[0];
+                        const uint32_t value   = intern(
+                            ssa_value { value_kind::OPERATION, record.op, address, slots[memory_slot] },
+                            cost_of(op) + costs[address]
+                        );
+                        look_up_holder(value);
+                        push(value);
+                        break;
+                    }
+
+                    case opcode::STORE_8 :
+                        pop(2);
+                        slots[memory_slot] = intern(ssa_value { value_kind::EFFECT, 0, index, 0 }, 0);
+                        break;
+
+                    case opcode::JUMP_IF_ZERO :
+                    case opcode::JUMP_IF_NOT_ZERO :
+                    {
+                        pop(1);
+                        const uint32_t condition = seen.operands[0];
+                        if (is_constant(condition))
+                        {
+                            const bool is_taken = (values[condition].a != 0u) == (op == opcode::JUMP_IF_NOT_ZERO);
+                            seen.branch         = is_taken ? branch_fold::TAKEN : branch_fold::NOT_TAKEN;
+                        }
+                        break;
+                    }
+
+                    case opcode::READ_8_UNSIGNED :
+                        push(intern(ssa_value { value_kind::EFFECT, 0, index, 0 }, 0));
+                        break;
+
+                    case opcode::NOP :
+                    case opcode::JUMP :
+                    default :
+                        break;
+                }
+            }
+        }
+
+        auto execute_blocks(void) -> void
+        {
+            for (uint32_t b = 0; b < blocks.size(); ++b)
+            {
+                if (blocks[b].is_reachable)
+                {
+                    execute_block(b);
+                }
+            }
+        }
+
+        // successors as far as the last execution decided branches
+        auto successors_of(uint32_t b) const -> std::vector<uint32_t>
+        {
+            using j1t::vm::instruction;
+            using j1t::vm::opcode;
+
+            const ssa_block   &block = blocks[b];
+            const uint32_t     last  = block.end - 1u;
+            const instruction &tail  = records[last];
+
+            if (tail.op == instruction::OP_END_OF_CODE)
+            {
+                return {};
+            }
+
+            const opcode op = static_cast<opcode>(tail.op);
+            switch (op)
+            {
+                case opcode::RET :
+                    return {};
+
+                case opcode::JUMP :
+                    return { block_of[tail.target] };
+
+                case opcode::JUMP_IF_ZERO :
+                case opcode::JUMP_IF_NOT_ZERO :
+                    switch (facts[last].branch)
+                    {
+                        case branch_fold::TAKEN :
+                            return { block_of[tail.target] };
+
+                        case branch_fold::NOT_TAKEN :
+                            return { block_of[block.end] };
+
+                        case branch_fold::UNKNOWN :
+                        default :
+                            return { block_of[tail.target], block_of[block.end] };
+                    }
+
+                default :
+                    return { block_of[block.end] };
+            }
+        }
+
+        // returns whether a folded branch removed an edge
+        auto update_edges(void) -> bool
+        {
+            bool is_changed = false;
+            for (uint32_t b = 0; b < blocks.size(); ++b)
+            {
+                if (blocks[b].is_reachable)
+                {
+                    std::vector<uint32_t> successors = successors_of(b);
+                    is_changed                      |= successors != blocks[b].successors;
+                    blocks[b].successors             = std::move(successors);
+                }
+            }
+
+            std::vector<bool>     is_reachable(blocks.size(), false);
+            std::vector<uint32_t> worklist { 0 };
+            is_reachable[0] = true;
+            while (!worklist.empty())
+            {
+                const uint32_t b = worklist.back();
+                worklist.pop_back();
+                for (uint32_t successor : blocks[b].successors)
+                {
+                    if (!is_reachable[successor])
+                    {
+                        is_reachable[successor] = true;
+                        worklist.push_back(successor);
+                    }
+                }
+            }
+
+            for (ssa_block &block : blocks)
+            {
+                block.predecessors.clear();
+            }
+            for (uint32_t b = 0; b < blocks.size(); ++b)
+            {
+                blocks[b].is_reachable = is_reachable[b];
+                if (is_reachable[b])
+                {
+                    for (uint32_t successor : blocks[b].successors)
+                    {
+                        blocks[successor].predecessors.push_back(b);
+                    }
+                }
+            }
+
+            return is_changed;
+        }
+
+        // replaces every phi whose inputs are all one value (or the phi
+        // itself) by that value; returns whether any went
+        auto remove_trivial_phis(void) -> bool
+        {
+            bool is_any_removed = false;
+            bool is_removed     = true;
+
+            while (is_removed)
+            {
+                is_removed = false;
+                for (uint32_t b = 0; b < blocks.size(); ++b)
+                {
+                    const ssa_block &block = blocks[b];
+                    if (!block.is_reachable)
+                    {
+                        continue;
+                    }
+
+                    for (uint32_t slot = 0; slot < block.slots; ++slot)
+                    {
+                        const uint32_t phi = block.first_phi + slot;
+                        if (find(phi) != phi)
+                        {
+                            continue;
+                        }
+
+                        uint32_t same       = NONE;
+                        bool     is_trivial = true;
+                        auto     merge      = [&](uint32_t incoming) -> void
+                        {
+                            incoming = find(incoming);
+                            if (incoming == phi)
+                            {
+                                return;
+                            }
+                            if (same == NONE)
+                            {
+                                same = incoming;
+                            }
+                            else if (same != incoming)
+                            {
+                                is_trivial = false;
+                            }
+                        };
+
+                        // the run enters the first block once more, from outside
+                        if (b == 0)
+                        {
+                            merge(intern(ssa_value { value_kind::ENTRY, 0, slot, 0 }, 0));
+                        }
+                        for (uint32_t predecessor : block.predecessors)
+                        {
+                            merge(blocks[predecessor].exit[slot]);
+                        }
+
+                        if (is_trivial && same != NONE)
+                        {
+                            parent[phi] = same;
+                            is_removed  = true;
+                        }
+                    }
+                }
+                is_any_removed |= is_removed;
+            }
+
+            return is_any_removed;
+        }
+
+        // Immediate dominators over the CFG plus a virtual root, the last
+        // index, with an edge to the first block; with is_tiered also to every
+        // loop header, since a tiered run can start at any of them. Unreachable
+        // blocks get NONE.
+        auto immediate_dominators(bool is_tiered) -> std::vector<uint32_t>
+        {
+            const uint32_t root = static_cast<uint32_t>(blocks.size());
+
+            std::vector<std::vector<uint32_t>> successors(blocks.size() + 1u);
+            std::vector<std::vector<uint32_t>> predecessors(blocks.size() + 1u);
+            for (uint32_t b = 0; b < blocks.size(); ++b)
+            {
+                if (blocks[b].is_reachable)
+                {
+                    successors[b]   = blocks[b].successors;
+                    predecessors[b] = blocks[b].predecessors;
+                }
+            }
+
+            successors[root].push_back(0);
+            predecessors[0].push_back(root);
+            for (uint32_t b : is_tiered ? entry_blocks() : std::vector<uint32_t> {})
+            {
+                if (b != 0)
+                {
+                    successors[root].push_back(b);
+                    predecessors[b].push_back(root);
+                }
+            }
+
+            // reverse postorder from the root
+            std::vector<uint32_t> postorder;
+            std::vector<uint32_t> order(blocks.size() + 1u, NONE);
+            {
+                std::vector<std::pair<uint32_t, uint32_t>> walk { { root, 0u } };
+                std::vector<bool>                          is_seen(blocks.size() + 1u, false);
+                is_seen[root] = true;
+                while (!walk.empty())
+                {
+                    auto &[b, next] = walk.back();
+                    if (next < successors[b].size())
+                    {
+                        const uint32_t successor = successors[b][next++];
+                        if (!is_seen[successor])
+                        {
+                            is_seen[successor] = true;
+                            walk.emplace_back(successor, 0u);
+                        }
+                        continue;
+                    }
+
+                    order[b] = static_cast<uint32_t>(postorder.size());
+                    postorder.push_back(b);
+                    walk.pop_back();
+                }
+            }
+
+            std::vector<uint32_t> idom(blocks.size() + 1u, NONE);
+            idom[root] = root;
+
+            auto intersect = [&](uint32_t x, uint32_t y) -> uint32_t
+            {
+                while (x != y)
+                {
+                    while (order[x] < order[y])
+                    {
+                        x = idom[x];
+                    }
+                    while (order[y] < order[x])
+                    {
+                        y = idom[y];
+                    }
+                }
+                return x;
+            };
+
+            for (bool is_changed = true; is_changed;)
+            {
+                is_changed = false;
+                for (auto it = postorder.rbegin(); it != postorder.rend(); ++it)
+                {
+                    const uint32_t b = *it;
+                    if (b == root)
+                    {
+                        continue;
+                    }
+
+                    uint32_t candidate = NONE;
+                    for (uint32_t predecessor : predecessors[b])
+                    {
+                        if (idom[predecessor] != NONE)
+                        {
+                            candidate = candidate == NONE ? predecessor : intersect(predecessor, candidate);
+                        }
+                    }
+
+                    if (candidate != idom[b])
+                    {
+                        idom[b]    = candidate;
+                        is_changed = true;
+                    }
+                }
+            }
+
+            return idom;
+        }
+
+        // the dominator tree of immediate_dominators(true): a value may only
+        // be reused where every start of a run passes its computation
+        auto dominator_children(void) -> std::vector<std::vector<uint32_t>>
+        {
+            const std::vector<uint32_t> idom = immediate_dominators(true);
+
+            std::vector<std::vector<uint32_t>> children(blocks.size() + 1u);
+            for (uint32_t b = 0; b < blocks.size(); ++b)
+            {
+                if (idom[b] != NONE)
+                {
+                    children[idom[b]].push_back(b);
+                }
+            }
+            return children;
+        }
+
+        // reachable blocks starting at a loop header, ascending
+        auto entry_blocks(void) const -> std::vector<uint32_t>
+        {
+            std::vector<uint32_t> entries;
+            for (uint32_t pc : headers)
+            {
+                const uint32_t index = record_at(pc);
+                if (index != NONE && block_of[index] != NONE && blocks[block_of[index]].first == index
+                    && blocks[block_of[index]].is_reachable)
+                {
+                    entries.push_back(block_of[index]);
+                }
+            }
+            return entries;
+        }
+
+        auto record_at(uint32_t pc) const -> uint32_t
+        {
+            auto it = std::lower_bound(
+                records.begin(),
+                records.end(),
+                pc,
+                [](const j1t::vm::instruction &record, uint32_t key) -> bool { return record.pc < key; }
+            );
+            return it != records.end() && it->pc == pc ? static_cast<uint32_t>(it - records.begin()) : NONE;
+        }
+
+        // global value numbering: walks the dominator tree with the values
+        // computed on the way down, and marks recomputations of them that
+        // are worth a temporary
+        auto number_values(void) -> void
+        {
+            using j1t::vm::opcode;
+
+            reused_from.assign(records.size(), NONE);
+            is_reused.assign(records.size(), false);
+
+            const std::vector<std::vector<uint32_t>> children = dominator_children();
+
+            std::unordered_map<uint32_t, uint32_t>     available;
+            std::vector<uint32_t>                      scoped;
+            std::vector<std::pair<uint32_t, uint32_t>> walk { { static_cast<uint32_t>(blocks.size()), 0u } };
+            std::vector<std::size_t>                   scope_marks { 0u };
+
+            while (!walk.empty())
+            {
+                auto &[b, next] = walk.back();
+                if (next < children[b].size())
+                {
+                    const uint32_t child = children[b][next++];
+                    scope_marks.push_back(scoped.size());
+                    walk.emplace_back(child, 0u);
+                    visit_block(child, available, scoped);
+                    continue;
+                }
+
+                while (scoped.size() > scope_marks.back())
+                {
+                    available.erase(scoped.back());
+                    scoped.pop_back();
+                }
+                scope_marks.pop_back();
+                walk.pop_back();
+            }
+        }
+
+        auto visit_block(uint32_t b, std::unordered_map<uint32_t, uint32_t> &available, std::vector<uint32_t> &scoped) -> void
+        {
+            using j1t::vm::instruction;
+            using j1t::vm::opcode;
+
+            for (uint32_t index = blocks[b].first; index < blocks[b].end; ++index)
+            {
+                const uint8_t raw = records[index].op;
+                if (raw == instruction::OP_END_OF_CODE || !is_reusable(static_cast<opcode>(raw)))
+                {
+                    continue;
+                }
+
+                const uint32_t value = find(facts[index].value);
+                if (is_constant(value))
+                {
+                    continue;
+                }
+
+                auto [it, is_new] = available.try_emplace(value, index);
+                if (is_new)
+                {
+                    scoped.push_back(value);
+                    continue;
+                }
+
+                const uint32_t leader = it->second;
+                if (facts[index].holder != NONE || costs[value] < MIN_REUSE_COST)
+                {
+                    continue;
+                }
+
+                if (!is_reused[leader])
+                {
+                    if (reused_leaders == MAX_TEMPORARIES)
+                    {
+                        continue;
+                    }
+                    is_reused[leader] = true;
+                    ++reused_leaders;
+                }
+                reused_from[index] = leader;
+            }
+        }
+
+        // natural loops over the CFG, each loop before the loops inside it
+        auto find_loops(void) -> void
+        {
+            const uint32_t              root = static_cast<uint32_t>(blocks.size());
+            const std::vector<uint32_t> idom = immediate_dominators(false);
+
+            auto dominates = [&](uint32_t dominator, uint32_t b) -> bool
+            {
+                for (; b != root; b = idom[b])
+                {
+                    if (b == dominator)
+                    {
+                        return true;
+                    }
+                }
+                return false;
+            };
+
+            std::vector<std::pair<uint32_t, std::vector<uint32_t>>> found;
+            std::vector<uint32_t>                                   mark(blocks.size(), NONE);
+            for (uint32_t header = 0; header < blocks.size(); ++header)
+            {
+                if (!blocks[header].is_reachable)
+                {
+                    continue;
+                }
+
+                std::vector<uint32_t> body { header };
+                std::vector<uint32_t> worklist;
+                bool                  is_loop = false;
+                mark[header]                  = header;
+
+                auto add = [&](uint32_t b) -> void
+                {
+                    if (mark[b] != header)
+                    {
+                        mark[b] = header;
+                        body.push_back(b);
+                        worklist.push_back(b);
+                    }
+                };
+
+                for (uint32_t predecessor : blocks[header].predecessors)
+                {
+                    if (dominates(header, predecessor))
+                    {
+                        is_loop = true;
+                        add(predecessor);
+                    }
+                }
+                while (!worklist.empty())
+                {
+                    const uint32_t b = worklist.back();
+                    worklist.pop_back();
+                    for (uint32_t predecessor : blocks[b].predecessors)
+                    {
+                        add(predecessor);
+                    }
+                }
+
+                if (is_loop)
+                {
+                    found.emplace_back(header, std::move(body));
+                }
+            }
+
+            // loops with different headers are nested or disjoint, and an
+            // inner loop is smaller than the loops around it
+            std::stable_sort(
+                found.begin(),
+                found.end(),
+                [](const auto &lhs, const auto &rhs) -> bool { return lhs.second.size() > rhs.second.size(); }
+            );
+
+            innermost.assign(blocks.size(), NONE);
+            loop_of.assign(blocks.size(), NONE);
+            for (const auto &[header, body] : found)
+            {
+                const uint32_t loop  = static_cast<uint32_t>(loops.size());
+                natural_loop  &added = loops.emplace_back();
+                added.header         = header;
+                added.parent         = innermost[header];
+                loop_of[header]      = loop;
+                for (uint32_t b : body)
+                {
+                    innermost[b] = loop;
+                }
+            }
+
+            for (uint32_t b : entry_blocks())
+            {
+                for (uint32_t loop = innermost[b]; loop != NONE; loop = loops[loop].parent)
+                {
+                    loops[loop].entries.push_back(b);
+                }
+            }
+        }
+
+        auto is_in_loop(uint32_t b, uint32_t loop) const -> bool
+        {
+            for (uint32_t l = innermost[b]; l != NONE; l = loops[l].parent)
+            {
+                if (l == loop)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        auto has_invariants(uint32_t loop) const -> bool
+        {
+            return loop != NONE && !loops[loop].invariants.empty();
+        }
+
+        // Moves computations that give the same value on every iteration of
+        // a loop in front of the outermost such loop: its preheader computes
+        // them into temporaries from the locals and constants at the header,
+        // and the loop reloads them. Only what cannot trap is moved, since
+        // the preheader runs it whether or not the loop would have.
+        auto hoist_invariants(void) -> void
+        {
+            using j1t::vm::instruction;
+            using j1t::vm::opcode;
+
+            hoisted_into.assign(records.size(), NONE);
+            find_loops();
+
+            uint32_t              available = MAX_TEMPORARIES - reused_leaders;
+            std::vector<uint32_t> nest;
+            for (uint32_t b = 0; b < blocks.size(); ++b)
+            {
+                if (!blocks[b].is_reachable || innermost[b] == NONE)
+                {
+                    continue;
+                }
+
+                // outermost last
+                nest.clear();
+                for (uint32_t loop = innermost[b]; loop != NONE; loop = loops[loop].parent)
+                {
+                    nest.push_back(loop);
+                }
+
+                for (uint32_t index = blocks[b].first; index < blocks[b].end; ++index)
+                {
+                    // loads may trap
+                    const uint8_t raw = records[index].op;
+                    if (raw == instruction::OP_END_OF_CODE || !is_reusable(static_cast<opcode>(raw))
+                        || is_load(static_cast<opcode>(raw)))
+                    {
+                        continue;
+                    }
+
+                    const uint32_t value = find(facts[index].value);
+                    if (is_constant(value) || facts[index].holder != NONE || costs[value] < MIN_REUSE_COST)
+                    {
+                        continue;
+                    }
+
+                    for (auto it = nest.rbegin(); it != nest.rend(); ++it)
+                    {
+                        if (!is_hoistable(value, *it))
+                        {
+                            continue;
+                        }
+
+                        if (!invariant_temporary.contains(value))
+                        {
+                            if (available == 0u)
+                            {
+                                break;
+                            }
+                            --available;
+                            invariant_temporary.emplace(value, NONE);
+                        }
+                        hoisted_into[index] = *it;
+                        break;
+                    }
+                }
+            }
+        }
+
+        // whether value can be rebuilt in front of loop, and wherever a tiered
+        // run starts inside it
+        auto is_hoistable(uint32_t value, uint32_t loop) -> bool
+        {
+            uint32_t ops = MAX_HOISTED_OPS;
+            if (!is_invariant(value, loop, ops))
+            {
+                return false;
+            }
+
+            ops = MAX_HOISTED_OPS;
+            if (!is_rebuildable(value, loops[loop].header, ops))
+            {
+                return false;
+            }
+
+            for (uint32_t entry : loops[loop].entries)
+            {
+                ops = MAX_HOISTED_OPS;
+                if (!is_rebuildable(value, entry, ops))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // whether v depends on no phi or effect inside loop; gives up after
+        // ops operations
+        auto is_invariant(uint32_t v, uint32_t loop, uint32_t &ops) -> bool
+        {
+            const ssa_value &key = values[find(v)];
+            switch (key.kind)
+            {
+                case value_kind::CONSTANT :
+                case value_kind::ENTRY :
+                    return true;
+
+                case value_kind::PHI :
+                    return !is_in_loop(key.a, loop);
+
+                case value_kind::EFFECT :
+                    return !is_in_loop(block_of[key.a], loop);
+
+                case value_kind::OPERATION :
+                default :
+                    if (ops == 0u)
+                    {
+                        return false;
+                    }
+                    --ops;
+                    return is_invariant(key.a, loop, ops) && is_invariant(key.b, loop, ops);
+            }
+        }
+
+        // whether v can be computed from the constants and the locals on entry
+        // to block b without trapping; gives up after ops operations
+        auto is_rebuildable(uint32_t v, uint32_t b, uint32_t &ops) -> bool
+        {
+            using j1t::vm::opcode;
+
+            v                    = find(v);
+            const ssa_value &key = values[v];
+            if (key.kind == value_kind::CONSTANT || local_holding(b, v) != NONE)
+            {
+                return true;
+            }
+            if (key.kind != value_kind::OPERATION || ops == 0u)
+            {
+                return false;
+            }
+            --ops;
+
+            const opcode op = static_cast<opcode>(key.op);
+            if (is_load(op))
+            {
+                return false;
+            }
+            if (op == opcode::DIV && !(is_constant(find(key.b)) && values[find(key.b)].a != 0u))
+            {
+                return false;
+            }
+            return is_rebuildable(key.a, b, ops) && is_rebuildable(key.b, b, ops);
+        }
+
+        // emits what is_rebuildable() found, leaving v on the stack
+        auto emit_rebuilt(uint32_t v, uint32_t b, j1t::vm::assembler &out) -> void
+        {
+            v                    = find(v);
+            const ssa_value key  = values[v];
+            const uint32_t local = local_holding(b, v);
+            if (key.kind == value_kind::CONSTANT)
+            {
+                out.emit_push_u32(key.a);
+            }
+            else if (local != NONE)
+            {
+                out.emit_local_get(local);
+            }
+            else
+            {
+                emit_rebuilt(key.a, b, out);
+                emit_rebuilt(key.b, b, out);
+                out.emit_op(static_cast<j1t::vm::opcode>(key.op));
+            }
+        }
+
+        // computes the invariants of loop from the state on entry to block b
+        auto emit_invariants(const natural_loop &loop, uint32_t b, j1t::vm::assembler &out) -> void
+        {
+            for (uint32_t value : loop.invariants)
+            {
+                emit_rebuilt(value, b, out);
+                out.emit_local_set(invariant_temporary.at(value));
+            }
+        }
+
+        // the lowest local holding v on entry to block b, or NONE
+        auto local_holding(uint32_t b, uint32_t v) -> uint32_t
+        {
+            auto [it, is_new] = entry_holders.try_emplace(b);
+            if (is_new)
+            {
+                for (uint32_t local = locals_used; local-- > 0u;)
+                {
+                    it->second[find(blocks[b].first_phi + local)] = local;
+                }
+            }
+
+            auto found = it->second.find(v);
+            return found != it->second.end() ? found->second : NONE;
+        }
+
+        auto lower(j1t::vm::optimized_program &output) -> void
+        {
+            using j1t::vm::assembler;
+
+            assembler out {};
+
+            std::vector<assembler::label> labels;
+            labels.reserve(blocks.size());
+            for (uint32_t b = 0; b < blocks.size(); ++b)
+            {
+                labels.push_back(out.create_label());
+            }
+
+            consumer.assign(records.size(), NONE);
+            kind.assign(records.size(), emission::ORIGINAL);
+            uses_operands.assign(records.size(), false);
+            is_emitted.assign(records.size(), false);
+            is_needed.assign(records.size(), false);
+            is_present.assign(records.size(), false);
+
+            // a computation needs a temporary only when one of its reloads is
+            // emitted, and storing it keeps its operands, which may hold more
+            // reloads; plan until that settles
+            temporary_of.assign(records.size(), NONE);
+            for (bool is_changed = true; is_changed;)
+            {
+                is_changed = false;
+                for (const ssa_block &block : blocks)
+                {
+                    if (block.is_reachable)
+                    {
+                        plan_block(block);
+                    }
+                }
+
+                for (const ssa_block &block : blocks)
+                {
+                    for (uint32_t index = block.first; block.is_reachable && index < block.end; ++index)
+                    {
+                        if (is_emitted[index] && kind[index] == emission::TEMPORARY && temporary_of[reused_from[index]] == NONE)
+                        {
+                            temporary_of[reused_from[index]] = 0u;
+                            is_changed                       = true;
+                        }
+                    }
+                }
+            }
+
+            for (uint32_t index = 0; index < records.size(); ++index)
+            {
+                if (temporary_of[index] != NONE)
+                {
+                    temporary_of[index] = locals_used + temporaries++;
+                }
+            }
+
+            // a loop computes only the invariants it still reloads
+            for (uint32_t index = 0; index < records.size(); ++index)
+            {
+                if (!is_emitted[index] || kind[index] != emission::INVARIANT)
+                {
+                    continue;
+                }
+
+                const uint32_t         value      = find(facts[index].value);
+                uint32_t              &temporary  = invariant_temporary.at(value);
+                std::vector<uint32_t> &invariants = loops[hoisted_into[index]].invariants;
+                if (temporary == NONE)
+                {
+                    temporary = locals_used + temporaries++;
+                }
+                if (std::find(invariants.begin(), invariants.end(), value) == invariants.end())
+                {
+                    invariants.push_back(value);
+                }
+            }
+
+            std::vector<assembler::label> preheaders;
+            preheaders.reserve(loops.size());
+            for (uint32_t loop = 0; loop < loops.size(); ++loop)
+            {
+                preheaders.push_back(out.create_label());
+            }
+
+            // a tiered run starting inside loops with invariants computes them
+            // first, in stubs placed up front where nothing falls into them
+            const std::vector<uint32_t>   entries = entry_blocks();
+            std::vector<assembler::label> starts;
+            std::vector<uint32_t>         stubbed;
+            for (uint32_t b : entries)
+            {
+                bool is_stubbed = false;
+                for (uint32_t loop = innermost[b]; loop != NONE; loop = loops[loop].parent)
+                {
+                    is_stubbed |= has_invariants(loop);
+                }
+
+                starts.push_back(is_stubbed ? out.create_label() : labels[b]);
+                if (is_stubbed)
+                {
+                    stubbed.push_back(static_cast<uint32_t>(starts.size() - 1u));
+                }
+            }
+
+            if (!stubbed.empty())
+            {
+                const assembler::label start = out.create_label();
+                out.emit_jump(start);
+                for (uint32_t k : stubbed)
+                {
+                    std::vector<uint32_t> nest;
+                    for (uint32_t loop = innermost[entries[k]]; loop != NONE; loop = loops[loop].parent)
+                    {
+                        nest.push_back(loop);
+                    }
+
+                    out.bind_label(starts[k]);
+                    for (auto it = nest.rbegin(); it != nest.rend(); ++it)
+                    {
+                        emit_invariants(loops[*it], entries[k], out);
+                    }
+                    out.emit_jump(labels[entries[k]]);
+                }
+                out.bind_label(start);
+            }
+
+            for (uint32_t b = 0; b < blocks.size(); ++b)
+            {
+                if (!blocks[b].is_reachable)
+                {
+                    continue;
+                }
+
+                if (has_invariants(loop_of[b]))
+                {
+                    out.bind_label(preheaders[loop_of[b]]);
+                    emit_invariants(loops[loop_of[b]], b, out);
+                }
+                out.bind_label(labels[b]);
+                emit_block(b, out, labels, preheaders);
+            }
+
+            out.finalize();
+
+            for (uint32_t k = 0; k < entries.size(); ++k)
+            {
+                output.loop_entries.push_back(
+                    j1t::vm::optimized_program::loop_entry {
+                        .original_pc = records[blocks[entries[k]].first].pc,
+                        .pc          = out.label_states[starts[k].id].pc,
+                    }
+                );
+            }
+
+            output.lowered         = j1t::vm::program { std::move(out.code) };
+            output.first_temporary = locals_used;
+            output.locals_used     = locals_used + temporaries;
+            output.is_optimized    = true;
+        }
+
+        // decides per record what is emitted, last to first: a value is
+        // needed when its consumer is emitted as is, or when it is still on
+        // the stack at the end of the block
+        auto plan_block(const ssa_block &block) -> void
+        {
+            using j1t::vm::instruction;
+            using j1t::vm::opcode;
+
+            for (uint32_t index = block.first; index < block.end; ++index)
+            {
+                const record_facts &seen = facts[index];
+                for (uint8_t k = 0; k < seen.operand_count; ++k)
+                {
+                    if (seen.producers[k] != ENTRY_SLOT)
+                    {
+                        consumer[seen.producers[k]] = index;
+                    }
+                }
+            }
+
+            for (uint32_t index = block.end; index-- > block.first;)
+            {
+                const uint8_t       raw  = records[index].op;
+                const record_facts &seen = facts[index];
+                if (raw == instruction::OP_END_OF_CODE)
+                {
+                    continue;
+                }
+
+                const opcode op = static_cast<opcode>(raw);
+                if (seen.value == NONE)
+                {
+                    switch (op)
+                    {
+                        case opcode::LOCAL_SET :
+                            uses_operands[index] = !seen.is_redundant_set;
+                            break;
+
+                        case opcode::STORE_8 :
+                        case opcode::PRINT :
+                        case opcode::RET :
+                            uses_operands[index] = true;
+                            break;
+
+                        case opcode::JUMP_IF_ZERO :
+                        case opcode::JUMP_IF_NOT_ZERO :
+                            uses_operands[index] = seen.branch == branch_fold::UNKNOWN;
+                            break;
+
+                        default :
+                            uses_operands[index] = false;
+                            break;
+                    }
+                    continue;
+                }
+
+                const uint32_t value = find(seen.value);
+                if (op == opcode::PUSH || op == opcode::READ_8_UNSIGNED)
+                {
+                    kind[index] = emission::ORIGINAL;
+                }
+                else if (is_constant(value))
+                {
+                    kind[index] = emission::CONSTANT;
+                }
+                else if (op == opcode::LOCAL_GET || is_compare(op))
+                {
+                    // a compare stays next to the jump the backends fuse it with
+                    kind[index] = emission::ORIGINAL;
+                }
+                else if (seen.holder != NONE)
+                {
+                    kind[index] = emission::LOCAL;
+                }
+                else if (hoisted_into[index] != NONE)
+                {
+                    kind[index] = emission::INVARIANT;
+                }
+                else if (reused_from[index] != NONE)
+                {
+                    kind[index] = emission::TEMPORARY;
+                }
+                else
+                {
+                    kind[index] = emission::ORIGINAL;
+                }
+
+                // whatever is not computed as written cannot fail either: an
+                // identical computation has already succeeded
+                bool is_pure = kind[index] != emission::ORIGINAL;
+                switch (op)
+                {
+                    case opcode::PUSH :
+                    case opcode::LOCAL_GET :
+                    case opcode::ADD :
+                    case opcode::SUB :
+                    case opcode::MUL :
+                    case opcode::EQ :
+                    case opcode::LESS_THAN_SIGNED :
+                    case opcode::LESS_THAN_UNSIGNED :
+                        is_pure = true;
+                        break;
+
+                    case opcode::DIV :
+                        is_pure |= is_constant(find(seen.operands[1])) && values[find(seen.operands[1])].a != 0u;
+                        break;
+
+                    default :
+                        break;
+                }
+
+                const uint32_t user  = consumer[index];
+                is_needed[index]     = user == NONE || uses_operands[user];
+                is_emitted[index]    = is_needed[index] || !is_pure || temporary_of[index] != NONE;
+                is_present[index]    = is_emitted[index] && (is_needed[index] || temporary_of[index] == NONE);
+                uses_operands[index] = is_emitted[index] && kind[index] == emission::ORIGINAL;
+            }
+        }
+
+        auto emit_block(
+            uint32_t                                       b,
+            j1t::vm::assembler                            &out,
+            const std::vector<j1t::vm::assembler::label> &labels,
+            const std::vector<j1t::vm::assembler::label> &preheaders
+        ) -> void
+        {
+            using j1t::vm::instruction;
+            using j1t::vm::opcode;
+
+            const ssa_block &block = blocks[b];
+
+            // entering a loop from outside runs its preheader
+            auto edge_to = [&](uint32_t target) -> j1t::vm::assembler::label
+            {
+                const uint32_t loop = loop_of[target];
+                return has_invariants(loop) && !is_in_loop(b, loop) ? preheaders[loop] : labels[target];
+            };
+
+            for (uint32_t index = block.first; index < block.end; ++index)
+            {
+                const instruction  &record = records[index];
+                const record_facts &seen   = facts[index];
+                if (record.op == instruction::OP_END_OF_CODE)
+                {
+                    continue;
+                }
+
+                // operands left on the stack that nothing needs anymore
+                if (!uses_operands[index])
+                {
+                    for (uint8_t k = 0; k < seen.operand_count; ++k)
+                    {
+                        if (seen.producers[k] == ENTRY_SLOT || is_present[seen.producers[k]])
+                        {
+                            out.emit_op(opcode::POP);
+                        }
+                    }
+                }
+
+                const opcode op = static_cast<opcode>(record.op);
+                if (seen.value != NONE)
+                {
+                    if (!is_emitted[index])
+                    {
+                        continue;
+                    }
+
+                    switch (kind[index])
+                    {
+                        case emission::CONSTANT :
+                            out.emit_push_u32(values[find(seen.value)].a);
+                            break;
+
+                        case emission::LOCAL :
+                            out.emit_local_get(seen.holder);
+                            break;
+
+                        case emission::TEMPORARY :
+                            out.emit_local_get(temporary_of[reused_from[index]]);
+                            break;
+
+                        case emission::INVARIANT :
+                            out.emit_local_get(invariant_temporary.at(find(seen.value)));
+                            break;
+
+                        case emission::ORIGINAL :
+                        default :
+                            emit_record(record, out);
+                            break;
+                    }
+
+                    if (temporary_of[index] != NONE)
+                    {
+                        out.emit_local_set(temporary_of[index]);
+                        if (is_needed[index])
+                        {
+                            out.emit_local_get(temporary_of[index]);
+                        }
+                    }
+                    continue;
+                }
+
+                switch (op)
+                {
+                    case opcode::LOCAL_SET :
+                        if (!seen.is_redundant_set)
+                        {
+                            out.emit_local_set(record.immediate);
+                        }
+                        break;
+
+                    case opcode::STORE_8 :
+                    case opcode::PRINT :
+                    case opcode::RET :
+                        out.emit_op(op);
+                        break;
+
+                    case opcode::JUMP :
+                        out.emit_jump(edge_to(block_of[record.target]));
+                        break;
+
+                    case opcode::JUMP_IF_ZERO :
+                    case opcode::JUMP_IF_NOT_ZERO :
+                        if (seen.branch == branch_fold::TAKEN)
+                        {
+                            out.emit_jump(edge_to(block_of[record.target]));
+                        }
+                        else if (seen.branch == branch_fold::UNKNOWN && op == opcode::JUMP_IF_ZERO)
+                        {
+                            out.emit_jump_if_zero(edge_to(block_of[record.target]));
+                        }
+                        else if (seen.branch == branch_fold::UNKNOWN)
+                        {
+                            out.emit_jump_if_not_zero(edge_to(block_of[record.target]));
+                        }
+                        break;
+
+                    case opcode::NOP :
+                    case opcode::POP :
+                    default :
+                        break;
+                }
+            }
+
+            // a back edge falling into its header skips the preheader between
+            const uint32_t next = block.end < records.size() ? block_of[block.end] : NONE;
+            if (next != NONE && has_invariants(loop_of[next]) && is_in_loop(b, loop_of[next]) && is_falling_through(b, next))
+            {
+                out.emit_jump(labels[next]);
+            }
+        }
+
+        auto is_falling_through(uint32_t b, uint32_t next) const -> bool
+        {
+            using j1t::vm::opcode;
+
+            const ssa_block &block      = blocks[b];
+            const uint32_t   last       = block.end - 1u;
+            const bool       is_jumping = records[last].op == j1t::vm::op_to_raw(opcode::JUMP)
+                                  || facts[last].branch == branch_fold::TAKEN;
+
+            return !is_jumping && std::find(block.successors.begin(), block.successors.end(), next) != block.successors.end();
+        }
+
+        static auto emit_record(const j1t::vm::instruction &record, j1t::vm::assembler &out) -> void
+        {
+            using j1t::vm::opcode;
+
+            const opcode op = static_cast<opcode>(record.op);
+            switch (op)
+            {
+                case opcode::PUSH :
+                    out.emit_push_u32(record.immediate);
+                    break;
+
+                case opcode::LOCAL_GET :
+                    out.emit_local_get(record.immediate);
+                    break;
+
+                default :
+                    out.emit_op(op);
+                    break;
+            }
+        }
+
+      private:
+        const std::vector<j1t::vm::instruction> &records;
+        const std::vector<uint32_t>             &depths;
+        const uint32_t                           locals_used;
+        // index of the memory state among a block's slots
+        const uint32_t                           memory_slot;
+        const std::vector<uint32_t>              headers;
+
+        std::vector<ssa_block> blocks;
+        std::vector<uint32_t>  block_of;
+
+        std::vector<ssa_value>                                     values;
+        std::vector<uint32_t>                                      parent;
+        std::vector<uint8_t>                                       costs;
+        std::unordered_map<ssa_value, uint32_t, ssa_value_hash>    interned;
+        std::unordered_map<uint32_t, uint32_t>                     holders;
+        std::vector<record_facts>                                  facts;
+
+        // per record: the dominating computation it reloads, whether it is
+        // such a computation, and the temporary it stores its value in
+        std::vector<uint32_t> reused_from;
+        std::vector<bool>     is_reused;
+        uint32_t              reused_leaders { 0 };
+        std::vector<uint32_t> temporary_of;
+        uint32_t              temporaries { 0 };
+
+        std::vector<natural_loop> loops;
+        // per block: the innermost loop containing it, and the loop it heads
+        std::vector<uint32_t>     innermost;
+        std::vector<uint32_t>     loop_of;
+        // per record: the loop in front of which its value is computed
+        std::vector<uint32_t>     hoisted_into;
+
+        // invariant value to its temporary, NONE until a reload is emitted
+        std::unordered_map<uint32_t, uint32_t>                               invariant_temporary;
+        // per block: value to the lowest local holding it on entry
+        std::unordered_map<uint32_t, std::unordered_map<uint32_t, uint32_t>> entry_holders;
+
+        std::vector<uint32_t> consumer;
+        std::vector<emission> kind;
+        std::vector<bool>     uses_operands;
+        std::vector<bool>     is_emitted;
+        std::vector<bool>     is_needed;
+        // emitted and left on the stack for the consumer
+        std::vector<bool>     is_present;
+    };
+}
+
+namespace j1t::vm
+{
+    auto optimized_program::entry_pc(uint32_t original_pc) const -> std::optional<uint32_t>
+    {
+        auto it = std::lower_bound(
+            loop_entries.begin(),
+            loop_entries.end(),
+            original_pc,
+            [](const loop_entry &entry, uint32_t key) -> bool { return entry.original_pc < key; }
+        );
+        if (it == loop_entries.end() || it->original_pc != original_pc)
+        {
+            return std::nullopt;
+        }
+        return it->pc;
+    }
+
+    auto optimize(const program &target_program) -> optimized_program
+    {
+        // fused superinstructions would only get in the way here
+        const decoded_program decoded = decode(target_program);
+        const verification    facts   = verify(decoded);
+
+        optimized_program optimized {};
+        if (!facts.is_verified || facts.locals_used > MAX_OPTIMIZED_LOCALS
+            || !ssa_optimizer { decoded, facts }.run(optimized))
+        {
+            return optimized_program {};
+        }
+
+        return optimized;
+    }
+
+    auto program::optimized(void) const -> std::shared_ptr<const optimized_program>
+    {
+        return optimized_cache.get_or_create(
+            [this]()
+            {
+                return optimize(*this);
+            }
+        );
+    }
+}
@@ -0,0 +1,95 @@
+#include <vm/opcodes.hpp>
+#include <vm/profiler.hpp>
+
+#include <algorithm>
+
+namespace
+{
+    // length in the top byte, ops in the low bytes
+    auto pack(const uint8_t *ops, uint32_t length) -> uint64_t
+    {
+        uint64_t key = static_cast<uint64_t>(length) << 56;
+        for (uint32_t i = 0; i < length; ++i)
+        {
+            key |= static_cast<uint64_t>(ops[i]) << (8u * i);
+        }
+        return key;
+    }
+}
+
+namespace j1t::vm
+{
+    auto ngram_profiler::record(uint32_t opcode_pc, uint8_t raw_opcode) -> void
+    {
+        if (opcode_pc != next_pc_internal)
+        {
+            window_length_internal = 0;
+        }
+
+        if (window_length_internal == MAX_LENGTH)
+        {
+            std::copy(window_internal.begin() + 1, window_internal.end(), window_internal.begin());
+            window_length_internal -= 1u;
+        }
+        window_internal[window_length_internal++] = raw_opcode;
+
+        for (uint32_t length = 2; length <= window_length_internal; ++length)
+        {
+            counts_internal[pack(window_internal.data() + window_length_internal - length, length)] += 1u;
+        }
+
+        next_pc_internal = opcode_pc + 1u;
+        if (is_valid_opcode(raw_opcode))
+        {
+            next_pc_internal += immediate_size(static_cast<opcode>(raw_opcode));
+        }
+    }
+
+    auto ngram_profiler::top(std::size_t count) const -> std::vector<ngram>
+    {
+        std::vector<ngram> result;
+        result.reserve(counts_internal.size());
+
+        for (const auto &[key, hits] : counts_internal)
+        {
+            ngram entry {};
+            entry.length = static_cast<uint32_t>(key >> 56);
+            entry.count  = hits;
+            for (uint32_t i = 0; i < entry.length; ++i)
+            {
+                entry.ops[i] = static_cast<uint8_t>(key >> (8u * i));
+            }
+            result.push_back(entry);
+        }
+
+        std::sort(
+            result.begin(),
+            result.end(),
+            [](const ngram &lhs, const ngram &rhs)
+            {
+                if (lhs.count != rhs.count)
+                {
+                    return lhs.count > rhs.count;
+                }
+                if (lhs.length != rhs.length)
+                {
+                    return lhs.length > rhs.length;
+                }
+                return lhs.ops < rhs.ops;
+            }
+        );
+
+        if (result.size() > count)
+        {
+            result.resize(count);
+        }
+        return result;
+    }
+
+    auto ngram_profiler::reset(void) -> void
+    {
+        counts_internal.clear();
+        window_length_internal = 0;
+        next_pc_internal       = 0;
+    }
+}
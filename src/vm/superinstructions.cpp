@@ -0,0 +1,61 @@
+#include <vm/superinstructions.hpp>
+
+namespace
+{
+    auto matches(
+        const std::vector<j1t::vm::instruction> &instructions,
+        std::size_t                              index,
+        const j1t::vm::superinstruction         &candidate
+    ) -> bool
+    {
+        if (index + candidate.length > instructions.size())
+        {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < candidate.length; ++i)
+        {
+            if (instructions[index + i].op != j1t::vm::op_to_raw(candidate.pattern[i]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+namespace j1t::vm
+{
+    auto fuse_superinstructions(decoded_program &decoded) -> uint32_t
+    {
+        std::vector<instruction> &instructions = decoded.instructions;
+        uint32_t                  fused_count  = 0;
+
+        std::size_t index = 0;
+        while (index < instructions.size())
+        {
+            const superinstruction *selected = nullptr;
+            for (const superinstruction &candidate : SUPERINSTRUCTIONS)
+            {
+                if (matches(instructions, index, candidate))
+                {
+                    selected = &candidate;
+                    break;
+                }
+            }
+
+            if (selected == nullptr)
+            {
+                index += 1u;
+                continue;
+            }
+
+            instructions[index].op = selected->op;
+            fused_count += 1u;
+            index += selected->length;
+        }
+
+        return fused_count;
+    }
+}
@@ -0,0 +1,462 @@
+#include <vm/decoder.hpp>
+#include <vm/interpreter.hpp>
+#include <vm/translator.hpp>
+#include <vm/verifier.hpp>
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace
+{
+    constexpr uint32_t UNREACHED { j1t::vm::verification::UNREACHABLE };
+    constexpr uint32_t NO_LABEL { 0xFFFF'FFFFu };
+
+    // locals live in the register file; larger indices stay on the stack VM
+    constexpr uint32_t MAX_TRANSLATED_LOCALS { 1u << 16 };
+
+    auto produces_value(j1t::vm::register_op op) -> bool
+    {
+        using j1t::vm::register_op;
+
+        return op <= register_op::LOAD_32 || op == register_op::READ_8_UNSIGNED;
+    }
+
+    auto is_compare(j1t::vm::register_op op) -> bool
+    {
+        using j1t::vm::register_op;
+
+        return op == register_op::EQ || op == register_op::LESS_THAN_SIGNED || op == register_op::LESS_THAN_UNSIGNED;
+    }
+
+    // compare feeding JUMP_IF_NOT_ZERO (or, negated, JUMP_IF_ZERO)
+    auto fused_branch(j1t::vm::register_op compare, bool jump_if_zero) -> j1t::vm::register_op
+    {
+        using j1t::vm::register_op;
+
+        switch (compare)
+        {
+            case register_op::EQ :
+                return jump_if_zero ? register_op::JUMP_IF_NOT_EQ : register_op::JUMP_IF_EQ;
+
+            case register_op::LESS_THAN_SIGNED :
+                return jump_if_zero ? register_op::JUMP_IF_GREATER_EQUAL_SIGNED : register_op::JUMP_IF_LESS_THAN_SIGNED;
+
+            case register_op::LESS_THAN_UNSIGNED :
+            default :
+                return jump_if_zero ? register_op::JUMP_IF_GREATER_EQUAL_UNSIGNED : register_op::JUMP_IF_LESS_THAN_UNSIGNED;
+        }
+    }
+
+    auto binary_op(j1t::vm::opcode op) -> j1t::vm::register_op
+    {
+        using j1t::vm::opcode;
+        using j1t::vm::register_op;
+
+        switch (op)
+        {
+            case opcode::ADD :
+                return register_op::ADD;
+            case opcode::SUB :
+                return register_op::SUB;
+            case opcode::MUL :
+                return register_op::MUL;
+            case opcode::DIV :
+                return register_op::DIV;
+            case opcode::EQ :
+                return register_op::EQ;
+            case opcode::LESS_THAN_SIGNED :
+                return register_op::LESS_THAN_SIGNED;
+            case opcode::LESS_THAN_UNSIGNED :
+                return register_op::LESS_THAN_UNSIGNED;
+            case opcode::LOAD_8_UNSIGNED :
+                return register_op::LOAD_8_UNSIGNED;
+            case opcode::LOAD_16_UNSIGNED :
+                return register_op::LOAD_16_UNSIGNED;
+            case opcode::LOAD_32 :
+            default :
+                return register_op::LOAD_32;
+        }
+    }
+
+    auto fail_with(j1t::vm::interpreter::error error_value) -> j1t::vm::register_instruction
+    {
+        j1t::vm::register_instruction failure {};
+        failure.op = j1t::vm::register_op::FAIL;
+        failure.a  = static_cast<uint32_t>(error_value);
+        return failure;
+    }
+
+    class register_emitter
+    {
+      public:
+        register_emitter(const j1t::vm::decoded_program &decoded, j1t::vm::register_program &output)
+            : decoded_internal(decoded)
+            , output_internal(output)
+        {
+        }
+
+        auto run(const std::vector<uint32_t> &depth) -> void
+        {
+            using j1t::vm::instruction;
+
+            const std::vector<instruction> &records = decoded_internal.instructions;
+
+            std::vector<bool> is_target(records.size(), false);
+            for (uint32_t index = 0; index < records.size(); ++index)
+            {
+                const instruction &record = records[index];
+                if (depth[index] != UNREACHED && j1t::vm::is_valid_opcode(record.op)
+                    && j1t::vm::is_jump(static_cast<j1t::vm::opcode>(record.op)))
+                {
+                    is_target[record.target] = true;
+                }
+            }
+
+            std::vector<uint32_t> label_at(records.size(), NO_LABEL);
+            bool                  is_live = false;
+
+            for (uint32_t index = 0; index < records.size(); ++index)
+            {
+                if (depth[index] == UNREACHED)
+                {
+                    is_live = false;
+                    continue;
+                }
+
+                if (is_target[index] || !is_live)
+                {
+                    if (is_live)
+                    {
+                        materialize_all();
+                    }
+
+                    stack_internal.clear();
+                    for (uint32_t slot = 0; slot < depth[index]; ++slot)
+                    {
+                        stack_internal.push_back(temporary(slot));
+                    }
+
+                    label_at[index]      = size();
+                    block_start_internal = size();
+                    is_live              = true;
+                }
+
+                is_live = emit_record(records[index]);
+            }
+
+            for (const jump_fixup &fixup : fixups_internal)
+            {
+                output_internal.instructions[fixup.instruction_index].target = label_at[fixup.record_target];
+            }
+        }
+
+      private:
+        struct jump_fixup
+        {
+            uint32_t instruction_index;
+            uint32_t record_target;
+        };
+
+        auto size(void) const -> uint32_t
+        {
+            return static_cast<uint32_t>(output_internal.instructions.size());
+        }
+
+        auto temporary(uint32_t slot) const -> uint32_t
+        {
+            return output_internal.locals_used + slot;
+        }
+
+        auto constant(uint32_t value) -> uint32_t
+        {
+            auto [it, is_new] = constants_internal.try_emplace(value, static_cast<uint32_t>(output_internal.registers.size()));
+            if (is_new)
+            {
+                output_internal.registers.push_back(value);
+            }
+            return it->second;
+        }
+
+        auto emit(const j1t::vm::register_instruction &value) -> void
+        {
+            output_internal.instructions.push_back(value);
+        }
+
+        auto emit_jump(j1t::vm::register_op op, uint32_t a, uint32_t b, uint32_t record_target) -> void
+        {
+            j1t::vm::register_instruction jump {};
+            jump.op = op;
+            jump.a  = a;
+            jump.b  = b;
+            fixups_internal.push_back(jump_fixup { size(), record_target });
+            emit(jump);
+        }
+
+        auto emit_move(uint32_t destination, uint32_t source) -> void
+        {
+            j1t::vm::register_instruction move {};
+            move.op          = j1t::vm::register_op::MOVE;
+            move.destination = destination;
+            move.a           = source;
+            emit(move);
+        }
+
+        // the last instruction of the current block, if it computed `reg`
+        auto producer_of(uint32_t reg) const -> bool
+        {
+            if (size() == 0u || size() - 1u < block_start_internal)
+            {
+                return false;
+            }
+
+            const j1t::vm::register_instruction &last = output_internal.instructions.back();
+            return produces_value(last.op) && last.destination == reg;
+        }
+
+        // give every stack slot its own temporary, as jump targets expect
+        auto materialize_all(void) -> void
+        {
+            for (uint32_t slot = 0; slot < stack_internal.size(); ++slot)
+            {
+                if (stack_internal[slot] != temporary(slot))
+                {
+                    emit_move(temporary(slot), stack_internal[slot]);
+                    stack_internal[slot] = temporary(slot);
+                }
+            }
+        }
+
+        // slots still aliasing a local about to be overwritten take a copy
+        auto materialize_local(uint32_t local) -> void
+        {
+            for (uint32_t slot = 0; slot < stack_internal.size(); ++slot)
+            {
+                if (stack_internal[slot] == local)
+                {
+                    emit_move(temporary(slot), local);
+                    stack_internal[slot] = temporary(slot);
+                }
+            }
+        }
+
+        auto pop(void) -> uint32_t
+        {
+            const uint32_t value = stack_internal.back();
+            stack_internal.pop_back();
+            return value;
+        }
+
+        auto top_slot(void) const -> uint32_t
+        {
+            return static_cast<uint32_t>(stack_internal.size());
+        }
+
+        // returns whether execution can fall through to the next record
+        auto emit_record(const j1t::vm::instruction &record) -> bool
+        {
+            using j1t::vm::instruction;
+            using j1t::vm::interpreter;
+            using j1t::vm::opcode;
+            using j1t::vm::register_instruction;
+            using j1t::vm::register_op;
+
+            // verify() leaves the end of the code as the only non-opcode record
+            if (record.op == instruction::OP_END_OF_CODE)
+            {
+                emit(fail_with(interpreter::error::NON_TERMINATED_PROGRAM));
+                return false;
+            }
+
+            const opcode op = static_cast<opcode>(record.op);
+            switch (op)
+            {
+                case opcode::NOP :
+                    return true;
+
+                case opcode::PUSH :
+                    stack_internal.push_back(constant(record.immediate));
+                    return true;
+
+                case opcode::POP :
+                    pop();
+                    return true;
+
+                case opcode::LOCAL_GET :
+                    stack_internal.push_back(record.immediate);
+                    return true;
+
+                case opcode::LOCAL_SET :
+                {
+                    const uint32_t local = record.immediate;
+                    const uint32_t value = pop();
+                    if (value == local)
+                    {
+                        return true;
+                    }
+
+                    if (value == temporary(top_slot()) && producer_of(value))
+                    {
+                        // compute straight into the local
+                        register_instruction producer = output_internal.instructions.back();
+                        output_internal.instructions.pop_back();
+                        materialize_local(local);
+                        producer.destination = local;
+                        emit(producer);
+                        return true;
+                    }
+
+                    materialize_local(local);
+                    emit_move(local, value);
+                    return true;
+                }
+
+                case opcode::ADD :
+                case opcode::SUB :
+                case opcode::MUL :
+                case opcode::DIV :
+                case opcode::EQ :
+                case opcode::LESS_THAN_SIGNED :
+                case opcode::LESS_THAN_UNSIGNED :
+                {
+                    register_instruction arithmetic {};
+                    arithmetic.op          = binary_op(op);
+                    arithmetic.b           = pop();
+                    arithmetic.a           = pop();
+                    arithmetic.destination = temporary(top_slot());
+                    emit(arithmetic);
+                    stack_internal.push_back(arithmetic.destination);
+                    return true;
+                }
+
+                case opcode::LOAD_8_UNSIGNED :
+                case opcode::LOAD_16_UNSIGNED :
+                case opcode::LOAD_32 :
+                {
+                    register_instruction load {};
+                    load.op          = binary_op(op);
+                    load.a           = pop();
+                    load.destination = temporary(top_slot());
+                    emit(load);
+                    stack_internal.push_back(load.destination);
+                    return true;
+                }
+
+                case opcode::STORE_8 :
+                {
+                    register_instruction store {};
+                    store.op = register_op::STORE_8;
+                    store.b  = pop();
+                    store.a  = pop();
+                    emit(store);
+                    return true;
+                }
+
+                case opcode::JUMP :
+                    materialize_all();
+                    emit_jump(register_op::JUMP, 0, 0, record.target);
+                    return false;
+
+                case opcode::JUMP_IF_ZERO :
+                case opcode::JUMP_IF_NOT_ZERO :
+                {
+                    const bool     jump_if_zero = op == opcode::JUMP_IF_ZERO;
+                    const uint32_t condition    = pop();
+
+                    if (condition == temporary(top_slot()) && producer_of(condition)
+                        && is_compare(output_internal.instructions.back().op))
+                    {
+                        // materialize_all() only writes slots below the
+                        // compare's operands, so the compare can move after it
+                        register_instruction compare = output_internal.instructions.back();
+                        output_internal.instructions.pop_back();
+                        materialize_all();
+                        emit_jump(fused_branch(compare.op, jump_if_zero), compare.a, compare.b, record.target);
+                        return true;
+                    }
+
+                    materialize_all();
+                    emit_jump(jump_if_zero ? register_op::JUMP_IF_ZERO : register_op::JUMP_IF_NOT_ZERO, condition, 0, record.target);
+                    return true;
+                }
+
+                case opcode::RET :
+                {
+                    register_instruction ret {};
+                    ret.op = register_op::RET;
+                    ret.a  = pop();
+                    materialize_all();
+                    ret.b      = top_slot();
+                    ret.target = record.pc + 1u;
+                    emit(ret);
+                    return false;
+                }
+
+                case opcode::PRINT :
+                {
+                    register_instruction print {};
+                    print.op = register_op::PRINT;
+                    print.a  = pop();
+                    emit(print);
+                    return true;
+                }
+
+                case opcode::READ_8_UNSIGNED :
+                {
+                    register_instruction read {};
+                    read.op          = register_op::READ_8_UNSIGNED;
+                    read.destination = temporary(top_slot());
+                    emit(read);
+                    stack_internal.push_back(read.destination);
+                    return true;
+                }
+
+                default :
+                    emit(fail_with(interpreter::error::INVALID_OPCODE));
+                    return false;
+            }
+        }
+
+      private:
+        const j1t::vm::decoded_program        &decoded_internal;
+        j1t::vm::register_program             &output_internal;
+        std::vector<uint32_t>                  stack_internal;
+        std::vector<jump_fixup>  fixups_internal;
+        std::unordered_map<uint32_t, uint32_t> constants_internal;
+        uint32_t                               block_start_internal { 0 };
+    };
+}
+
+namespace j1t::vm
+{
+    auto translate(const program &target_program) -> register_program
+    {
+        // fused superinstructions would only get in the way here
+        const decoded_program decoded = decode(target_program);
+        const verification    facts   = verify(decoded);
+
+        register_program translated {};
+        if (!facts.is_verified || facts.locals_used > MAX_TRANSLATED_LOCALS)
+        {
+            return translated;
+        }
+
+        translated.locals_used = facts.locals_used;
+        translated.temporaries = facts.max_stack_depth;
+        translated.registers.assign(static_cast<std::size_t>(facts.locals_used) + facts.max_stack_depth, 0u);
+
+        register_emitter { decoded, translated }.run(facts.depths);
+
+        translated.is_translated = true;
+        return translated;
+    }
+
+    auto program::translated(void) const -> std::shared_ptr<const register_program>
+    {
+        return translated_cache.get_or_create(
+            [this]()
+            {
+                return translate(*this);
+            }
+        );
+    }
+}
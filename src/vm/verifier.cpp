@@ -0,0 +1,142 @@
+#include <vm/interpreter.hpp>
+#include <vm/verifier.hpp>
+
+#include <algorithm>
+
+namespace j1t::vm
+{
+    auto stack_effect_of(opcode op) -> stack_effect
+    {
+        switch (op)
+        {
+            case opcode::PUSH :
+            case opcode::LOCAL_GET :
+            case opcode::READ_8_UNSIGNED :
+                return { 0, 1 };
+
+            case opcode::POP :
+            case opcode::LOCAL_SET :
+            case opcode::JUMP_IF_ZERO :
+            case opcode::JUMP_IF_NOT_ZERO :
+            case opcode::RET :
+            case opcode::PRINT :
+                return { 1, 0 };
+
+            case opcode::ADD :
+            case opcode::SUB :
+            case opcode::MUL :
+            case opcode::DIV :
+            case opcode::EQ :
+            case opcode::LESS_THAN_SIGNED :
+            case opcode::LESS_THAN_UNSIGNED :
+                return { 2, 1 };
+
+            case opcode::LOAD_8_UNSIGNED :
+            case opcode::LOAD_16_UNSIGNED :
+            case opcode::LOAD_32 :
+                return { 1, 1 };
+
+            case opcode::STORE_8 :
+                return { 2, 0 };
+
+            case opcode::NOP :
+            case opcode::JUMP :
+            default :
+                return { 0, 0 };
+        }
+    }
+
+    auto verify(const decoded_program &decoded) -> verification
+    {
+        const std::vector<instruction> &records = decoded.instructions;
+
+        verification result {};
+        if (!decoded.is_linear)
+        {
+            return result;
+        }
+
+        std::vector<uint32_t> &depths = result.depths;
+        depths.assign(records.size(), verification::UNREACHABLE);
+
+        std::vector<uint32_t> worklist { 0 };
+        depths[0] = 0;
+
+        auto reach = [&](uint32_t index, uint32_t incoming) -> bool
+        {
+            if (depths[index] == verification::UNREACHABLE)
+            {
+                depths[index] = incoming;
+                worklist.push_back(index);
+                return true;
+            }
+            return depths[index] == incoming;
+        };
+
+        while (!worklist.empty())
+        {
+            const uint32_t index = worklist.back();
+            worklist.pop_back();
+
+            const instruction &record = records[index];
+            if (record.op == instruction::OP_END_OF_CODE)
+            {
+                // stops with NON_TERMINATED_PROGRAM, nothing unsafe about it
+                continue;
+            }
+
+            if (!is_valid_opcode(record.op))
+            {
+                return verification {};
+            }
+
+            const opcode       op      = static_cast<opcode>(record.op);
+            const stack_effect effect  = stack_effect_of(op);
+            const uint32_t     current = depths[index];
+            if (current < effect.pops)
+            {
+                return verification {};
+            }
+
+            const uint32_t next    = current - effect.pops + effect.pushes;
+            result.max_stack_depth = std::max(result.max_stack_depth, next);
+
+            if (op == opcode::LOCAL_GET || op == opcode::LOCAL_SET)
+            {
+                // no std::vector that size fits in memory; leave it to the
+                // checked paths
+                if (record.immediate == 0xFFFF'FFFFu)
+                {
+                    return verification {};
+                }
+                result.locals_used = std::max(result.locals_used, record.immediate + 1u);
+            }
+
+            if (is_jump(op))
+            {
+                if (record.target == instruction::INVALID_TARGET || !reach(record.target, next))
+                {
+                    return verification {};
+                }
+            }
+
+            if (op != opcode::JUMP && op != opcode::RET && !reach(index + 1u, next))
+            {
+                return verification {};
+            }
+        }
+
+        result.is_verified = true;
+        return result;
+    }
+
+    auto program::verified(void) const -> std::shared_ptr<const verification>
+    {
+        return verified_cache.get_or_create(
+            [this]()
+            {
+                return verify(decode(*this));
+            }
+        );
+    }
+}